@@ -10,12 +10,16 @@ See LICENSE for licensing.
 #include "parameters.h"
 #include "incubator.h"
 #include "interval_map.h"
+#include "binomial.h"
+#include "gtf_buffer.h"
 
 using namespace std;
 
 int main(int argc, const char **argv)
 {
 	//test_join_interval_map();
+	//test_binomial_pvalue();
+	//test_gtf_buffer();
 	//return 0;
 	setbuf(stdout, NULL);
 	vector<parameters> params(NUM_DATA_TYPES);
@@ -0,0 +1,57 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+#include "benchmark.h"
+#include "alloc_counter.h"
+
+using namespace std;
+
+// allocations of the kernels are counted through the global operator new
+void* operator new(size_t n)
+{
+	alloc_counter::add(n);
+	void *p = malloc(n == 0 ? 1 : n);
+	if(p == NULL) throw bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t n)
+{
+	return operator new(n);
+}
+
+void operator delete(void *p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+	free(p);
+}
+
+int main(int argc, const char **argv)
+{
+	setbuf(stdout, NULL);
+	benchmark bm;
+
+	if(argc == 1)
+	{
+		bm.cfg.print_copyright();
+		bm.print_help();
+		printf("\n");
+		return 0;
+	}
+
+	bm.parse_arguments(argc, argv);
+	bm.resolve();
+	return 0;
+}
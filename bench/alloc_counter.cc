@@ -0,0 +1,30 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#include "alloc_counter.h"
+#include <atomic>
+
+using namespace std;
+
+static atomic<int64_t> num_allocs(0);
+static atomic<int64_t> num_bytes(0);
+
+int64_t alloc_counter::count()
+{
+	return num_allocs.load(memory_order_relaxed);
+}
+
+int64_t alloc_counter::bytes()
+{
+	return num_bytes.load(memory_order_relaxed);
+}
+
+int alloc_counter::add(size_t n)
+{
+	num_allocs.fetch_add(1, memory_order_relaxed);
+	num_bytes.fetch_add(n, memory_order_relaxed);
+	return 0;
+}
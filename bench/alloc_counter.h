@@ -0,0 +1,23 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#ifndef __ALLOC_COUNTER_H__
+#define __ALLOC_COUNTER_H__
+
+#include <stdint.h>
+#include <cstddef>
+
+// counts allocations reported by the global operator new, which is
+// replaced only in aletsch-bench (bench.cc); it stays 0 elsewhere
+class alloc_counter
+{
+public:
+	static int64_t count();			// number of allocations so far
+	static int64_t bytes();			// number of bytes allocated so far
+	static int add(size_t n);
+};
+
+#endif
@@ -0,0 +1,320 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#include "bench_corpus.h"
+#include "combined_graph.h"
+#include "util.h"
+
+#include <cstdio>
+#include <cassert>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+bench_corpus::bench_corpus(const parameters &c, int seed)
+	: cfg(c), rng(seed)
+{
+}
+
+int bench_corpus::load(const string &file_list, int clusters)
+{
+	ifstream fin(file_list.c_str());
+	if(fin.fail())
+	{
+		printf("cannot open graph list %s\n", file_list.c_str());
+		return -1;
+	}
+
+	string file;
+	while(getline(fin, file))
+	{
+		if(file == "") continue;
+		bench_graph bg;
+		if(load_graph(file, bg) != 0) continue;
+		sample_clusters(bg, clusters);
+		graphs.push_back(std::move(bg));
+	}
+	fin.close();
+	return 0;
+}
+
+int bench_corpus::load_graph(const string &file, bench_graph &bg)
+{
+	ifstream fin(file.c_str());
+	if(fin.fail())
+	{
+		printf("cannot open graph file %s\n", file.c_str());
+		return -1;
+	}
+
+	// lines of splice_graph::write, followed by phasing paths
+	combined_graph cb(cfg);
+	cb.strand = '.';
+	vector<PIDI> sb, tb;
+	map<PI32, DI> jm;
+	string line;
+	while(getline(fin, line))
+	{
+		stringstream sstr(line);
+		string key;
+		sstr >> key;
+		if(key == "#")
+		{
+			sstr >> cb.gid >> cb.chrm >> cb.strand;
+		}
+		else if(key == "region")
+		{
+			int32_t l, r;
+			double w;
+			sstr >> l >> r >> w;
+			if(l < r) cb.regions.push_back(PPDI(PI32(l, r), DI(w, 1)));
+		}
+		else if(key == "sbound" || key == "tbound")
+		{
+			int32_t p;
+			double w;
+			int c;
+			sstr >> p >> w >> c;
+			if(key == "sbound") sb.push_back(PIDI(p, DI(w, c)));
+			else tb.push_back(PIDI(p, DI(w, c)));
+		}
+		else if(key == "junction")
+		{
+			int32_t p1, p2;
+			double w;
+			int c;
+			sstr >> p1 >> p2 >> w >> c;
+			DI &d = jm[PI32(p1, p2)];
+			d.first += w;
+			d.second += c;
+		}
+		else if(key == "phase")
+		{
+			int c, n;
+			sstr >> c >> n;
+			vector<int32_t> v(n);
+			for(int k = 0; k < n; k++) sstr >> v[k];
+			if(n % 2 == 0 && c >= 1) bg.ps.add(v, c);
+		}
+	}
+	fin.close();
+
+	if(cb.regions.size() == 0) return -1;
+	sort(cb.regions.begin(), cb.regions.end());
+
+	// boundaries of skipped (empty) vertices are dropped
+	set<int32_t> ls, rs;
+	for(int i = 0; i < cb.regions.size(); i++) ls.insert(cb.regions[i].first.first);
+	for(int i = 0; i < cb.regions.size(); i++) rs.insert(cb.regions[i].first.second);
+	for(int i = 0; i < sb.size(); i++) if(ls.find(sb[i].first) != ls.end()) cb.sbounds.push_back(sb[i]);
+	for(int i = 0; i < tb.size(); i++) if(rs.find(tb[i].first) != rs.end()) cb.tbounds.push_back(tb[i]);
+	for(auto &z: jm) cb.junctions.push_back(PTDI(TI32(z.first, 0), z.second));
+
+	if(cb.sbounds.size() == 0 || cb.tbounds.size() == 0) return -1;
+
+	cb.build_splice_graph(bg.gr, cfg);
+	init_edges(bg.gr);
+	bg.name = cb.gid;
+	return 0;
+}
+
+int bench_corpus::simulate(int num, int regions, int phases, int clusters)
+{
+	for(int i = 0; i < num; i++)
+	{
+		// sizes vary from half to 1.5 times the given number
+		int n = regions / 2 + rng() % (regions + 1);
+		if(n <= 0) n = 1;
+
+		bench_graph bg;
+		simulate_graph(i, n, bg);
+		sample_phases(bg, phases);
+		sample_clusters(bg, clusters);
+		graphs.push_back(std::move(bg));
+	}
+	return 0;
+}
+
+int bench_corpus::simulate_graph(int index, int n, bench_graph &bg)
+{
+	combined_graph cb(cfg);
+	cb.gid = "simulate." + tostring(index);
+	cb.chrm = "simulate";
+	cb.strand = '+';
+
+	// exons are split into partial exons sharing a boundary with
+	// probability 0.3, and separated by introns otherwise
+	vector<bool> gap(n, true);
+	int32_t p = 10000;
+	for(int i = 0; i < n; i++)
+	{
+		int32_t len = 50 + rng() % 250;
+		double w = 5 + rng() % 100;
+		cb.regions.push_back(PPDI(PI32(p, p + len), DI(w, 1)));
+		p += len;
+		if(rng() % 10 < 3) gap[i] = false;
+		else p += 100 + rng() % 2000;
+	}
+
+	// junctions to the next exon, and skipping ones to the few after
+	for(int i = 0; i + 1 < n; i++)
+	{
+		if(gap[i] == false) continue;
+		for(int j = i + 1; j < n && j <= i + 4; j++)
+		{
+			if(gap[j - 1] == false) continue;
+			if(j >= i + 2 && rng() % 3 != 0) continue;
+			int32_t p1 = cb.regions[i].first.second;
+			int32_t p2 = cb.regions[j].first.first;
+			double w = 1 + rng() % 50;
+			cb.junctions.push_back(PTDI(TI32(PI32(p1, p2), 0), DI(w, 1)));
+		}
+	}
+
+	cb.sbounds.push_back(PIDI(cb.regions.front().first.first, DI(10 + rng() % 50, 1)));
+	cb.tbounds.push_back(PIDI(cb.regions.back().first.second, DI(10 + rng() % 50, 1)));
+	for(int i = 1; i < n; i++)
+	{
+		if(gap[i - 1] == false || rng() % 10 != 0) continue;
+		cb.sbounds.push_back(PIDI(cb.regions[i].first.first, DI(1 + rng() % 20, 1)));
+	}
+	for(int i = 0; i + 1 < n; i++)
+	{
+		if(gap[i] == false || rng() % 10 != 0) continue;
+		cb.tbounds.push_back(PIDI(cb.regions[i].first.second, DI(1 + rng() % 20, 1)));
+	}
+
+	cb.build_splice_graph(bg.gr, cfg);
+	init_edges(bg.gr);
+	bg.name = cb.gid;
+	return 0;
+}
+
+int bench_corpus::init_edges(splice_graph &gr)
+{
+	// supports of a single sample, as in assembler::init_supports
+	PEEI pei = gr.edges();
+	for(edge_iterator it = pei.first; it != pei.second; it++)
+	{
+		edge_info &ei = gr.get_editable_edge_info(*it);
+		ei.samples.clear();
+		ei.spAbd.clear();
+		ei.samples.insert(0);
+		ei.spAbd.insert(make_pair(0, gr.get_edge_weight(*it)));
+		ei.abd = gr.get_edge_weight(*it);
+		ei.count = 1;
+	}
+	return 0;
+}
+
+int bench_corpus::random_path(splice_graph &gr, vector<int> &v)
+{
+	// targets are sorted, as edges are kept in pointer order
+	v.clear();
+	int n = gr.num_vertices() - 1;
+	int x = 0;
+	vector<int> t;
+	while(true)
+	{
+		t.clear();
+		PEEI pei = gr.out_edges(x);
+		for(edge_iterator it = pei.first; it != pei.second; it++) t.push_back((*it)->target());
+		if(t.size() == 0) break;
+		sort(t.begin(), t.end());
+		x = t[rng() % t.size()];
+		if(x == n) break;
+		v.push_back(x);
+	}
+	return 0;
+}
+
+int bench_corpus::build_exon_chain(splice_graph &gr, const vector<int> &v, int a, int b, vector<int32_t> &xy)
+{
+	xy.clear();
+	xy.push_back(gr.get_vertex_info(v[a]).lpos);
+	for(int k = a; k < b; k++)
+	{
+		int32_t p1 = gr.get_vertex_info(v[k + 0]).rpos;
+		int32_t p2 = gr.get_vertex_info(v[k + 1]).lpos;
+		if(p1 == p2) continue;
+		xy.push_back(p1);
+		xy.push_back(p2);
+	}
+	xy.push_back(gr.get_vertex_info(v[b]).rpos);
+	return 0;
+}
+
+int bench_corpus::sample_phases(bench_graph &bg, int num)
+{
+	vector<int> v;
+	vector<int32_t> xy;
+	for(int i = 0; i < num; i++)
+	{
+		random_path(bg.gr, v);
+		if(v.size() == 0) continue;
+		int a = rng() % v.size();
+		int b = a + rng() % 6;
+		if(b >= v.size()) b = v.size() - 1;
+		build_exon_chain(bg.gr, v, a, b, xy);
+		bg.ps.add(xy, 1 + rng() % 20);
+	}
+	return 0;
+}
+
+int bench_corpus::sample_clusters(bench_graph &bg, int num)
+{
+	// two reads on a path, with at least one vertex between them
+	vector<int> v;
+	vector<int32_t> xy;
+	for(int i = 0; i < num * 10 && bg.vc.size() < num; i++)
+	{
+		random_path(bg.gr, v);
+		int m = v.size();
+		if(m < 3) continue;
+
+		int a = rng() % (m - 2);
+		int b = a + rng() % 3;
+		if(b > m - 3) b = m - 3;
+		int c = b + 2 + rng() % (m - b - 2);
+		int d = c + rng() % 3;
+		if(d > m - 1) d = m - 1;
+
+		pereads_cluster pc;
+		build_exon_chain(bg.gr, v, a, b, xy);
+		pc.chain1.assign(xy.begin() + 1, xy.end() - 1);
+		pc.extend[0] = xy.front();
+		pc.extend[1] = xy.back();
+
+		build_exon_chain(bg.gr, v, c, d, xy);
+		pc.chain2.assign(xy.begin() + 1, xy.end() - 1);
+		pc.extend[2] = xy.front();
+		pc.extend[3] = xy.back();
+
+		// reads end within their first and last vertices
+		pc.bounds[0] = pc.extend[0] + rng() % (bg.gr.get_vertex_info(v[a]).length / 2 + 1);
+		pc.bounds[1] = pc.extend[1] - rng() % (bg.gr.get_vertex_info(v[b]).length / 2 + 1);
+		pc.bounds[2] = pc.extend[2] + rng() % (bg.gr.get_vertex_info(v[c]).length / 2 + 1);
+		pc.bounds[3] = pc.extend[3] - rng() % (bg.gr.get_vertex_info(v[d]).length / 2 + 1);
+
+		pc.count = 1 + rng() % 10;
+		bg.vc.push_back(std::move(pc));
+	}
+	return 0;
+}
+
+int bench_corpus::print()
+{
+	size_t nv = 0, ne = 0, np = 0, nc = 0;
+	for(int i = 0; i < graphs.size(); i++)
+	{
+		nv += graphs[i].gr.num_vertices();
+		ne += graphs[i].gr.num_edges();
+		np += graphs[i].ps.pids.size();
+		nc += graphs[i].vc.size();
+	}
+	printf("corpus: %lu graphs, %lu vertices, %lu edges, %lu phasing paths, %lu clusters\n", graphs.size(), nv, ne, np, nc);
+	return 0;
+}
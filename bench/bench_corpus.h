@@ -0,0 +1,61 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#ifndef __BENCH_CORPUS_H__
+#define __BENCH_CORPUS_H__
+
+#include <string>
+#include <vector>
+#include <random>
+
+#include "parameters.h"
+#include "splice_graph.h"
+#include "phase_set.h"
+#include "pereads_cluster.h"
+
+using namespace std;
+
+// one input of the kernels: a splice graph with its phasing paths,
+// and paired-end clusters to be bridged on it
+class bench_graph
+{
+public:
+	string name;
+	splice_graph gr;
+	phase_set ps;
+	vector<pereads_cluster> vc;
+};
+
+// graphs loaded from files dumped by --trace_dump_dir, or simulated;
+// reads are never dumped, so clusters are always sampled from the graph
+class bench_corpus
+{
+public:
+	bench_corpus(const parameters &cfg, int seed);
+
+public:
+	const parameters &cfg;
+	vector<bench_graph> graphs;
+
+private:
+	mt19937 rng;
+
+public:
+	int load(const string &file_list, int clusters);
+	int simulate(int num, int regions, int phases, int clusters);
+	int print();
+
+private:
+	int load_graph(const string &file, bench_graph &bg);
+	int simulate_graph(int index, int regions, bench_graph &bg);
+	int sample_phases(bench_graph &bg, int num);
+	int sample_clusters(bench_graph &bg, int num);
+	int init_edges(splice_graph &gr);
+	int random_path(splice_graph &gr, vector<int> &v);
+	int build_exon_chain(splice_graph &gr, const vector<int> &v, int a, int b, vector<int32_t> &xy);
+};
+
+#endif
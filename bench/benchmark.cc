@@ -0,0 +1,267 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#include "benchmark.h"
+#include "alloc_counter.h"
+#include "graph_reviser.h"
+#include "bridge_solver.h"
+#include "hyper_set.h"
+#include "scallop.h"
+#include "util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <chrono>
+#include <algorithm>
+
+static const char *kernel_names[NUM_KERNELS] = {"scallop", "revise", "bridge"};
+
+kernel_result::kernel_result()
+{
+	allocs = 0;
+	bytes = 0;
+	items = 0;
+}
+
+double kernel_result::percentile(double q) const
+{
+	if(times.size() == 0) return 0;
+	vector<double> v = times;
+	sort(v.begin(), v.end());
+	int k = (int)(q * v.size());
+	if(k >= v.size()) k = v.size() - 1;
+	return v[k];
+}
+
+int kernel_result::print(const char *name) const
+{
+	if(times.size() == 0) return 0;
+	double total = 0;
+	for(int i = 0; i < times.size(); i++) total += times[i];
+	double n = times.size();
+
+	printf("%-8s %8lu %10.3lf %12.1lf %10.3lf %10.3lf %10.3lf %10.3lf %12.1lf %10.1lf %10ld\n",
+			name, times.size(), total, (total > 0) ? n / total : 0,
+			percentile(0.5) * 1e3, percentile(0.9) * 1e3, percentile(0.99) * 1e3, percentile(1.0) * 1e3,
+			allocs / n, bytes / n / 1024.0, items);
+	return 0;
+}
+
+benchmark::benchmark()
+{
+	cfg.set_default(DEFAULT);
+	graph_list = "";
+	simulated = 0;
+	regions = 40;
+	phases = 100;
+	clusters = 100;
+	repeats = 5;
+	seed = 1;
+	insertsize_low = 80;
+	insertsize_high = 500;
+	kernels.assign(NUM_KERNELS, true);
+	results.resize(NUM_KERNELS);
+}
+
+int benchmark::parse_arguments(int argc, const char **argv)
+{
+	for(int i = 1; i < argc; i++)
+	{
+		if(string(argv[i]) == "--help")
+		{
+			print_help();
+			exit(0);
+		}
+		else if(string(argv[i]) == "--graphs")
+		{
+			graph_list = string(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--simulate")
+		{
+			simulated = atoi(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--regions")
+		{
+			regions = atoi(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--phases")
+		{
+			phases = atoi(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--clusters")
+		{
+			clusters = atoi(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--repeats")
+		{
+			repeats = atoi(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--seed")
+		{
+			seed = atoi(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--insertsize_low")
+		{
+			insertsize_low = atoi(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--insertsize_high")
+		{
+			insertsize_high = atoi(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--kernels")
+		{
+			kernels.assign(NUM_KERNELS, false);
+			vector<string> v = split_string(string(argv[i + 1]), ",");
+			for(int j = 0; j < v.size(); j++)
+			{
+				for(int k = 0; k < NUM_KERNELS; k++)
+				{
+					if(v[j] == kernel_names[k]) kernels[k] = true;
+				}
+			}
+			i++;
+		}
+	}
+
+	// options of the kernels are those of aletsch
+	cfg.parse_arguments(argc, argv, DEFAULT);
+
+	if(graph_list == "" && simulated <= 0) simulated = 100;
+	if(repeats <= 0) repeats = 1;
+	return 0;
+}
+
+int benchmark::print_help()
+{
+	printf("\n");
+	printf("Usage: aletsch-bench [--graphs <graph-list>] [--simulate <integer>] [options]\n");
+	printf("\n");
+	printf("Options:\n");
+	printf(" %-46s  %s\n", "--help",  "print usage of aletsch-bench and exit");
+	printf(" %-46s  %s\n", "--graphs <string>",  "file listing graphs dumped by aletsch --trace_dump_dir, one per line, default: N/A");
+	printf(" %-46s  %s\n", "--simulate <integer>",  "number of graphs to simulate, default: 100 if no --graphs is given, 0 otherwise");
+	printf(" %-46s  %s\n", "--regions <integer>",  "average number of regions of simulated graphs, default: 40");
+	printf(" %-46s  %s\n", "--phases <integer>",  "number of phasing paths of simulated graphs, default: 100");
+	printf(" %-46s  %s\n", "--clusters <integer>",  "number of paired-end clusters sampled on each graph, default: 100");
+	printf(" %-46s  %s\n", "--repeats <integer>",  "number of runs of each kernel on each graph, default: 5");
+	printf(" %-46s  %s\n", "--seed <integer>",  "seed for simulating graphs and sampling clusters, default: 1");
+	printf(" %-46s  %s\n", "--insertsize_low <integer>",  "lower bound of insert size for bridging, default: 80");
+	printf(" %-46s  %s\n", "--insertsize_high <integer>",  "upper bound of insert size for bridging, default: 500");
+	printf(" %-46s  %s\n", "--kernels <string>",  "comma-separated kernels to run among scallop, revise and bridge, default: all");
+	printf("\n");
+	printf("Other options of aletsch (e.g., --max_num_exons) are applied to the kernels.\n");
+	return 0;
+}
+
+int benchmark::resolve()
+{
+	bench_corpus bc(cfg, seed);
+	if(graph_list != "") bc.load(graph_list, clusters);
+	if(simulated >= 1) bc.simulate(simulated, regions, phases, clusters);
+	bc.print();
+
+	// runs of a graph are consecutive, so that allocations of one
+	// run are not reused by a different graph
+	for(int i = 0; i < bc.graphs.size(); i++)
+	{
+		bench_graph &bg = bc.graphs[i];
+		for(int r = 0; r < repeats; r++)
+		{
+			if(kernels[KERNEL_SCALLOP]) run_scallop(bg, results[KERNEL_SCALLOP]);
+			if(kernels[KERNEL_REVISE]) run_revise(bg, results[KERNEL_REVISE]);
+			if(kernels[KERNEL_BRIDGE]) run_bridge(bg, results[KERNEL_BRIDGE]);
+		}
+	}
+
+	print();
+	return 0;
+}
+
+int benchmark::run_scallop(bench_graph &bg, kernel_result &r)
+{
+	splice_graph gr(bg.gr);
+	phase_set ps(bg.ps);
+	gr.gid = bg.name;
+
+	int64_t a0 = alloc_counter::count();
+	int64_t b0 = alloc_counter::bytes();
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+
+	// as in assembler::assemble
+	gr.extend_strands();
+	map<int32_t, int32_t> smap, tmap;
+	group_start_boundaries(gr, smap, cfg.max_group_boundary_distance);
+	group_end_boundaries(gr, tmap, cfg.max_group_boundary_distance);
+	ps.project_boundaries(smap, tmap);
+
+	hyper_set hs(gr, ps);
+	hs.filter_nodes(gr);
+	scallop sx(gr, hs, cfg);
+	sx.assemble();
+
+	r.times.push_back(chrono::duration<double>(chrono::steady_clock::now() - t0).count());
+	r.allocs += alloc_counter::count() - a0;
+	r.bytes += alloc_counter::bytes() - b0;
+	r.items += sx.trsts.size();
+	return 0;
+}
+
+int benchmark::run_revise(bench_graph &bg, kernel_result &r)
+{
+	splice_graph gr(bg.gr);
+
+	int64_t a0 = alloc_counter::count();
+	int64_t b0 = alloc_counter::bytes();
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+
+	revise_splice_graph_full(gr, cfg);
+
+	r.times.push_back(chrono::duration<double>(chrono::steady_clock::now() - t0).count());
+	r.allocs += alloc_counter::count() - a0;
+	r.bytes += alloc_counter::bytes() - b0;
+	r.items += gr.num_vertices();
+	return 0;
+}
+
+int benchmark::run_bridge(bench_graph &bg, kernel_result &r)
+{
+	splice_graph gr(bg.gr);
+	vector<pereads_cluster> vc(bg.vc);
+
+	int64_t a0 = alloc_counter::count();
+	int64_t b0 = alloc_counter::bytes();
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+
+	bridge_solver bs(gr, vc, cfg, insertsize_low, insertsize_high);
+
+	r.times.push_back(chrono::duration<double>(chrono::steady_clock::now() - t0).count());
+	r.allocs += alloc_counter::count() - a0;
+	r.bytes += alloc_counter::bytes() - b0;
+	for(int k = 0; k < bs.opt.size(); k++) if(bs.opt[k].type >= 1) r.items++;
+	return 0;
+}
+
+int benchmark::print()
+{
+	printf("%-8s %8s %10s %12s %10s %10s %10s %10s %12s %10s %10s\n",
+			"kernel", "runs", "seconds", "runs/second", "p50(ms)", "p90(ms)", "p99(ms)", "max(ms)", "allocs/run", "KB/run", "items");
+	for(int k = 0; k < NUM_KERNELS; k++)
+	{
+		if(kernels[k] == false) continue;
+		results[k].print(kernel_names[k]);
+	}
+	return 0;
+}
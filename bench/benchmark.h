@@ -0,0 +1,72 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "parameters.h"
+#include "bench_corpus.h"
+
+using namespace std;
+
+#define KERNEL_SCALLOP 0			// hyper-set and scallop::assemble, items = transcripts
+#define KERNEL_REVISE 1				// revise_splice_graph_full, items = remaining vertices
+#define KERNEL_BRIDGE 2				// bridge_solver, items = bridged clusters
+#define NUM_KERNELS 3
+
+// measurements of one kernel over all graphs and repetitions
+class kernel_result
+{
+public:
+	kernel_result();
+
+public:
+	vector<double> times;			// seconds of each run
+	int64_t allocs;
+	int64_t bytes;
+	int64_t items;
+
+public:
+	double percentile(double q) const;
+	int print(const char *name) const;
+};
+
+class benchmark
+{
+public:
+	benchmark();
+
+public:
+	parameters cfg;					// for the kernels, parsed from the same arguments
+	string graph_list;				// file listing dumped graphs
+	int simulated;					// number of graphs to simulate
+	int regions;					// average number of regions of simulated graphs
+	int phases;						// number of phasing paths of simulated graphs
+	int clusters;					// number of paired-end clusters per graph
+	int repeats;
+	int seed;
+	int insertsize_low;
+	int insertsize_high;
+	vector<bool> kernels;
+	vector<kernel_result> results;
+
+public:
+	int parse_arguments(int argc, const char **argv);
+	int print_help();
+	int resolve();
+
+private:
+	int run_scallop(bench_graph &bg, kernel_result &r);
+	int run_revise(bench_graph &bg, kernel_result &r);
+	int run_bridge(bench_graph &bg, kernel_result &r);
+	int print();
+};
+
+#endif
@@ -0,0 +1,508 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#include "read_simulator.h"
+#include "util.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <algorithm>
+#include <htslib/sam.h>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+bool sim_read::operator<(const sim_read &r) const
+{
+	if(tid != r.tid) return tid < r.tid;
+	if(pos != r.pos) return pos < r.pos;
+	if(fid != r.fid) return fid < r.fid;
+	return flag < r.flag;
+}
+
+read_simulator::read_simulator()
+{
+	output_dir = "";
+	gtf_file = "";
+	num_genes = 1000;
+	num_chrms = 1;
+	num_samples = 10;
+	depth = 10.0;
+	protocol = "paired_end";
+	library_type = "unstranded";
+	read_length = 100;
+	insertsize = 300;
+	seed = 1;
+	max_threads = 1;
+}
+
+int read_simulator::parse_arguments(int argc, const char **argv)
+{
+	for(int i = 1; i < argc; i++)
+	{
+		if(string(argv[i]) == "--help")
+		{
+			print_help();
+			exit(0);
+		}
+		else if(string(argv[i]) == "-o" || string(argv[i]) == "--output_dir")
+		{
+			output_dir = string(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--gtf")
+		{
+			gtf_file = string(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--genes")
+		{
+			num_genes = atoi(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--chromosomes")
+		{
+			num_chrms = atoi(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--samples")
+		{
+			num_samples = atoi(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--depth")
+		{
+			depth = atof(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--protocol")
+		{
+			protocol = string(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--library_type")
+		{
+			library_type = string(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--read_length")
+		{
+			read_length = atoi(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--insertsize")
+		{
+			insertsize = atoi(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--seed")
+		{
+			seed = atoi(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "-t" || string(argv[i]) == "--max_threads")
+		{
+			max_threads = atoi(argv[i + 1]);
+			i++;
+		}
+	}
+
+	if(num_chrms <= 0) num_chrms = 1;
+	if(max_threads <= 0) max_threads = 1;
+	if(read_length <= 0) read_length = 100;
+	if(insertsize < read_length) insertsize = read_length;
+	return 0;
+}
+
+int read_simulator::print_help()
+{
+	printf("\n");
+	printf("Usage: aletsch-simulate -o <output-dir> [--gtf <annotation.gtf>] [options]\n");
+	printf("\n");
+	printf("Options:\n");
+	printf(" %-46s  %s\n", "--help",  "print usage of aletsch-simulate and exit");
+	printf(" %-46s  %s\n", "-o/--output_dir <string>",  "existing directory for bam files, their list (input.list), and true transcripts (truth.gtf)");
+	printf(" %-46s  %s\n", "--gtf <string>",  "annotation whose transcripts are sampled, default: N/A (i.e., random genes)");
+	printf(" %-46s  %s\n", "--genes <integer>",  "number of random genes, default: 1000");
+	printf(" %-46s  %s\n", "--chromosomes <integer>",  "number of chromosomes of random genes, default: 1");
+	printf(" %-46s  %s\n", "--samples <integer>",  "number of samples, default: 10");
+	printf(" %-46s  %s\n", "--depth <float>",  "average coverage of an expressed transcript, default: 10.0");
+	printf(" %-46s  %s\n", "--protocol <string>",  "paired_end, single_end, pacbio_ccs, pacbio_sub, or ont, default: paired_end");
+	printf(" %-46s  %s\n", "--library_type <string>",  "unstranded, fr_first, or fr_second, default: unstranded");
+	printf(" %-46s  %s\n", "--read_length <integer>",  "length of short reads, default: 100");
+	printf(" %-46s  %s\n", "--insertsize <integer>",  "average fragment length of paired-end reads, default: 300");
+	printf(" %-46s  %s\n", "--seed <integer>",  "seed of the simulation, default: 1");
+	printf(" %-46s  %s\n", "-t/--max_threads <integer>",  "number of samples simulated in parallel, default: 1");
+	return 0;
+}
+
+int read_simulator::resolve()
+{
+	if(output_dir == "")
+	{
+		printf("output directory (-o) is not given\n");
+		return -1;
+	}
+
+	if(protocol != "paired_end" && protocol != "single_end" && protocol != "pacbio_ccs" && protocol != "pacbio_sub" && protocol != "ont")
+	{
+		printf("unknown protocol %s\n", protocol.c_str());
+		return -1;
+	}
+
+	if(library_type != "unstranded" && library_type != "fr_first" && library_type != "fr_second")
+	{
+		printf("unknown library type %s\n", library_type.c_str());
+		return -1;
+	}
+
+	genome gm;
+	if(gtf_file != "") gm.read(gtf_file);
+	else build_random_genome(gm);
+
+	build_transcripts(gm);
+	gm.write(output_dir + "/truth.gtf");
+	printf("simulate %d samples from %lu transcripts on %lu chromosomes\n", num_samples, trsts.size(), chrms.size());
+
+	// samples are independent, each with its own random generator
+	boost::asio::thread_pool pool(max_threads);
+	for(int k = 0; k < num_samples; k++)
+	{
+		boost::asio::post(pool, [this, k]{ simulate_sample(k); });
+	}
+	pool.join();
+
+	write_list();
+	return 0;
+}
+
+int read_simulator::build_random_genome(genome &gm)
+{
+	mt19937 rng(seed);
+	vector<int32_t> next(num_chrms, 10000);
+	for(int g = 0; g < num_genes; g++)
+	{
+		int c = g % num_chrms;
+		char strand = (rng() % 2 == 0) ? '+' : '-';
+
+		vector<PI32> ex;
+		int m = 1 + rng() % 12;
+		int32_t p = next[c];
+		for(int j = 0; j < m; j++)
+		{
+			int32_t len = 50 + rng() % 350;
+			ex.push_back(PI32(p, p + len));
+			p += len + 200 + rng() % 4800;
+		}
+		next[c] = p + 5000 + rng() % 45000;
+
+		// the first isoform has all exons, others skip inner ones
+		gene gn;
+		set<vector<PI32>> s;
+		int n = 1 + rng() % 4;
+		for(int i = 0; i < n; i++)
+		{
+			vector<PI32> v;
+			for(int j = 0; j < m; j++)
+			{
+				if(i >= 1 && j >= 1 && j < m - 1 && rng() % 4 == 0) continue;
+				v.push_back(ex[j]);
+			}
+			if(s.find(v) != s.end()) continue;
+			s.insert(v);
+
+			transcript t;
+			t.seqname = "chr" + tostring(c + 1);
+			t.source = "simulate";
+			t.feature = "transcript";
+			t.gene_id = "gene." + tostring(g + 1);
+			t.transcript_id = t.gene_id + "." + tostring(i + 1);
+			t.strand = strand;
+			t.exons = v;
+			t.coverage = 0;
+			gn.add_transcript(t);
+		}
+		gm.add_gene(gn);
+	}
+	return 0;
+}
+
+int read_simulator::build_transcripts(genome &gm)
+{
+	// chromosomes are in the order of names, as in the bam header
+	map<string, int32_t> m;
+	for(int i = 0; i < gm.genes.size(); i++)
+	{
+		for(int j = 0; j < gm.genes[i].transcripts.size(); j++)
+		{
+			const transcript &t = gm.genes[i].transcripts[j];
+			if(t.exons.size() == 0) continue;
+			int32_t r = t.get_bounds().second;
+			if(m.find(t.seqname) == m.end() || m[t.seqname] < r) m[t.seqname] = r;
+		}
+	}
+
+	map<string, int> tids;
+	for(auto &z: m)
+	{
+		tids[z.first] = chrms.size();
+		chrms.push_back(z.first);
+		chrm_lengths.push_back(z.second + 10000);
+	}
+
+	// abundances are log-normal with an average of 1
+	mt19937 rng(seed + 1);
+	lognormal_distribution<double> ln(0, 1);
+	double sum = 0;
+	for(int i = 0; i < gm.genes.size(); i++)
+	{
+		for(int j = 0; j < gm.genes[i].transcripts.size(); j++)
+		{
+			const transcript &t = gm.genes[i].transcripts[j];
+			if(t.exons.size() == 0) continue;
+
+			sim_transcript st;
+			st.tid = tids[t.seqname];
+			st.strand = (t.strand == '-') ? '-' : '+';
+			st.exons = t.exons;
+			std::sort(st.exons.begin(), st.exons.end());
+			st.length = 0;
+			for(int k = 0; k < st.exons.size(); k++) st.length += st.exons[k].second - st.exons[k].first;
+			st.abundance = ln(rng);
+			sum += st.abundance;
+			trsts.push_back(st);
+		}
+	}
+
+	int k = 0;
+	for(int i = 0; i < gm.genes.size(); i++)
+	{
+		for(int j = 0; j < gm.genes[i].transcripts.size(); j++)
+		{
+			transcript &t = gm.genes[i].transcripts[j];
+			if(t.exons.size() == 0) continue;
+			trsts[k].abundance *= trsts.size() / sum;
+			t.coverage = depth * trsts[k].abundance;
+			k++;
+		}
+	}
+	return 0;
+}
+
+int read_simulator::simulate_sample(int k)
+{
+	// a fifth of the transcripts are not expressed in a sample, and
+	// the others vary log-normally (with an average of 1) around the base
+	mt19937 rng(seed * 1000003u + k + 1);
+	uniform_real_distribution<double> ur(0, 1);
+	lognormal_distribution<double> ln(-0.125, 0.5);
+	bool lr = (protocol == "pacbio_ccs" || protocol == "pacbio_sub" || protocol == "ont");
+
+	vector<sim_read> reads;
+	int64_t fid = 0;
+	for(int i = 0; i < trsts.size(); i++)
+	{
+		const sim_transcript &t = trsts[i];
+		if(ur(rng) < 0.2) continue;
+
+		double span = read_length;
+		if(protocol == "paired_end") span = insertsize;
+		if(lr == true || span > t.length) span = t.length;
+
+		double mean = depth * t.length / span * t.abundance * ln(rng);
+		if(mean <= 0) continue;
+		poisson_distribution<int> pd(mean);
+		int n = pd(rng);
+		for(int j = 0; j < n; j++) sample_fragment(t, rng, fid++, reads);
+	}
+
+	std::sort(reads.begin(), reads.end());
+
+	string file = output_dir + "/sample." + tostring(k + 1) + ".bam";
+	size_t num = reads.size();
+	if(write_bam(file, reads, k) != 0) return -1;
+	printf("sample %d: %lu alignments written to %s\n", k + 1, num, file.c_str());
+	return 0;
+}
+
+int read_simulator::sample_fragment(const sim_transcript &t, mt19937 &rng, int64_t fid, vector<sim_read> &reads)
+{
+	sim_read r;
+	r.fid = fid;
+	r.mpos = -1;
+	r.isize = 0;
+
+	// long reads span the transcript, truncated at the 5' end, and come
+	// from either strand of the cDNA whatever the library type
+	if(protocol != "paired_end" && protocol != "single_end")
+	{
+		int32_t cut = rng() % (t.length / 5 + 1);
+		int32_t a = (t.strand == '+') ? cut : 0;
+		int32_t b = (t.strand == '+') ? t.length : t.length - cut;
+		int32_t rpos;
+		int introns = build_alignment(t, a, b, r.pos, rpos, r.cigar);
+		r.tid = t.tid;
+		r.flag = (rng() % 2 == 0) ? 0 : 0x10;
+		r.xs = (introns >= 1) ? t.strand : '.';
+		reads.push_back(r);
+		return 0;
+	}
+
+	// strand of the first read of a fragment
+	bool reverse = (rng() % 2 == 0);
+	if(library_type == "fr_first") reverse = (t.strand == '+');
+	if(library_type == "fr_second") reverse = (t.strand == '-');
+
+	int32_t rl = (read_length < t.length) ? read_length : t.length;
+	if(protocol == "single_end")
+	{
+		int32_t a = rng() % (t.length - rl + 1);
+		int32_t rpos;
+		int introns = build_alignment(t, a, a + rl, r.pos, rpos, r.cigar);
+		r.tid = t.tid;
+		r.flag = reverse ? 0x10 : 0;
+		r.xs = (introns >= 1) ? t.strand : '.';
+		reads.push_back(r);
+		return 0;
+	}
+
+	normal_distribution<double> nd(insertsize, insertsize * 0.15);
+	int32_t fl = (int32_t)(nd(rng));
+	if(fl < rl) fl = rl;
+	if(fl > t.length) fl = t.length;
+	int32_t f = rng() % (t.length - fl + 1);
+
+	// the left mate is forward and the right one is reverse
+	sim_read x = r, y = r;
+	int32_t xr, yr;
+	int ix = build_alignment(t, f, f + rl, x.pos, xr, x.cigar);
+	int iy = build_alignment(t, f + fl - rl, f + fl, y.pos, yr, y.cigar);
+	x.tid = y.tid = t.tid;
+	x.xs = (ix >= 1) ? t.strand : '.';
+	y.xs = (iy >= 1) ? t.strand : '.';
+	x.flag = 0x1 | 0x2 | 0x20 | (reverse ? 0x80 : 0x40);
+	y.flag = 0x1 | 0x2 | 0x10 | (reverse ? 0x40 : 0x80);
+	x.mpos = y.pos;
+	y.mpos = x.pos;
+	x.isize = yr - x.pos;
+	y.isize = -x.isize;
+	reads.push_back(x);
+	reads.push_back(y);
+	return 0;
+}
+
+int read_simulator::build_alignment(const sim_transcript &t, int32_t a, int32_t b, int32_t &pos, int32_t &rpos, string &cigar)
+{
+	// [a, b) is in transcript coordinates, counted in genomic order
+	assert(a < b);
+	cigar = "";
+	pos = rpos = -1;
+	int introns = 0;
+	int32_t off = 0;
+	int32_t m = 0;
+	for(int k = 0; k < t.exons.size(); k++)
+	{
+		int32_t l = t.exons[k].first;
+		int32_t len = t.exons[k].second - l;
+		int32_t s = (a > off) ? a : off;
+		int32_t u = (b < off + len) ? b : off + len;
+		off += len;
+		if(s >= u) continue;
+
+		int32_t gs = l + s - (off - len);
+		int32_t ge = l + u - (off - len);
+		if(pos == -1) pos = gs;
+		else if(gs > rpos)
+		{
+			cigar += tostring(m) + "M" + tostring(gs - rpos) + "N";
+			m = 0;
+			introns++;
+		}
+		m += ge - gs;
+		rpos = ge;
+	}
+	cigar += tostring(m) + "M";
+	return introns;
+}
+
+int read_simulator::write_bam(const string &file, vector<sim_read> &reads, int k)
+{
+	// written as sam first, then converted and indexed with htslib
+	string sam = file + ".sam";
+	FILE *f = fopen(sam.c_str(), "w");
+	if(f == NULL)
+	{
+		printf("cannot open file %s\n", sam.c_str());
+		return -1;
+	}
+
+	fprintf(f, "@HD\tVN:1.6\tSO:coordinate\n");
+	for(int i = 0; i < chrms.size(); i++) fprintf(f, "@SQ\tSN:%s\tLN:%d\n", chrms[i].c_str(), chrm_lengths[i]);
+	fprintf(f, "@PG\tID:aletsch-simulate\tPN:aletsch-simulate\n");
+
+	for(int i = 0; i < reads.size(); i++)
+	{
+		const sim_read &r = reads[i];
+		fprintf(f, "s%d.%ld\t%d\t%s\t%d\t60\t%s\t%s\t%d\t%d\t*\t*\tNH:i:1",
+				k + 1, r.fid, r.flag, chrms[r.tid].c_str(), r.pos + 1, r.cigar.c_str(),
+				(r.mpos >= 0) ? "=" : "*", r.mpos + 1, r.isize);
+		if(r.xs != '.') fprintf(f, "\tXS:A:%c", r.xs);
+		fprintf(f, "\n");
+	}
+	fclose(f);
+	vector<sim_read>().swap(reads);
+
+	samFile *fin = sam_open(sam.c_str(), "r");
+	if(fin == NULL)
+	{
+		printf("cannot open file %s\n", sam.c_str());
+		return -1;
+	}
+	bam_hdr_t *hdr = sam_hdr_read(fin);
+	samFile *fout = sam_open(file.c_str(), "wb");
+	if(hdr == NULL || fout == NULL)
+	{
+		printf("cannot write file %s\n", file.c_str());
+		if(hdr != NULL) bam_hdr_destroy(hdr);
+		sam_close(fin);
+		return -1;
+	}
+
+	int e = sam_hdr_write(fout, hdr);
+	bam1_t *b = bam_init1();
+	while(e >= 0 && sam_read1(fin, hdr, b) >= 0) e = sam_write1(fout, hdr, b);
+	bam_destroy1(b);
+	bam_hdr_destroy(hdr);
+	sam_close(fout);
+	sam_close(fin);
+	remove(sam.c_str());
+
+	if(e < 0 || sam_index_build(file.c_str(), 0) < 0)
+	{
+		printf("cannot write or index file %s\n", file.c_str());
+		return -1;
+	}
+	return 0;
+}
+
+int read_simulator::write_list()
+{
+	string file = output_dir + "/input.list";
+	FILE *f = fopen(file.c_str(), "w");
+	if(f == NULL)
+	{
+		printf("cannot open file %s\n", file.c_str());
+		return -1;
+	}
+
+	for(int k = 0; k < num_samples; k++)
+	{
+		string bam = output_dir + "/sample." + tostring(k + 1) + ".bam";
+		fprintf(f, "%s %s.bai %s\n", bam.c_str(), bam.c_str(), protocol.c_str());
+	}
+	fclose(f);
+	return 0;
+}
@@ -0,0 +1,88 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#ifndef __READ_SIMULATOR_H__
+#define __READ_SIMULATOR_H__
+
+#include <string>
+#include <vector>
+#include <random>
+#include <stdint.h>
+
+#include "genome.h"
+
+using namespace std;
+
+// a transcript to sample reads from; exons are in genomic order
+class sim_transcript
+{
+public:
+	int tid;						// index of the chromosome
+	char strand;
+	vector<PI32> exons;
+	int32_t length;
+	double abundance;				// relative to the average of 1
+};
+
+// one alignment, kept until all reads of a sample are sorted
+class sim_read
+{
+public:
+	int tid;
+	int32_t pos;
+	int32_t mpos;
+	int32_t isize;
+	uint16_t flag;
+	char xs;						// strand of spliced alignments, '.' otherwise
+	int64_t fid;					// fragment, for the read name
+	string cigar;
+
+public:
+	bool operator<(const sim_read &r) const;
+};
+
+// writes sorted and indexed bam files of samples simulated from
+// annotated (or random) transcripts, and the list of them for aletsch
+class read_simulator
+{
+public:
+	read_simulator();
+
+public:
+	string output_dir;
+	string gtf_file;				// annotation to sample from, random genes if empty
+	int num_genes;					// of random genes
+	int num_chrms;					// of random genes
+	int num_samples;
+	double depth;					// average coverage of an expressed transcript
+	string protocol;				// paired_end, single_end, pacbio_ccs, pacbio_sub or ont
+	string library_type;			// unstranded, fr_first or fr_second
+	int read_length;
+	int insertsize;
+	int seed;
+	int max_threads;
+
+private:
+	vector<string> chrms;
+	vector<int32_t> chrm_lengths;
+	vector<sim_transcript> trsts;
+
+public:
+	int parse_arguments(int argc, const char **argv);
+	int print_help();
+	int resolve();
+
+private:
+	int build_random_genome(genome &gm);
+	int build_transcripts(genome &gm);
+	int simulate_sample(int k);
+	int sample_fragment(const sim_transcript &t, mt19937 &rng, int64_t fid, vector<sim_read> &reads);
+	int build_alignment(const sim_transcript &t, int32_t a, int32_t b, int32_t &pos, int32_t &rpos, string &cigar);
+	int write_bam(const string &file, vector<sim_read> &reads, int k);
+	int write_list();
+};
+
+#endif
@@ -0,0 +1,58 @@
+#!/bin/bash
+# Part of aletsch
+# (c) 2020 by Mingfu Shao, The Pennsylvania State University
+# See LICENSE for licensing.
+#
+# simulates the largest number of samples once with aletsch-simulate, then
+# assembles the first N of them with each number of threads, and collects
+# wall time and peak memory from the run reports into <work-dir>/scaling.tsv
+#
+# usage: scaling.sh <work-dir> "<sample counts>" "<thread counts>" [aletsch-simulate options]
+# e.g.:  scaling.sh scale "10 20 50 100" "1 4 16" --genes 2000 --depth 20
+
+if [ "$#" -lt 3 ]; then
+	echo "usage: $0 <work-dir> \"<sample counts>\" \"<thread counts>\" [aletsch-simulate options]"
+	exit 1
+fi
+
+dir=$1
+samples=$2
+threads=$3
+shift 3
+
+root=$(cd "$(dirname "$0")/.." && pwd)
+aletsch=${ALETSCH:-$root/aletsch}
+simulate=${ALETSCH_SIMULATE:-$root/aletsch-simulate}
+
+max=0
+for n in $samples; do
+	if [ "$n" -gt "$max" ]; then max=$n; fi
+done
+
+mkdir -p $dir
+if [ ! -s $dir/input.list ] || [ $(wc -l < $dir/input.list) -lt $max ]; then
+	$simulate -o $dir --samples $max "$@" || exit 1
+fi
+
+tsv=$dir/scaling.tsv
+printf "samples\tthreads\twall_seconds\tpeak_rss_kb\n" > $tsv
+
+for n in $samples; do
+	head -n $n $dir/input.list > $dir/list.$n
+	for t in $threads; do
+		out=$dir/$n.$t
+		# per-sample gtfs are appended to, so start from an empty directory
+		rm -rf $out.d && mkdir -p $out.d
+		$aletsch -i $dir/list.$n -o $out.gtf -d $out.d -t $t --report $out.json > $out.log 2>&1
+		if [ $? -ne 0 ] || [ ! -s $out.json ]; then
+			echo "aletsch failed with $n samples and $t threads, see $out.log"
+			continue
+		fi
+
+		# only the top-level entries start with a single tab
+		wall=$(grep -P '^\t"wall_seconds"' $out.json | sed 's/[^0-9.]//g')
+		rss=$(grep -P '^\t"peak_rss_kb"' $out.json | sed 's/[^0-9]//g')
+		printf "%s\t%s\t%s\t%s\n" $n $t $wall $rss >> $tsv
+		printf "samples = %s, threads = %s, wall = %s seconds, peak rss = %s kb\n" $n $t $wall $rss
+	done
+done
@@ -0,0 +1,330 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <sstream>
+#include <vector>
+
+#include "gtf_buffer.h"
+#include "transcript.h"
+
+static const double pow10_table[10] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+static const int64_t ipow10_table[10] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+gtf_buffer::gtf_buffer()
+{
+	fixed = false;
+	precision = 6;
+	buf.reserve(1 << 16);
+}
+
+gtf_buffer::gtf_buffer(bool f, int p)
+{
+	fixed = f;
+	precision = p;
+	buf.reserve(1 << 16);
+}
+
+int gtf_buffer::clear()
+{
+	buf.clear();
+	return 0;
+}
+
+int gtf_buffer::set_format(bool f, int p)
+{
+	fixed = f;
+	precision = p;
+	return 0;
+}
+
+int gtf_buffer::set_format(const ostream &fout)
+{
+	fixed = ((fout.flags() & ios::floatfield) == ios::fixed);
+	precision = fout.precision();
+	return 0;
+}
+
+int gtf_buffer::flush(ostream &fout)
+{
+	fout.write(buf.c_str(), buf.size());
+	buf.clear();
+	return 0;
+}
+
+gtf_buffer& gtf_buffer::operator<<(const string &s)
+{
+	buf.append(s);
+	return *this;
+}
+
+gtf_buffer& gtf_buffer::operator<<(const char *s)
+{
+	buf.append(s);
+	return *this;
+}
+
+gtf_buffer& gtf_buffer::operator<<(char c)
+{
+	buf.push_back(c);
+	return *this;
+}
+
+gtf_buffer& gtf_buffer::operator<<(int x)
+{
+	append_int(x);
+	return *this;
+}
+
+gtf_buffer& gtf_buffer::operator<<(long x)
+{
+	append_int(x);
+	return *this;
+}
+
+gtf_buffer& gtf_buffer::operator<<(unsigned int x)
+{
+	append_uint(x);
+	return *this;
+}
+
+gtf_buffer& gtf_buffer::operator<<(unsigned long x)
+{
+	append_uint(x);
+	return *this;
+}
+
+gtf_buffer& gtf_buffer::operator<<(double x)
+{
+	if(fixed == false) append_printf(x);
+	else if(append_fixed(x, precision) != 0) append_printf(x);
+	return *this;
+}
+
+int gtf_buffer::append_uint(uint64_t x)
+{
+	char s[24];
+	int n = 0;
+	do
+	{
+		s[n++] = '0' + x % 10;
+		x /= 10;
+	}
+	while(x > 0);
+	while(n > 0) buf.push_back(s[--n]);
+	return 0;
+}
+
+int gtf_buffer::append_int(int64_t x)
+{
+	if(x >= 0) return append_uint(x);
+	buf.push_back('-');
+	return append_uint(-(uint64_t)(x));
+}
+
+int gtf_buffer::append_fixed(double x, int p)
+{
+	// return -1 if x cannot be formatted exactly here; printf rounds
+	// the exact binary value, which is reproduced unless x * 10^p is
+	// within the error of the product from a tie
+	if(p < 0 || p >= 10) return -1;
+	if(std::isfinite(x) == false) return -1;
+
+	double y = fabs(x) * pow10_table[p];
+	if(y >= 2147483648.0) return -1;
+
+	double f = floor(y);
+	double d = y - f;
+	if(fabs(d - 0.5) < 1e-6) return -1;
+
+	int64_t r = (int64_t)(f) + (d > 0.5 ? 1 : 0);
+	if(r == 0 && std::signbit(x)) return -1;
+
+	if(x < 0) buf.push_back('-');
+	append_uint(r / ipow10_table[p]);
+	if(p == 0) return 0;
+
+	buf.push_back('.');
+	int64_t z = r % ipow10_table[p];
+	char s[12];
+	for(int i = p - 1; i >= 0; i--)
+	{
+		s[i] = '0' + z % 10;
+		z /= 10;
+	}
+	buf.append(s, p);
+	return 0;
+}
+
+int gtf_buffer::append_printf(double x)
+{
+	char s[512];
+	int n = 0;
+	if(fixed == true) n = snprintf(s, sizeof(s), "%.*f", precision, x);
+	else n = snprintf(s, sizeof(s), "%.*g", precision, x);
+
+	if(n < sizeof(s))
+	{
+		buf.append(s, n);
+		return 0;
+	}
+
+	// very large values in fixed-point
+	vector<char> v(n + 1);
+	snprintf(v.data(), v.size(), "%.*f", precision, x);
+	buf.append(v.data(), n);
+	return 0;
+}
+
+static int write_gtf_by_ostream(const transcript &t, ostream &fout, double cov2, int count)
+{
+	fout.precision(4);
+	fout<<fixed;
+
+	if(t.exons.size() == 0) return 0;
+
+	PI32 p = t.get_bounds();
+
+	fout<<t.seqname.c_str()<<"\t";
+	fout<<t.source.c_str()<<"\t";
+	fout<<"transcript\t";
+	fout<<p.first + 1<<"\t";
+	fout<<p.second<<"\t";
+	fout<<1000<<"\t";
+	fout<<t.strand<<"\t";
+	fout<<".\t";
+	fout<<"gene_id \""<<t.gene_id.c_str()<<"\"; ";
+	fout<<"transcript_id \""<<t.transcript_id.c_str()<<"\"; ";
+	if(t.gene_type != "") fout<<"gene_type \""<<t.gene_type.c_str()<<"\"; ";
+	if(t.transcript_type != "") fout<<"transcript_type \""<<t.transcript_type.c_str()<<"\"; ";
+	fout<<"cov \""<<t.coverage<<"\"; ";
+	if(cov2 >= -0.5) fout<<"cov2 \""<<cov2<<"\"; ";
+	if(count >= -0.5) fout<<"count \""<<count<<"\"; ";
+	fout << endl;
+
+	for(int k = 0; k < t.exons.size(); k++)
+	{
+		fout<<t.seqname.c_str()<<"\t";
+		fout<<t.source.c_str()<<"\t";
+		fout<<"exon\t";
+		fout<<t.exons[k].first + 1<<"\t";
+		fout<<t.exons[k].second<<"\t";
+		fout<<1000<<"\t";
+		fout<<t.strand<<"\t";
+		fout<<".\t";
+		fout<<"gene_id \""<<t.gene_id.c_str()<<"\"; ";
+		fout<<"transcript_id \""<<t.transcript_id.c_str()<<"\"; ";
+		fout<<"exon \""<<k + 1<<"\"; "<<endl;
+	}
+	return 0;
+}
+
+static int write_features_by_ostream(const transcript &t, ostream &fout)
+{
+	const transcript::TrstFeatures &f = t.features;
+	fout << t.transcript_id << '\t' << t.meta_tid << '\t' << t.seqname << '\t'
+		<< t.coverage << '\t' << t.cov2 << '\t' << t.abd << '\t' << t.conf << '\t'
+		<< t.count1 << '\t' << t.count2 << '\t' << t.exons.size() << '\t'
+		<< f.gr_vertices << '\t' << f.gr_edges << '\t' << f.gr_reads << '\t' << f.gr_subgraph << '\t'
+		<< f.num_vertices << '\t' << f.num_edges << '\t' << f.junc_ratio << '\t' << f.max_mid_exon_len << '\t'
+		<< f.start_loss1 << '\t' << f.start_loss2 << '\t' << f.start_loss3 << '\t'
+		<< f.end_loss1 << '\t' << f.end_loss2 << '\t' << f.end_loss3 << '\t'
+		<< f.start_merged_loss << '\t' << f.end_merged_loss << '\t'
+		<< f.introns << '\t' << f.intron_ratio << '\t' << f.start_introns << '\t' << f.start_intron_ratio << '\t'
+		<< f.end_introns << '\t' << f.end_intron_ratio << '\t' << f.uni_junc << '\t'
+		<< f.seq_min_wt << '\t' << f.seq_min_cnt << '\t' << f.seq_min_abd << '\t' << f.seq_min_ratio << '\t'
+		<< f.seq_max_wt << '\t' << f.seq_max_cnt << '\t' << f.seq_max_abd << '\t' << f.seq_max_ratio << '\t'
+		<< f.start_cnt << '\t' << f.start_weight << '\t' << f.start_abd << '\t'
+		<< f.end_cnt << '\t' << f.end_weight << '\t' << f.end_abd << '\t'
+		<< f.unbridge_start_coming_count << '\t' << f.unbridge_start_coming_ratio << '\t'
+		<< f.unbridge_end_leaving_count << '\t' << f.unbridge_end_leaving_ratio << endl;
+	return 0;
+}
+
+static double random_double()
+{
+	// mix of typical coverages, ties, tiny, negative and large values
+	int r = rand() % 8;
+	if(r == 0) return (rand() % 100000) / 10000.0;
+	if(r == 1) return (rand() % 1000) / 8.0;
+	if(r == 2) return -(rand() % 100000) / 7.0;
+	if(r == 3) return (rand() % 1000) * 1e-7;
+	if(r == 4) return (rand() % 1000) * 1e9;
+	if(r == 5) return -1e-9 * (rand() % 10);
+	return log(1.0 + rand() % 100000) * (rand() % 3);
+}
+
+int test_gtf_buffer()
+{
+	srand(7);
+	int n = 100000;
+	vector<transcript> v(n);
+	for(int i = 0; i < n; i++)
+	{
+		transcript &t = v[i];
+		t.seqname = "chr" + to_string(1 + rand() % 22);
+		t.source = "aletsch";
+		t.gene_id = "gene." + to_string(rand() % 1000) + "." + to_string(i);
+		t.transcript_id = "chr" + t.seqname + "." + t.gene_id + "." + to_string(rand() % 10);
+		t.meta_tid = t.transcript_id;
+		t.strand = "+-."[rand() % 3];
+		t.coverage = random_double();
+		t.cov2 = random_double();
+		t.conf = random_double();
+		t.abd = random_double();
+		t.count1 = rand() % 1000;
+		t.count2 = rand() % 1000;
+		t.features = transcript::TrstFeatures();
+		t.features.junc_ratio = random_double();
+		t.features.start_loss1 = random_double();
+		t.features.seq_max_wt = random_double();
+		t.features.gr_reads = rand();
+		t.features.seq_min_cnt = -rand() % 100;
+		int32_t p = rand() % 100000000;
+		int m = 1 + rand() % 12;
+		for(int k = 0; k < m; k++)
+		{
+			t.add_exon(p, p + 50 + rand() % 300);
+			p += 400 + rand() % 10000;
+		}
+	}
+
+	// GTF with fixed(4) as transcript::write, and features
+	// with the default format and with fixed(2) as in the outputs
+	stringstream s1, f1, g1;
+	g1.setf(ios::fixed, ios::floatfield);
+	g1.precision(2);
+	clock_t t0 = clock();
+	for(int i = 0; i < n; i++)
+	{
+		write_gtf_by_ostream(v[i], s1, v[i].cov2, v[i].count2);
+		write_features_by_ostream(v[i], f1);
+		write_features_by_ostream(v[i], g1);
+	}
+	clock_t t1 = clock();
+
+	gtf_buffer s2, f2, g2(true, 2);
+	for(int i = 0; i < n; i++)
+	{
+		v[i].write(s2, v[i].cov2, v[i].count2);
+		v[i].write_features(f2);
+		v[i].write_features(g2);
+	}
+	clock_t t2 = clock();
+
+	string x1 = s1.str() + f1.str() + g1.str();
+	string x2 = s2.buf + f2.buf + g2.buf;
+	bool b = (x1 == x2);
+
+	double c1 = (t1 - t0) * 1.0 / CLOCKS_PER_SEC;
+	double c2 = (t2 - t1) * 1.0 / CLOCKS_PER_SEC;
+	printf("gtf buffer: %d transcripts, %lu bytes, ostream = %.3lf sec (%.1lf MB/s), gtf_buffer = %.3lf sec (%.1lf MB/s), identical = %s\n",
+			n, x1.size(), c1, x1.size() / 1048576.0 / (c1 > 0 ? c1 : 1e-9), c2, x2.size() / 1048576.0 / (c2 > 0 ? c2 : 1e-9), b ? "true" : "false");
+	return 0;
+}
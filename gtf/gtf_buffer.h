@@ -0,0 +1,55 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#ifndef __GTF_BUFFER_H__
+#define __GTF_BUFFER_H__
+
+#include <string>
+#include <ostream>
+#include <stdint.h>
+
+using namespace std;
+
+// a reusable byte buffer for formatting GTF/TSV lines;
+// numbers are formatted the same as an ostream with the
+// given floatfield (fixed or default) and precision
+class gtf_buffer
+{
+public:
+	gtf_buffer();
+	gtf_buffer(bool fixed, int precision);
+
+public:
+	string buf;				// formatted bytes
+	bool fixed;				// fixed-point for doubles, as std::fixed
+	int precision;			// precision for doubles, as ostream::precision
+
+public:
+	int clear();
+	int set_format(bool fixed, int precision);
+	int set_format(const ostream &fout);
+	int flush(ostream &fout);
+
+	gtf_buffer& operator<<(const string &s);
+	gtf_buffer& operator<<(const char *s);
+	gtf_buffer& operator<<(char c);
+	gtf_buffer& operator<<(int x);
+	gtf_buffer& operator<<(long x);
+	gtf_buffer& operator<<(unsigned int x);
+	gtf_buffer& operator<<(unsigned long x);
+	gtf_buffer& operator<<(double x);
+
+private:
+	int append_uint(uint64_t x);
+	int append_int(int64_t x);
+	int append_fixed(double x, int p);
+	int append_printf(double x);
+};
+
+// testing
+int test_gtf_buffer();
+
+#endif
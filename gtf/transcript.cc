@@ -13,6 +13,7 @@ See LICENSE for licensing.
 #include <map>
 
 #include "transcript.h"
+#include "gtf_buffer.h"
 #include "util.h"
 
 transcript::transcript()
@@ -320,57 +321,66 @@ int transcript::write(ostream &fout, double cov2, int count) const
 	fout.precision(4);
 	fout<<fixed;
 
+	static thread_local gtf_buffer gb;
+	write(gb, cov2, count);
+	gb.flush(fout);
+	return 0;
+}
+
+int transcript::write(gtf_buffer &fout, double cov2, int count) const
+{
+	fout.set_format(true, 4);
+
 	if(exons.size() == 0) return 0;
 	
 	PI32 p = get_bounds();
 
-	fout<<seqname.c_str()<<"\t";				// chromosome name
-	fout<<source.c_str()<<"\t";					// source
+	fout<<seqname<<'\t';						// chromosome name
+	fout<<source<<'\t';							// source
 	fout<<"transcript\t";						// feature
-	fout<<p.first + 1<<"\t";					// left position
-	fout<<p.second<<"\t";						// right position
-	fout<<1000<<"\t";							// score, now as expression
-	fout<<strand<<"\t";							// strand
+	fout<<p.first + 1<<'\t';					// left position
+	fout<<p.second<<'\t';						// right position
+	fout<<"1000\t";								// score, now as expression
+	fout<<strand<<'\t';							// strand
 	fout<<".\t";								// frame
-	fout<<"gene_id \""<<gene_id.c_str()<<"\"; ";
-	fout<<"transcript_id \""<<transcript_id.c_str()<<"\"; ";
-	if(gene_type != "") fout<<"gene_type \""<<gene_type.c_str()<<"\"; ";
-	if(transcript_type != "") fout<<"transcript_type \""<<transcript_type.c_str()<<"\"; ";
+	fout<<"gene_id \""<<gene_id<<"\"; ";
+	fout<<"transcript_id \""<<transcript_id<<"\"; ";
+	if(gene_type != "") fout<<"gene_type \""<<gene_type<<"\"; ";
+	if(transcript_type != "") fout<<"transcript_type \""<<transcript_type<<"\"; ";
 	//fout<<"RPKM \""<<RPKM<<"\"; ";
 	fout<<"cov \""<<coverage<<"\"; ";
 	if(cov2 >= -0.5) fout<<"cov2 \""<<cov2<<"\"; ";
 	if(count >= -0.5) fout<<"count \""<<count<<"\"; ";
-	fout << endl;
+	fout<<'\n';
 
 	for(int k = 0; k < exons.size(); k++)
 	{
-		fout<<seqname.c_str()<<"\t";		// chromosome name
-		fout<<source.c_str()<<"\t";			// source
+		fout<<seqname<<'\t';				// chromosome name
+		fout<<source<<'\t';					// source
 		fout<<"exon\t";						// feature
-		fout<<exons[k].first + 1<<"\t";		// left position
-		fout<<exons[k].second<<"\t";		// right position
-		fout<<1000<<"\t";					// score, now as expression
-		fout<<strand<<"\t";					// strand
+		fout<<exons[k].first + 1<<'\t';		// left position
+		fout<<exons[k].second<<'\t';		// right position
+		fout<<"1000\t";						// score, now as expression
+		fout<<strand<<'\t';					// strand
 		fout<<".\t";						// frame
-		fout<<"gene_id \""<<gene_id.c_str()<<"\"; ";
-		fout<<"transcript_id \""<<transcript_id.c_str()<<"\"; ";
-		fout<<"exon \""<<k + 1<<"\"; "<<endl;
+		fout<<"gene_id \""<<gene_id<<"\"; ";
+		fout<<"transcript_id \""<<transcript_id<<"\"; ";
+		fout<<"exon \""<<k + 1<<"\"; "<<'\n';
 	}
 	return 0;
 }
 
 int transcript::write_features(ostream &stat_file) const
 {
-	/*
-    ofstream stat_file;
-    string filename;
-    if(sample_id < 0) filename = "meta.trstFeature.csv";
-    else filename = "gtf/"+ to_string(sample_id) + ".trstFeature.csv";
-    stat_file.open(filename, fstream::app);
-    stat_file.setf(ios::fixed, ios::floatfield);
-    stat_file.precision(2);
-	*/
+	static thread_local gtf_buffer gb;
+	gb.set_format(stat_file);
+	write_features(gb);
+	gb.flush(stat_file);
+	return 0;
+}
 
+int transcript::write_features(gtf_buffer &stat_file) const
+{
     stat_file << transcript_id << '\t'       // Transcript ID
         << meta_tid << '\t'         //Transcript ID in meta.gtf
         << seqname << '\t'
@@ -421,9 +431,7 @@ int transcript::write_features(ostream &stat_file) const
         << features.unbridge_start_coming_count << '\t'
         << features.unbridge_start_coming_ratio << '\t'
         << features.unbridge_end_leaving_count << '\t'
-        << features.unbridge_end_leaving_ratio << endl;
-        
-    //stat_file.close();
+        << features.unbridge_end_leaving_ratio << '\n';
     return 0;
 }
 
@@ -437,58 +445,7 @@ int transcript::write_features(int sample_id) const
     stat_file.open(filename, fstream::app);
     stat_file.setf(ios::fixed, ios::floatfield);
     stat_file.precision(2);
-    stat_file << transcript_id << '\t'       // Transcript ID
-        << meta_tid << '\t'         //Transcript ID in meta.gtf
-        << seqname << '\t'
-        << coverage << '\t'        // Meta coverage
-        << cov2 << '\t'            // Individual coverage 2 
-        << abd << '\t'             // Abundance
-        << conf << '\t'            // Confidence
-        << count1 << '\t'          // Actual count of meta trst       
-        << count2 << '\t'          // Inferred count by individual trst
-        << exons.size() << '\t'   // Number of exons
-        << features.gr_vertices << '\t'
-        << features.gr_edges << '\t'
-        << features.gr_reads << '\t'
-        << features.gr_subgraph << '\t'
-        << features.num_vertices << '\t'
-        << features.num_edges << '\t'
-        << features.junc_ratio << '\t'
-        << features.max_mid_exon_len << '\t'
-        << features.start_loss1 << '\t'
-        << features.start_loss2 << '\t'
-        << features.start_loss3 << '\t'
-        << features.end_loss1 << '\t'
-        << features.end_loss2 << '\t'
-        << features.end_loss3 << '\t'
-        << features.start_merged_loss << '\t'
-        << features.end_merged_loss << '\t'
-        << features.introns << '\t'
-        << features.intron_ratio << '\t'
-        << features.start_introns << '\t'
-        << features.start_intron_ratio << '\t'
-        << features.end_introns << '\t'
-        << features.end_intron_ratio << '\t'
-        << features.uni_junc << '\t'
-        << features.seq_min_wt << '\t'
-        << features.seq_min_cnt << '\t'
-        << features.seq_min_abd << '\t'
-        << features.seq_min_ratio << '\t'
-        << features.seq_max_wt << '\t'
-        << features.seq_max_cnt << '\t'
-        << features.seq_max_abd << '\t'
-        << features.seq_max_ratio << '\t'
-        << features.start_cnt << '\t'
-        << features.start_weight << '\t'
-        << features.start_abd << '\t'
-        << features.end_cnt << '\t'
-        << features.end_weight << '\t'
-        << features.end_abd << '\t'
-        << features.unbridge_start_coming_count << '\t'
-        << features.unbridge_start_coming_ratio << '\t'
-        << features.unbridge_end_leaving_count << '\t'
-        << features.unbridge_end_leaving_ratio << endl;
-        
+    write_features(stat_file);
     stat_file.close();
     return 0;
 }
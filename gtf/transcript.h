@@ -15,6 +15,7 @@ See LICENSE for licensing.
 #include <vector>
 #include <set>
 #include "item.h"
+#include "gtf_buffer.h"
 
 using namespace std;
 
@@ -25,6 +26,10 @@ class transcript
 public:
 	transcript(const item &ie);
 	transcript();
+	transcript(const transcript &t) = default;
+	transcript(transcript &&t) = default;
+	transcript& operator=(const transcript &t) = default;
+	transcript& operator=(transcript &&t) = default;
 	~transcript();
 
 public:
@@ -127,8 +132,10 @@ public:
 	int extend_bounds(const transcript &t);
 	string label() const;
 	int write(ostream &fout, double cov2 = -1, int count = -1) const;
+	int write(gtf_buffer &fout, double cov2 = -1, int count = -1) const;
     int write_features(int sample_id) const;
     int write_features(ostream &fout) const;
+    int write_features(gtf_buffer &fout) const;
     void write_seq_features(ofstream & stat_file, const vector<int>& v) const;
     void write_seq_features(ofstream & stat_file, const vector<double>& v) const;
 
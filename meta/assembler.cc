@@ -5,6 +5,8 @@ See LICENSE for licensing.
 */
 
 #include "assembler.h"
+#include "support_index.h"
+#include "task_group.h"
 #include "scallop.h"
 #include "graph_builder.h"
 #include "graph_cluster.h"
@@ -13,6 +15,8 @@ See LICENSE for licensing.
 #include "essential.h"
 #include "constants.h"
 #include "filter.h"
+#include "telemetry.h"
+#include "locus_trace.h"
 
 #include <fstream>
 #include <sstream>
@@ -20,12 +24,13 @@ See LICENSE for licensing.
 #include <algorithm>
 #include <thread>
 #include <ctime>
+#include <chrono>
 #include <boost/asio/post.hpp>
 #include <boost/asio/thread_pool.hpp>
 #include <boost/pending/disjoint_sets.hpp>
 
-assembler::assembler(const parameters &c, transcript_set &tm, mutex &m, int r, int g, int i)
-	: cfg(c), tmerge(tm), mylock(m), rid(r), gid(g), instance(i)
+assembler::assembler(const parameters &c, transcript_set &tm, int r, int g, int i, thread_pool *p)
+	: cfg(c), tmerge(tm), rid(r), gid(g), instance(i), pool(p)
 {
 	assert(tmerge.rid == rid);
 }
@@ -34,6 +39,15 @@ int assembler::resolve(vector<bundle*> gv)
 {
 	int subindex = 0;
 
+	// bundles were reduced to summaries when generated
+	if(cfg.summary_only == true)
+	{
+		if(gv.size() == 1) assemble_summary(*(gv[0]));
+		if(gv.size() >= 2) bridge_summaries(gv);
+		if(gv.size() >= 2) assemble_summaries(gv);
+		return 0;
+	}
+
 	for(int k = 0; k < gv.size(); k++)
 	{
 		gv[k]->build_fragments();
@@ -110,32 +124,13 @@ int assembler::assemble(bundle &bd)
 	splice_graph gr;
 	transform(bd, gr, true);
 
-    gr.reads = bd.frgs.size();
-    gr.subgraph = 1;
+	gr.reads = bd.frgs.size();
+	gr.subgraph = 1;
 
+	unordered_map<int64_t, set<int> > junc2sup;
+	unordered_map<int64_t, unordered_map<int, double>> sup2abd;
+	init_supports(gr, bd.sp.sample_id, junc2sup, sup2abd);
 
-    edge_iterator it;
-    PEEI pei = gr.edges();
-    for(it = pei.first; it != pei.second; it++)
-    {
-		edge_descriptor e = (*it);
-		int s = e->source();
-		int t = e->target();
-
-		//if(s == 0) continue;
-		//if(t == gr.num_vertices() - 1) continue;
-		//if(gr.get_vertex_info(s).rpos == gr.get_vertex_info(t).lpos) continue;//ignore non-splicing junctions
-        
-        edge_info &ei = gr.get_editable_edge_info(e);
-        assert(ei.count == 0);
-        assert(ei.samples.size() == 0);
-        assert(ei.spAbd.size() == 0);
-        ei.samples.insert(bd.sp.sample_id);
-        ei.spAbd.insert(make_pair(bd.sp.sample_id, gr.get_edge_weight(e)));
-        ei.abd = gr.get_edge_weight(e);
-        ei.count = 1;
-        //gr.set_edge_info(e, ei);
-    }
     if(cfg.verbose >= 2)
     {
         printf("\nprint individual graph %s, sample_id=%d\n", gr.gid.c_str(), bd.sp.sample_id);
@@ -144,11 +139,188 @@ int assembler::assemble(bundle &bd)
 
 	phase_set ps;
 	bd.build_phase_set(ps, gr);
-	assemble(gr, ps, bd.sp.sample_id);
+	assemble(gr, ps, bd.sp.sample_id, bd.trevise, bd.tbridge);
 	bd.clear();
 	return 0;
 }
 
+int assembler::assemble_summary(bundle &bd)
+{
+	bd.set_gid(rid, gid, instance, 0);
+	combined_graph &cb = bd.summary;
+
+	splice_graph gr;
+	cb.build_splice_graph(gr, cfg);
+	gr.gid = bd.gid;
+	gr.reads = cb.num_reads;
+	gr.subgraph = 1;
+
+	unordered_map<int64_t, set<int> > junc2sup;
+	unordered_map<int64_t, unordered_map<int, double>> sup2abd;
+	init_supports(gr, bd.sp.sample_id, junc2sup, sup2abd);
+
+	if(cfg.verbose >= 2)
+	{
+		printf("\nprint individual summary graph %s, sample_id=%d\n", gr.gid.c_str(), bd.sp.sample_id);
+		gr.print_junction_supports();
+	}
+
+	assemble(gr, cb.ps, bd.sp.sample_id, 0, bd.tbridge);
+	cb.clear();
+	return 0;
+}
+
+int assembler::combine_summaries(combined_graph &cx, vector<bundle*> gv)
+{
+	if(gv.size() == 0) return 0;
+
+	vector<combined_graph*> v;
+	for(int k = 0; k < gv.size(); k++) v.push_back(&(gv[k]->summary));
+
+	cx.copy_meta_information(gv[0]->summary);
+	cx.combine(v);
+	return 0;
+}
+
+int assembler::bridge_summaries(vector<bundle*> gv)
+{
+	assert(gv.size() >= 2);
+
+	combined_graph cx(cfg);
+	combine_summaries(cx, gv);
+
+	splice_graph gr;
+	cx.build_splice_graph(gr, cfg);
+	cx.clear();
+
+	// bridge the remaining clusters of each summary with the combined graph
+	for(int k = 0; k < gv.size(); k++)
+	{
+		combined_graph &cb = gv[k]->summary;
+		if(cb.vc.size() <= 0) continue;
+
+		bridge_solver bs(gr, cb.vc, cfg, gv[k]->sp.insertsize_low, gv[k]->sp.insertsize_high);
+
+		int cnt = 0;
+		assert(cb.vc.size() == bs.opt.size());
+		for(int j = 0; j < cb.vc.size(); j++)
+		{
+			if(bs.opt[j].type <= 0) continue;
+			cb.append(cb.vc[j], bs.opt[j]);
+			cnt++;
+		}
+
+		// merge appended regions and junctions
+		vector<combined_graph*> gz;
+		if(cnt >= 1) cb.combine(gz);
+		vector<pereads_cluster>().swap(cb.vc);
+	}
+	return 0;
+}
+
+int assembler::assemble_summaries(vector<bundle*> gv)
+{
+	assert(gv.size() >= 2);
+	int subindex = 0;
+
+	bundle bx(cfg, gv[0]->sp);
+	bx.set_gid(rid, gid, instance, subindex++);
+
+	combined_graph cx(cfg);
+	combine_summaries(cx, gv);
+
+	splice_graph gx;
+	cx.build_splice_graph(gx, cfg);
+	gx.gid = bx.gid;
+	gx.reads = cx.num_reads;
+	gx.subgraph = gv.size();
+	cx.clear();
+
+	// combined phase set 
+	phase_set px;
+
+	//junction supports and supported sample abundance
+	unordered_map<int64_t, set<int> > junc2sup;
+	unordered_map<int64_t, unordered_map<int, double>> sup2abd;
+	init_supports(gx, -1, junc2sup, sup2abd);
+
+	// names follow the order of members, not the order of completion
+	vector<splice_graph*> grv;
+	for(int k = 0; k < gv.size(); k++)
+	{
+		gv[k]->set_gid(rid, gid, instance, subindex++);
+		grv.push_back(new splice_graph());
+	}
+
+	task_group tg1(pool, gv.size(), [this, &gv, &grv](int k){ gv[k]->summary.build_splice_graph(*(grv[k]), cfg); });
+	tg1.run();
+
+	for(int k = 0; k < gv.size(); k++)
+	{
+		bundle &bd = *(gv[k]);
+		splice_graph &gr = *(grv[k]);
+		gr.gid = bd.gid;
+		gr.reads = bd.summary.num_reads;
+		gr.subgraph = gv.size();
+		init_supports(gr, bd.sp.sample_id, junc2sup, sup2abd);
+	}
+
+	// supports from all members, collected before any graph is assembled
+	vector<int> idv;
+	for(int k = 0; k < gv.size(); k++) idv.push_back(gv[k]->sp.sample_id);
+	support_index si(grv, idv, cfg);
+
+	for(int k = 0; k < gv.size(); k++)
+	{
+		bundle &bd = *(gv[k]);
+		splice_graph &gr = *(grv[k]);
+
+		fix_missing_edges(gr, gx);
+		junction_support(gr, junc2sup, sup2abd);
+		si.annotate(k);
+
+		if(cfg.verbose >= 2) 
+		{
+			printf("print %d/%lu individual summary graph %s, sample_id=%d\n", k+1, gv.size(), gr.gid.c_str(), bd.sp.sample_id);
+			gr.print_junction_supports();
+		}
+
+		start_end_support(bd.sp.sample_id, gr, gx);
+		non_splicing_support(bd.sp.sample_id, gr, gx);
+		boundary_extend(-1, gr, gx, 1);
+	}
+
+	// assemble individual summary, each into its own shard
+	for(int k = 0; k < gv.size(); k++) px.combine(gv[k]->summary.ps);
+
+	vector<transcript_set> tsv(gv.size(), transcript_set(tmerge.chrm, rid, cfg.min_single_exon_clustering_overlap));
+	task_group tg2(pool, gv.size(), [this, &gv, &grv, &tsv](int k){
+		bundle &bd = *(gv[k]);
+		assembler asmb(cfg, tsv[k], rid, gid, instance);
+		asmb.assemble(*(grv[k]), bd.summary.ps, bd.sp.sample_id, 0, bd.tbridge);
+		bd.summary.clear();
+	});
+	tg2.run();
+
+	for(int k = 0; k < gv.size(); k++) tmerge.add(tsv[k], TRANSCRIPT_COUNT_ADD_COVERAGE_ADD);
+	vector<transcript_set>().swap(tsv);
+
+	for(int k = 0; k < gv.size(); k++) delete grv[k];
+
+	double tbridge = 0;
+	for(int k = 0; k < gv.size(); k++) tbridge += gv[k]->tbridge;
+
+	junction_support(gx, junc2sup, sup2abd);
+	if(cfg.verbose >= 2) 
+	{
+		printf("print combined summary graph %s\n", gx.gid.c_str());
+		gx.print_junction_supports();
+	}
+
+	assemble(gx, px, -1, 0, tbridge);
+	return 0;
+}
+
 int assembler::combine_bundles(bundle &bx, vector<bundle*> gv)
 {
 	if(gv.size() == 0) return 0;
@@ -199,89 +371,41 @@ int assembler::assemble(vector<bundle*> gv)
     unordered_map<int64_t, unordered_map<int, double>> sup2abd;
 
     // combined support
-    edge_iterator itx;
-    PEEI peix = gx.edges();
-    for(itx = peix.first; itx != peix.second; itx++)
-    {
-        edge_descriptor e = (*itx);
-        int s = e->source();
-        int t = e->target();
-
-        edge_info & ei = gx.get_editable_edge_info(e);
-        ei.samples.clear();
-        ei.spAbd.clear();
-        ei.samples.insert(-1);
-        ei.spAbd.insert(make_pair(-1, gx.get_edge_weight(e)));
-        //printf("bx.sp.sample_id:%d\n", bx.sp.sample_id);
-        ei.abd = gx.get_edge_weight(e);
-        ei.count = 1;
-
-        if(s == 0) continue;
-        if(t == gx.num_vertices() - 1) continue;
-
-        pair<int32_t, int32_t>p0 = make_pair(gx.get_vertex_info(s).rpos, gx.get_vertex_info(t).lpos);
-        if(p0.first == p0.second) continue;//ignore non-splicing junctions
-
-		int64_t p = pack(p0.first, p0.second);
-        junc2sup[p].insert(-1);
-        
-        //pair<int64_t, int> psp = make_pair(p, -1);
-        //sup2abd[psp] += gx.get_edge_weight(e);
-        sup2abd[p].insert(make_pair(-1, gx.get_edge_weight(e)));
-    }
+    init_supports(gx, -1, junc2sup, sup2abd);
 
     //transform individual bundle to individual graph
     vector<splice_graph*> grv;
     vector<int> idv;
     size_t max_v_num = 0;
 
+    // names follow the order of members, not the order of completion
+    for(int k = 0; k < gv.size(); k++)
+    {
+        gv[k]->set_gid(rid, gid, instance, subindex++);
+        grv.push_back(new splice_graph());
+        idv.push_back(gv[k]->sp.sample_id);
+    }
+
+    task_group tg1(pool, gv.size(), [this, &gv, &grv](int k){ transform(*(gv[k]), *(grv[k]), true); });
+    tg1.run();
+
     // individual junction supports
     for(int k = 0; k < gv.size(); k++)
     {
         bundle &bd = *(gv[k]);
-        bd.set_gid(rid, gid, instance, subindex++);
-
-		splice_graph* grp = new splice_graph();
-        grv.push_back(grp);
-        splice_graph& gr = *grp; 
-        transform(bd, gr, true);
-        idv.push_back(bd.sp.sample_id);
+        splice_graph& gr = *(grv[k]); 
 
         gr.reads = bd.frgs.size();
         gr.subgraph = gv.size();
         max_v_num = max(max_v_num, gr.num_vertices());
         //printf("Graph %d, #reads: hits = %lu, frgs = %lu, gx.reads = %d\n", k+1, bd.hits.size(), bd.frgs.size(), gr.reads);
 
-        edge_iterator it;
-        PEEI pei = gr.edges();
-        for(it = pei.first; it != pei.second; it++)
-        {
-		    edge_descriptor e = (*it);
-		    int s = e->source();
-		    int t = e->target();
-
-            edge_info & ei = gr.get_editable_edge_info(e);
-            ei.samples.clear();
-            ei.spAbd.clear();
-            ei.samples.insert(bd.sp.sample_id);
-            ei.spAbd.insert(make_pair(bd.sp.sample_id, gr.get_edge_weight(e)));
-            ei.abd = gr.get_edge_weight(e);
-            ei.count = 1;
-
-            if(s == 0) continue;
-		    if(t == gr.num_vertices() - 1) continue;
-
-            pair<int32_t, int32_t> p0 = make_pair(gr.get_vertex_info(s).rpos,gr.get_vertex_info(t).lpos);
-            if(p0.first == p0.second) continue;//ignore non-splicing junctions
-			int64_t p = pack(p0.first, p0.second);
-            junc2sup[p].insert(bd.sp.sample_id);
-            
-            //pair<int64_t, int> psp = make_pair(p, bd.sp.sample_id);
-            //sup2abd[psp] += gr.get_edge_weight(e);
-            sup2abd[p].insert(make_pair(bd.sp.sample_id, gr.get_edge_weight(e)));
-        }
+        init_supports(gr, bd.sp.sample_id, junc2sup, sup2abd);
     }
 
+    // supports from all members, collected before any graph is assembled
+    support_index si(grv, idv, cfg);
+
     //append gx to grv
     grv.push_back(&gx);
     idv.push_back(-1);
@@ -292,16 +416,12 @@ int assembler::assemble(vector<bundle*> gv)
     bool assemble_merged = true;
     //if(max_v_num <= 150) assemble_merged = true;
 
-	// assemble individual bundle
+	// annotate individual graph
 	for(int k = 0; k < gv.size(); k++)
 	{
         bundle &bd = *(gv[k]);
-		//bd.set_gid(rid, gid, instance, subindex++);
-        //splice_graph gr;
-		//transform(bd, gr, true);
         splice_graph &gr = *(grv[k]);
 
-
         fix_missing_edges(gr, gx);
 
 		if(cfg.verbose >= 2) 
@@ -311,28 +431,15 @@ int assembler::assemble(vector<bundle*> gv)
         }
         //calculate junction supports based on other samples
         junction_support(gr, junc2sup, sup2abd);
-        for(int j = 0; j < gv.size(); j++)
-        {
-            bundle &bd1 = *(gv[j]);
-            //splice_graph gr1;
-            //transform(bd1, gr1, true);
-            splice_graph &gr1 = *(grv[j]);
-
-            start_end_support(bd1.sp.sample_id, gr1, gr);
-            non_splicing_support(bd1.sp.sample_id, gr1, gr);
-            boundary_extend(bd1.sp.sample_id, gr, gr1, 1);
-            boundary_extend(bd1.sp.sample_id, gr, gr1, 2);
-            boundary_extend(bd1.sp.sample_id, gr, gr1, 3);
-        }
+
+        //calculate start&end&non-splicing supports and boundary losses based on all samples
+        si.annotate(k);
 
         if(cfg.verbose >= 2) 
         {
             printf("print %d/%lu individual graph %s, sample_id=%d\n", k+1, gv.size(), gr.gid.c_str(), bd.sp.sample_id);
             gr.print_junction_supports();
         }
-		phase_set ps;
-		bd.build_phase_set(ps, gr);
-		px.combine(ps);
 
         //calculate start&end&non-splicing suppots for combined graph
         if(assemble_merged)
@@ -341,10 +448,30 @@ int assembler::assemble(vector<bundle*> gv)
             non_splicing_support(bd.sp.sample_id, gr, gx);
             boundary_extend(-1, gr, gx, 1);
         }
+	}
+
+	// phase sets are combined before assembling modifies them
+	vector<phase_set> psv(gv.size());
+	task_group tg2(pool, gv.size(), [&gv, &grv, &psv](int k){ gv[k]->build_phase_set(psv[k], *(grv[k])); });
+	tg2.run();
+	for(int k = 0; k < gv.size(); k++) px.combine(psv[k]);
 
-		assemble(gr, ps, bd.sp.sample_id);
+	// assemble individual bundle, each into its own shard
+	vector<transcript_set> tsv(gv.size(), transcript_set(tmerge.chrm, rid, cfg.min_single_exon_clustering_overlap));
+	task_group tg3(pool, gv.size(), [this, &gv, &grv, &psv, &tsv](int k){
+		bundle &bd = *(gv[k]);
+		assembler asmb(cfg, tsv[k], rid, gid, instance);
+		asmb.assemble(*(grv[k]), psv[k], bd.sp.sample_id, bd.trevise, bd.tbridge);
 		bd.clear();
-	}
+	});
+	tg3.run();
+
+	for(int k = 0; k < gv.size(); k++) tmerge.add(tsv[k], TRANSCRIPT_COUNT_ADD_COVERAGE_ADD);
+	vector<phase_set>().swap(psv);
+	vector<transcript_set>().swap(tsv);
+
+	double tbridge = 0;
+	for(int k = 0; k < gv.size(); k++) tbridge += gv[k]->tbridge;
 
     for(int k = 0; k < gv.size(); k++)
     {
@@ -367,7 +494,38 @@ int assembler::assemble(vector<bundle*> gv)
         }
 
         // assemble combined instance
-        assemble(gx, px, -1);
+        assemble(gx, px, -1, bx.trevise, tbridge);
+    }
+    return 0;
+}
+
+int assembler::init_supports(splice_graph &gr, int sid, unordered_map<int64_t, set<int> > &junc2sup, unordered_map<int64_t, unordered_map<int, double>> &sup2abd)
+{
+    edge_iterator it;
+    PEEI pei = gr.edges();
+    for(it = pei.first; it != pei.second; it++)
+    {
+        edge_descriptor e = (*it);
+        int s = e->source();
+        int t = e->target();
+
+        edge_info & ei = gr.get_editable_edge_info(e);
+        ei.samples.clear();
+        ei.spAbd.clear();
+        ei.samples.insert(sid);
+        ei.spAbd.insert(make_pair(sid, gr.get_edge_weight(e)));
+        ei.abd = gr.get_edge_weight(e);
+        ei.count = 1;
+
+        if(s == 0) continue;
+        if(t == gr.num_vertices() - 1) continue;
+
+        pair<int32_t, int32_t> p0 = make_pair(gr.get_vertex_info(s).rpos, gr.get_vertex_info(t).lpos);
+        if(p0.first == p0.second) continue;//ignore non-splicing junctions
+
+        int64_t p = pack(p0.first, p0.second);
+        junc2sup[p].insert(sid);
+        sup2abd[p].insert(make_pair(sid, gr.get_edge_weight(e)));
     }
     return 0;
 }
@@ -929,8 +1087,11 @@ int assembler::boundary_extend(int sample_id, splice_graph &gr, splice_graph &gx
 
 int assembler::transform(bundle &cb, splice_graph &gr, bool revising)
 {
+	stage_timer st(STAGE_TRANSFORM, cb.chrm);
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
 	graph_builder gb(cb, cfg, cb.sp);
 	gb.build(gr);
+	st.add_items(gr.num_vertices());
 	gr.gid = cb.gid;
 	gr.build_vertex_index();
 
@@ -940,6 +1101,7 @@ int assembler::transform(bundle &cb, splice_graph &gr, bool revising)
 		remove_false_boundaries(gr, cb, cfg);
 		refine_splice_graph(gr);
 	}
+	cb.trevise += chrono::duration<double>(chrono::steady_clock::now() - t0).count();
 	return 0;
 }
 
@@ -1072,8 +1234,14 @@ int assembler::bridge(vector<bundle*> gv)
 	return 0;
 }*/
 
-int assembler::assemble(splice_graph &gx, phase_set &px, int sid)
+int assembler::assemble(splice_graph &gx, phase_set &px, int sid, double trevise, double tbridge)
 {
+	// the input is kept for replay only while slow graphs are dumped
+	splice_graph *gc = NULL;
+	phase_set *pc = NULL;
+	if(trace_log::dumping() == true) gc = new splice_graph(gx);
+	if(trace_log::dumping() == true) pc = new phase_set(px);
+
 	gx.extend_strands();
 
 	map<int32_t, int32_t> smap, tmap;
@@ -1084,6 +1252,17 @@ int assembler::assemble(splice_graph &gx, phase_set &px, int sid)
 	hyper_set hx(gx, px);
 	hx.filter_nodes(gx);
 
+	// sizes for tracing, as scallop decomposes gx and hx in place
+	locus_trace lt;
+	if(trace_log::enabled() == true)
+	{
+		if(gx.num_vertices() >= 1) lt.lpos = gx.get_vertex_info(0).lpos;
+		if(gx.num_vertices() >= 1) lt.rpos = gx.get_vertex_info(gx.num_vertices() - 1).rpos;
+		lt.vertices = gx.num_vertices();
+		lt.edges = gx.num_edges();
+		lt.phases = hx.edges.size();
+	}
+
 	if(cfg.verbose >= 2) gx.print();
 	if(cfg.verbose >= 2) hx.print_nodes();
 
@@ -1108,30 +1287,46 @@ int assembler::assemble(splice_graph &gx, phase_set &px, int sid)
 	int k = 0;
 	gx.gid = gx.gid + "." + tostring(k);
 	scallop sx(gx, hx, pa, k == 0 ? false : true);
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
 	sx.assemble();
+	double tdecompose = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
 
-	int z = 0;
+	vector<transcript> vt;
 	for(int i = 0; i < sx.trsts.size(); i++)
 	{
 		transcript &t = sx.trsts[i];
 		if(t.exons.size() <= 1 && cfg.skip_single_exon_transcripts) continue;
-		z++;
 		t.RPKM = 0;
-		ts.add(t, 1, sid, TRANSCRIPT_COUNT_ADD_COVERAGE_ADD);
+		vt.push_back(std::move(t));
 	}
+	int z = vt.size();
+	ts.add(vt, 1, sid, TRANSCRIPT_COUNT_ADD_COVERAGE_ADD);
 
 	if(pa.verbose >= 2) printf("assemble %s: %d transcripts, graph with %lu vertices and %lu edges\n", gx.gid.c_str(), z, gx.num_vertices(), gx.num_edges());
 	if(gx.num_vertices() >= 1000) printf("assemble %s: %d transcripts, large graph with %lu vertices and %lu edges\n", gx.gid.c_str(), z, gx.num_vertices(), gx.num_edges());
 
-	//printf("try to lock in assembler\n");
-	mylock.lock();
-	//printf("locked in assembler\n");
-	//tsp.tsets.push_back(ts);
 	//printf("B: tm.rid = %d, ts.rid = %d, this->rid = %d\n", tm.rid, ts.rid, this->rid);
 	tm.add(ts, TRANSCRIPT_COUNT_ADD_COVERAGE_ADD);
-	mylock.unlock();
 	ts.clear();
 
+	if(trace_log::enabled() == true)
+	{
+		lt.gid = gx.gid;
+		lt.chrm = gx.chrm;
+		lt.strand = gx.strand;
+		lt.members = gx.subgraph;
+		lt.iterations = sx.round;
+		lt.transcripts = z;
+		lt.trevise = trevise;
+		lt.tbridge = tbridge;
+		lt.tdecompose = tdecompose;
+		if(pc != NULL) trace_log::record(lt, gc, *pc);
+		else trace_log::record(lt, gc, px);
+	}
+
+	if(gc != NULL) delete gc;
+	if(pc != NULL) delete pc;
 	return 0;
 }
 
+
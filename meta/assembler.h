@@ -22,29 +22,36 @@ typedef boost::asio::thread_pool thread_pool;
 class assembler
 {
 public:
-	assembler(const parameters &cfg, transcript_set &tmerge, mutex &mylock, int rid, int gid, int instance);
+	assembler(const parameters &cfg, transcript_set &tmerge, int rid, int gid, int instance, thread_pool *pool = NULL);
 
 public:
 	const parameters &cfg;
-	transcript_set &tmerge;
-	mutex &mylock;
+	transcript_set &tmerge;				// shard owned by the calling task
 	int rid;
 	int gid;
 	int instance;
+	thread_pool *pool;					// for assembling members of a group, may be NULL
 
 public:
 	int resolve(vector<bundle*> gv);
 	int build_similarity(vector<bundle*> &gv, vector<vector<PID>> &sim);
 	int assemble(vector<bundle*> gv);
 	int assemble(bundle &cb);
-	int assemble(splice_graph &gx, phase_set &px, int sid);
+	int assemble(splice_graph &gx, phase_set &px, int sid, double trevise = 0, double tbridge = 0);
 	int transform(bundle &cb, splice_graph &gr, bool revising);
 	int fix_missing_edges(splice_graph &gr, splice_graph &gx);
 	int bridge(vector<bundle*> gv);
 	int combine_bundles(bundle &bd, vector<bundle*> gv);
 
+	// with summaries of bundles
+	int assemble_summary(bundle &bd);
+	int assemble_summaries(vector<bundle*> gv);
+	int bridge_summaries(vector<bundle*> gv);
+	int combine_summaries(combined_graph &cx, vector<bundle*> gv);
+
     //sample support
     //int junction_support(int sample_id, splice_graph &gr, splice_graph &gx);
+    int init_supports(splice_graph &gr, int sid, unordered_map<int64_t, set<int> > &junc2sup, unordered_map<int64_t, unordered_map<int, double>> &sup2abd);
     int junction_support(splice_graph &gr, unordered_map<int64_t, set<int> > &junc2sup, unordered_map<int64_t, unordered_map<int, double>> &sup2abd);
     int start_end_support(int sample_id, splice_graph &gr, splice_graph &gx);
 	int start_end_support(vector<splice_graph*> &grv, const vector<int> &idv);
@@ -9,21 +9,28 @@ See LICENSE for licensing.
 #include "essential.h"
 #include "graph_builder.h"
 #include "graph_cluster.h"
+#include "graph_reviser.h"
 #include "bridge_solver.h"
+#include "telemetry.h"
 
 #include <sstream>
+#include <chrono>
 #include <algorithm>
 
 bundle::bundle(const parameters &c, const sample_profile &s)
-	: cfg(c), sp(s)
+	: cfg(c), sp(s), summary(c)
 {
 	num_combined = 0;
+	tbridge = 0;
+	trevise = 0;
 }
 
 bundle::bundle(const parameters &c, const sample_profile &s, bundle_base &&bb)
-	: cfg(c), sp(s), bundle_base(bb)
+	: cfg(c), sp(s), bundle_base(bb), summary(c)
 {
 	num_combined = 0;
+	tbridge = 0;
+	trevise = 0;
 }
 
 int bundle::set_gid(int instance, int subindex)
@@ -54,6 +61,8 @@ int bundle::copy_meta_information(const bundle &bb)
 
 int bundle::bridge()
 {
+	stage_timer st(STAGE_BRIDGE, chrm);
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
 	/*
 	int round = 0;
 	while(round < 2)
@@ -77,6 +86,8 @@ int bundle::bridge()
 			if(bs.opt[k].type <= 0) continue;
 			cnt += update_bridges(vc[k].frlist, bs.opt[k].chain, bs.opt[k].strand);
 		}
+		st.add_items(cnt);
+		tbridge += chrono::duration<double>(chrono::steady_clock::now() - t0).count();
 
 	/*
 		//printf("total frags %lu, bridged frags = %d\n", bb.frgs.size(), cnt);
@@ -87,6 +98,63 @@ int bundle::bridge()
 	return 0;
 }
 
+int bundle::summarize()
+{
+	build_fragments();
+	bridge();
+
+	splice_graph gr;
+	graph_builder gb(*this, cfg, sp);
+	gb.build(gr);
+	gr.gid = gid;
+	gr.build_vertex_index();
+	identify_boundaries(gr, cfg);
+	remove_false_boundaries(gr, *this, cfg);
+	refine_splice_graph(gr);
+	gr.reads = frgs.size();
+
+	phase_set ps;
+	build_phase_set(ps, gr);
+
+	// fragments left unbridged are kept as clusters to be bridged with other samples
+	vector<pereads_cluster> vc;
+	graph_cluster gc(gr, *this, cfg.max_reads_partition_gap, false);
+	gc.build_pereads_clusters(vc);
+	for(int i = 0; i < vc.size(); i++) vector<int>().swap(vc[i].frlist);
+
+	summary.clear();
+	summary.build(gr, std::move(ps), std::move(vc));
+	summary.sid = sp.sample_id;
+	summary.gid = gid;
+
+	// keep meta information and splices for grouping, drop all reads
+	bundle bx(cfg, sp);
+	bx.copy_meta_information(*this);
+	vector<int32_t> v = std::move(splices);
+	clear();
+	copy_meta_information(bx);
+	splices = std::move(v);
+	return 0;
+}
+
+size_t bundle::get_memory_size() const
+{
+	size_t s = bundle_base::get_memory_size();
+	if(summary.num_combined <= 0) return s;
+
+	s += summary.regions.capacity() * sizeof(PPDI);
+	s += summary.junctions.capacity() * sizeof(PTDI);
+	s += (summary.sbounds.capacity() + summary.tbounds.capacity()) * sizeof(PIDI);
+	s += summary.splices.capacity() * sizeof(int32_t);
+	s += summary.ps.get_memory_size();
+	for(int i = 0; i < summary.vc.size(); i++)
+	{
+		const pereads_cluster &pc = summary.vc[i];
+		s += sizeof(pereads_cluster) + (pc.chain1.size() + pc.chain2.size() + 8) * sizeof(int32_t);
+	}
+	return s;
+}
+
 int bundle::combine(const bundle &bb, bool combine_map)
 {
 	num_combined += bb.num_combined;
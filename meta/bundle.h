@@ -15,6 +15,7 @@ See LICENSE for licensing.
 #include "parameters.h"
 #include "bundle_base.h"
 #include "sample_profile.h"
+#include "combined_graph.h"
 
 using namespace std;
 
@@ -31,6 +32,9 @@ public:
 	const parameters &cfg;
 	const sample_profile &sp;
 	int num_combined;
+	double tbridge;					// seconds of bridging, for tracing
+	double trevise;					// seconds of building and revising its graph, for tracing
+	combined_graph summary;			// graph, phases and unbridged reads, when summarized
 
 public:
 	int set_gid(int instance, int subindex);
@@ -39,6 +43,8 @@ public:
 	int combine(const bundle &bb, bool combine_map);
 	int print(int k);
 	int bridge();
+	int summarize();
+	size_t get_memory_size() const;
 };
 
 #endif
@@ -9,22 +9,26 @@ See LICENSE for licensing.
 #include <fstream>
 #include "bundle_group.h"
 #include "parameters.h"
+#include "telemetry.h"
 #include <boost/asio/post.hpp>
 #include <boost/asio/thread_pool.hpp>
 
 //mutex bundle_group::gmutex;
 
-bundle_group::bundle_group(string c, char s, int r, const parameters &f, const map<string, vector<PI>> &si)
-	: cfg(f), tmerge(c, r, f.min_single_exon_clustering_overlap), sidx(si)
+bundle_group::bundle_group(string c, char s, int r, const parameters &f, const map<string, vector<PI>> &si, const vector<sample_profile> &ss)
+	: cfg(f), sidx(si), samples(ss), tmerge(c, r, f.min_single_exon_clustering_overlap)
 {
 	chrm = c;
 	strand = s;
 	rid = r;
-	num_assembled = 0;
+	gset_bytes = 0;
+	gcount = 0;
 }
 
 int bundle_group::resolve()
 {
+	stage_timer st(STAGE_GROUP, chrm);
+	st.add_items(gset.size());
 	remove_duplicates();
 	build_splice_index();
 	disjoint_set ds(gset.size());
@@ -70,21 +74,26 @@ int bundle_group::remove_duplicates()
 		int sid = bd.sp.sample_id;
 		int tid = mv[sid];
 
+		// boundaries are set only in the host of cells
+		const sample_profile &sp = samples[bd.sp.host];
+
 		if(strand == '+')
 		{
-			int32_t end = bd.sp.end1[tid][rid - 1];
+			int32_t end = sp.end1[tid][rid - 1];
 			if(bd.rpos > end) continue;
 			//printf("duplicate bundle+: rid = %d, sid = %d, tid = %d, pos:%d-%d, pre-end = %d\n", rid, sid, tid, bd.lpos, bd.rpos, end);
 			bd.clear();
 			bd.splices.clear();
+			bd.summary.clear();
 		}
 		if(strand == '-')
 		{
-			int32_t end = bd.sp.end2[tid][rid - 1];
+			int32_t end = sp.end2[tid][rid - 1];
 			if(bd.rpos > end) continue;
 			//printf("duplicate bundle-: rid = %d, sid = %d, tid = %d, pos:%d-%d, pre-end = %d\n", rid, sid, tid, bd.lpos, bd.rpos, end);
 			bd.clear();
 			bd.splices.clear();
+			bd.summary.clear();
 		}
 	}
 	return 0;
@@ -116,10 +125,35 @@ int bundle_group::clear()
 	//for(int k = 0; k < gset.size(); k++) gset[k].clear();
 	//gset.clear();
 	//vector<bundle>().swap(gset);
-	num_assembled = 0;
 	return 0;
 }
 
+int bundle_group::merge_shards(vector<transcript_set> &shards)
+{
+	reduce_transcript_sets(shards, TRANSCRIPT_COUNT_ADD_COVERAGE_ADD);
+	if(shards.size() >= 1) tmerge.add(shards[0], TRANSCRIPT_COUNT_ADD_COVERAGE_ADD);
+	vector<transcript_set>().swap(shards);
+	return 0;
+}
+
+int bundle_group::merge_shards(map<int, transcript_set> &shards)
+{
+	vector<transcript_set> v;
+	for(auto &z: shards) v.push_back(std::move(z.second));
+	map<int, transcript_set>().swap(shards);
+	return merge_shards(v);
+}
+
+transcript_set &bundle_group::get_shard(int sid)
+{
+	// the caller holds the lock of this group; references
+	// to other shards stay valid while one is inserted
+	map<int, transcript_set>::iterator it = gshards.find(sid);
+	if(it != gshards.end()) return it->second;
+	it = gshards.insert(make_pair(sid, transcript_set(chrm, rid, cfg.min_single_exon_clustering_overlap))).first;
+	return it->second;
+}
+
 int bundle_group::process_subset(const set<int> &s, disjoint_set &ds, double d)
 {
 	vector<int> ss;
@@ -25,12 +25,16 @@ typedef boost::asio::thread_pool thread_pool;
 class bundle_group
 {
 public:
-	bundle_group(string c, char s, int r, const parameters &cfg, const map<string, vector<PI>> &si);
+	bundle_group(string c, char s, int r, const parameters &cfg, const map<string, vector<PI>> &si, const vector<sample_profile> &ss);
 
 public:
 	const parameters &cfg;						// config
 	const map<string, vector<PI>> &sidx;		// sample index
+	const vector<sample_profile> &samples;		// all samples, cells read boundaries of their host
 	transcript_set tmerge;						// merged transcripts
+	vector<transcript_set> tshards;				// transcripts of each assembly task
+	map<int, transcript_set> gshards;			// single-exon transcripts of each sample, created on first use
+	int gcount;									// number of bundles assembled into gshards
 	vector<bundle> gset;						// given graphs
 	vector<join_interval_map> jmaps;			// join interval maps for all bundles
 	vector<vector<int>> gvv;					// merged graphs
@@ -38,7 +42,7 @@ public:
 	string chrm;								// chrm name
 	char strand;								// strandness
 	int rid;									// group id
-	int num_assembled;							// instance increasing
+	size_t gset_bytes;							// approximate bytes held by gset
 
 private:
 	MISI sindex;				// splice index
@@ -49,6 +53,9 @@ public:
 	int resolve();
 	int print();
 	int clear();
+	int merge_shards(vector<transcript_set> &shards);
+	int merge_shards(map<int, transcript_set> &shards);
+	transcript_set &get_shard(int sid);
 
 private:
 	int remove_duplicates();
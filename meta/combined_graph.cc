@@ -16,6 +16,8 @@ combined_graph::combined_graph(const parameters &c)
 	: cfg(c)
 {
 	num_combined = 0;
+	num_reads = 0;
+	sid = -1;
 	strand = '?';
 }
 
@@ -41,6 +43,7 @@ int combined_graph::build(splice_graph &gr, phase_set &&p, vector<pereads_cluste
 	chrm = gr.chrm;
 	strand = gr.strand;
 	num_combined = 1;
+	num_reads = gr.reads;
 
 	build_regions(gr);
 	build_start_bounds(gr);
@@ -153,8 +156,6 @@ int combined_graph::combine(combined_graph *cb)
 
 int combined_graph::combine(vector<combined_graph*> &gv)
 {
-	if(gv.size() == 0) return 0;
-
 	/*
 	chrm = gv[0]->chrm;
 	strand = gv[0]->strand;
@@ -181,6 +182,7 @@ int combined_graph::combine(vector<combined_graph*> &gv)
 		gt->combine_end_bounds(mt);
 		ps.combine(gt->ps);
 		num_combined += gt->num_combined;
+		num_reads += gt->num_reads;
 	}
 
 	regions.clear();
@@ -404,8 +406,7 @@ int combined_graph::build_splice_graph(splice_graph &gr, const parameters &cfg)
 		double w = sbounds[i].second.first;
 		int c = sbounds[i].second.second;
 
-		assert(gr.lindex.find(p) != gr.lindex.end());
-		int k = gr.lindex[p];
+		int k = gr.locate_lbound(p);
 		assert(k >= 1);
 		edge_descriptor e = gr.add_edge(0, k);
 		edge_info ei;
@@ -422,8 +423,8 @@ int combined_graph::build_splice_graph(splice_graph &gr, const parameters &cfg)
 		double w = tbounds[i].second.first;
 		int c = tbounds[i].second.second;
 
-		assert(gr.rindex.find(p) != gr.rindex.end());
-		int k = gr.rindex[p];
+		int k = gr.locate_rbound(p);
+		assert(k != -1);
 		assert(k < gr.num_vertices() - 1);
 		edge_descriptor e = gr.add_edge(k, gr.num_vertices() - 1);
 		edge_info ei;
@@ -445,10 +446,9 @@ int combined_graph::build_splice_graph(splice_graph &gr, const parameters &cfg)
 		int c = junctions[i].second.second;
 
 		// asserted?
-		if(gr.rindex.find(p.first) == gr.rindex.end()) continue;
-		if(gr.lindex.find(p.second) == gr.lindex.end()) continue;
-		int s = gr.rindex[p.first];
-		int t = gr.lindex[p.second];
+		int s = gr.locate_rbound(p.first);
+		int t = gr.locate_lbound(p.second);
+		if(s == -1 || t == -1) continue;
 		assert(s < t);
 		edge_descriptor e = gr.add_edge(s, t);
 		edge_info ei;
@@ -861,6 +861,7 @@ int combined_graph::compare_two_junctions(PTDI &x, PTDI &y, int xt, int yt)
 int combined_graph::clear()
 {
 	num_combined = 0;
+	num_reads = 0;
 	sid = -1;
 	gid = "";
 	chrm = "";
@@ -870,8 +871,8 @@ int combined_graph::clear()
 	junctions.clear();
 	sbounds.clear();
 	tbounds.clear();
-	ps.pmap.clear();
-	vc.clear();
+	ps.clear();
+	vector<pereads_cluster>().swap(vc);
 	return 0;
 }
 
@@ -909,7 +910,7 @@ int combined_graph::print(int index)
 	}
 
 	printf("combined-graph %d: sid = %d, gid = %s, #combined = %d, chrm = %s, strand = %c, range = %d-%d, junc = %d-%d, #regions = %lu, #sbounds = %lu, #tbounds = %lu, #junctions = %lu, #phases = %lu, #pereads = %lu / %d\n", 
-			index, sid, gid.c_str(), num_combined, chrm.c_str(), strand, sb, tb, lj, rj, regions.size(), sbounds.size(), tbounds.size(), junctions.size(), ps.pmap.size(), vc.size(), pereads);
+			index, sid, gid.c_str(), num_combined, chrm.c_str(), strand, sb, tb, lj, rj, regions.size(), sbounds.size(), tbounds.size(), junctions.size(), ps.size(), vc.size(), pereads);
 
 	return 0;
 
@@ -37,6 +37,7 @@ public:
 	string chrm;
 	char strand;
 	int num_combined;
+	int num_reads;
 
 	vector<PPDI> regions;
 	vector<PTDI> junctions;
@@ -61,7 +62,7 @@ public:
 	// compare combined graphs with splices
 	int get_overlapped_splice_positions(const vector<int32_t> &v) const;
 
-	// combine children
+	// combine children (with no children, merge appended elements)
 	int combine(combined_graph *cb);
 	int combine(vector<combined_graph*> &gv);
 	int combine_regions(split_interval_double_map &imap) const;
@@ -0,0 +1,112 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#include "cost_model.h"
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <algorithm>
+
+task_cost::task_cost()
+{
+	rid = -1;
+	strand = '.';
+	index = -1;
+	members = 0;
+	hits = 0;
+	intervals = 0;
+	splices = 0;
+	predicted = 0;
+	actual = 0;
+}
+
+int task_cost::add(const bundle &bd)
+{
+	// one of each pair is zero, depending on whether bundles are summarized
+	members++;
+	hits += bd.hits.size() + bd.summary.num_reads;
+	intervals += std::distance(bd.mmap.begin(), bd.mmap.end()) + bd.summary.regions.size();
+	sv.insert(sv.end(), bd.splices.begin(), bd.splices.end());
+	return 0;
+}
+
+double task_cost::predict()
+{
+	sort(sv.begin(), sv.end());
+	splices = unique(sv.begin(), sv.end()) - sv.begin();
+	vector<int32_t>().swap(sv);
+
+	// reads are bridged and counted once, while each member graph,
+	// of a size growing with the distinct splices, is decomposed
+	double s = splices;
+	predicted = hits + 4.0 * intervals + 2.0 * members * s * log2(2.0 + s);
+	return predicted;
+}
+
+cost_model::cost_model()
+{}
+
+int cost_model::record(const task_cost &c)
+{
+	rlock.lock();
+	records.push_back(c);
+	rlock.unlock();
+	return 0;
+}
+
+int cost_model::print()
+{
+	if(records.size() == 0) return 0;
+
+	// seconds per unit of cost fitted through the origin,
+	// and the correlation between predicted and actual time
+	double n = records.size();
+	double sp = 0, sa = 0, spp = 0, saa = 0, spa = 0, tp = 0, ta = 0;
+	for(int i = 0; i < records.size(); i++)
+	{
+		double p = records[i].predicted;
+		double a = records[i].actual;
+		sp += p;
+		sa += a;
+		spp += p * p;
+		saa += a * a;
+		spa += p * a;
+		if(p > tp) tp = p;
+		if(a > ta) ta = a;
+	}
+
+	double scale = (spp > 0) ? spa / spp : 0;
+	double vp = spp - sp * sp / n;
+	double va = saa - sa * sa / n;
+	double r = (vp > 0 && va > 0) ? (spa - sp * sa / n) / sqrt(vp * va) : 0;
+
+	printf("assembly tasks = %lu, total time = %.2lf seconds, max time = %.2lf seconds, max predicted = %.0lf, seconds per unit = %.3le, correlation = %.3lf\n",
+			records.size(), sa, ta, tp, scale, r);
+	return 0;
+}
+
+int cost_model::write(const string &file)
+{
+	if(file == "") return 0;
+
+	ofstream fout(file.c_str());
+	if(fout.fail())
+	{
+		printf("cannot open cost-log-file %s\n", file.c_str());
+		return -1;
+	}
+
+	fout << "chrm\trid\tstrand\tindex\tmembers\thits\tintervals\tsplices\tpredicted\tactual\n";
+	for(int i = 0; i < records.size(); i++)
+	{
+		const task_cost &c = records[i];
+		fout << c.chrm << "\t" << c.rid << "\t" << c.strand << "\t" << c.index << "\t" << c.members << "\t";
+		fout << c.hits << "\t" << c.intervals << "\t" << c.splices << "\t";
+		fout << c.predicted << "\t" << c.actual << "\n";
+	}
+	fout.close();
+	return 0;
+}
@@ -0,0 +1,61 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#ifndef __COST_MODEL_H__
+#define __COST_MODEL_H__
+
+#include "bundle.h"
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+// cheap features of a set of bundles to be assembled together,
+// and the time predicted from them and actually taken
+class task_cost
+{
+public:
+	task_cost();
+
+public:
+	string chrm;				// chrm of the bundles
+	int rid;					// region id
+	char strand;				// strand of the bundles
+	int index;					// index of the group in its region
+	int members;				// number of bundles
+	int64_t hits;				// number of hits (or summarized reads)
+	int64_t intervals;			// number of matched intervals (or summarized regions)
+	int splices;				// number of distinct splice positions
+	double predicted;			// predicted cost, in units of hits
+	double actual;				// seconds taken
+
+private:
+	vector<int32_t> sv;			// splice positions of added bundles
+
+public:
+	int add(const bundle &bd);
+	double predict();
+};
+
+// records of assembly tasks, for calibrating the prediction
+class cost_model
+{
+public:
+	cost_model();
+
+private:
+	mutex rlock;
+	vector<task_cost> records;
+
+public:
+	int record(const task_cost &c);
+	int print();
+	int write(const string &file);
+};
+
+#endif
@@ -11,7 +11,6 @@ See LICENSE for licensing.
 #include <boost/asio/post.hpp>
 #include <boost/asio/thread_pool.hpp>
 #include <boost/pending/disjoint_sets.hpp>
-#include <sys/resource.h>
 #include <unistd.h>
 #include <htslib/bgzf.h>
 
@@ -23,21 +22,28 @@ See LICENSE for licensing.
 #include "essential.h"
 #include "hyper_set.h"
 #include "assembler.h"
+#include "bundle_cache.h"
+#include "telemetry.h"
 
-void check_memory_usage() {
-    struct rusage usage;
-    getrusage(RUSAGE_SELF, &usage);
-    printf("Memory usage: %ld kilobytes\n", usage.ru_maxrss);
+hit_stream::hit_stream()
+{
+	hid = 0;
 }
 
-generator::generator(sample_profile &s, vector<bundle> &v, const parameters &c, int tid, int rid)
-	: vcb(v), cfg(c), sp(s), target_id(tid), region_id(rid)
+generator::generator(sample_profile &s, const vector<sample_profile*> &vc, vector<vector<bundle>> &v, const parameters &c, int tid, int rid)
+	: cfg(c), sp(s), cells(vc), target_id(tid), region_id(rid), vcbs(v)
 {
 	index = 0;
-	//sp.open_align_file();
-	sfn = sam_open(sp.align_file.c_str(), "r");
-	hdr = sam_hdr_read(sfn);
-	idx = sam_index_load(sfn, sp.index_file.c_str());
+	assert(cells.size() == vcbs.size());
+	if(sp.barcode_tag != "")
+	{
+		for(int k = 0; k < cells.size(); k++) barcodes.insert(make_pair(cells[k]->barcode, k));
+	}
+	// the bam is opened in resolve, unless bundles are loaded from the cache
+	sfn = NULL;
+	hdr = NULL;
+	idx = NULL;
+	cache = NULL;
 }
 
 generator::~generator()
@@ -51,12 +57,32 @@ generator::~generator()
 int generator::resolve()
 {
 	if(target_id < 0 || region_id < 0) return 0;
+	stage_timer st(STAGE_GENERATE);
 
-	int index = 0;
-	bundle_base bb1;
-	bundle_base bb2;
+	// replay the bundles saved by a previous run
+	bundle_cache bc(cfg, sp, cells);
+	if(bc.open(sp, target_id, region_id, chrm) == true)
+	{
+		st.set_chrm(chrm);
+		int c = 0, k = 0;
+		bundle_base bb;
+		while(bc.next(bb, c, k) == true) build(bb, c, k);
+		bc.close();
+		if(cfg.verbose >= 2) printf("load target %d, region %d of %s from bundle cache\n", target_id, region_id, sp.align_file.c_str());
+		return 0;
+	}
 
-	int hid = 0;
+	//sp.open_align_file();
+	sfn = sam_open(sp.align_file.c_str(), "r");
+	sample_profile::attach_thread_pool(sfn);
+	hdr = sam_hdr_read(sfn);
+	idx = sam_index_load(sfn, sp.index_file.c_str());
+	chrm = string(hdr->target_name[target_id]);
+	st.set_chrm(chrm);
+	if(bc.enabled() == true) cache = &bc;
+
+	int index = 0;
+	vector<hit_stream> hss(cells.size());
 
 	int32_t start1 = sp.start1[target_id][region_id];
 	int32_t start2 = sp.start2[target_id][region_id] + 1;
@@ -67,12 +93,12 @@ int generator::resolve()
 	//hts_itr_t *iter = sam_itr_queryi(idx, target_id, start1, start2);
 	//if(iter == NULL) return 0;
 
-	int32_t pre_lpos = -1;
-	int32_t pre_rpos = -1;
-
+	int hid = 0;
 	int32_t rrpos = 0;
+	if(cfg.bam_readahead == true) sp.prefetch_region(target_id, region_id + 1);
 	if(bgzf_seek(sfn->fp.bgzf, offt, SEEK_SET) < 0) printf("Failed to seek to offseti %ld\n", offt);
     bam1_t *b1t = bam_init1();
+	cigar_walker cw;
 	//while(sam_itr_next(sfn, iter, b1t) >= 0)
     while(sam_read1(sfn, hdr, b1t) >= 0)
 	{
@@ -90,135 +116,131 @@ int generator::resolve()
 		if(p.qual < cfg.min_mapping_quality) continue;								// ignore hits with small quality
 		if(p.n_cigar < 1) continue;													// should never happen
 
-		hit ht(b1t, hid++);
-		if(fabs(ht.pos - ht.rpos) >= cfg.max_read_span) continue;								// skip long hit
-		if(((p.flag & 0x8) <= 0) && fabs(ht.pos - ht.mpos) >= cfg.max_read_span) continue;
+		int c = locate_cell(b1t);
+		if(c < 0) continue;															// barcode not in whitelist
 
-		if(ht.pos == pre_lpos && ht.rpos == pre_rpos) continue;
+		hit_stream &hs = hss[c];
+		const sample_profile &sc = *(cells[c]);
+		bundle_base &bb1 = hs.bb1;
+		bundle_base &bb2 = hs.bb2;
 
-		pre_lpos = ht.pos;
-		pre_rpos = ht.rpos;
+		cw.walk(b1t);
+		hit ht(b1t, hs.hid++, cw);
+		hid++;
+		if(fabs(ht.pos - ht.rpos) >= cfg.max_read_span) continue;								// skip long hit
+		if(((p.flag & 0x8) <= 0) && fabs(ht.pos - ht.mpos) >= cfg.max_read_span) continue;
 
 		ht.set_tags(b1t);
-		ht.set_strand(sp.library_type);
+		ht.set_strand(sc.library_type);
 		//ht.print();
 
 		// truncate
 		if(bb1.hits.size() >= 1 && (ht.tid != bb1.tid || ht.pos > bb1.rpos + cfg.min_bundle_gap))
 		{
 			if(bb1.rpos > rrpos) rrpos = bb1.rpos;
-			generate(bb1, index);
+			generate(bb1, c, index);
 			bb1.clear();
 			index++;
-			/*
-			if(ht.pos >= sp.region_partition_length * (1 + region_id) && term1 == false)
-			{
-				term1 = true;
-				new_start1 = ht.pos;
-			}
-			*/
-		}
-
-		/*
-		if(bb1.hits.size() <= 0 && ht.pos >= sp.region_partition_length * (1 + region_id) && term1 == false) 
-		{
-			term1 = true;
-			new_start1 = ht.pos;
 		}
-		*/
 
 		if(bb2.hits.size() >= 1 && (ht.tid != bb2.tid || ht.pos > bb2.rpos + cfg.min_bundle_gap))
 		{
 			if(bb2.rpos > rrpos) rrpos = bb2.rpos;
-			generate(bb2, index);
+			generate(bb2, c, index);
 			bb2.clear();
 			index++;
-			/*
-			if(ht.pos >= sp.region_partition_length * (1 + region_id) && term2 == false)
-			{
-				term2 = true;
-				new_start2 = ht.pos;
-			}
-			*/
-		}
-		/*
-		if(bb2.hits.size() <= 0 && ht.pos >= sp.region_partition_length * (1 + region_id) && term2 == false) 
-		{
-			term2 = true;
-			new_start2 = ht.pos;
 		}
-		*/
-
-		//if(term1 == true && term2 == true) break;
 
 		// add hit
 		if(cfg.uniquely_mapped_only == true && ht.nh != 1) continue;
-		if(sp.library_type != UNSTRANDED && ht.strand == '+' && ht.xs == '-') continue;
-		if(sp.library_type != UNSTRANDED && ht.strand == '-' && ht.xs == '+') continue;
-		//if(sp.library_type == UNSTRANDED && sp.bam_with_xs == 1 && ht.xs == '.') continue;
-		if(sp.library_type != UNSTRANDED && ht.strand == '.' && ht.xs != '.') ht.strand = ht.xs;
-
-		if(sp.library_type != UNSTRANDED && ht.strand == '+') bb1.add_hit_intervals(ht, b1t);
-		if(sp.library_type != UNSTRANDED && ht.strand == '-') bb2.add_hit_intervals(ht, b1t);
-		//if(sp.library_type != UNSTRANDED && ht.strand == '+' && ht.pos >= start1 && term1 == false) bb1.add_hit_intervals(ht, b1t);
-		//if(sp.library_type != UNSTRANDED && ht.strand == '-' && ht.pos >= start2 && term2 == false) bb2.add_hit_intervals(ht, b1t);
-
-		//if(sp.library_type == UNSTRANDED && ht.pos >= start1 && term1 == false) bb1.add_hit_intervals(ht, b1t);
-
-		if(sp.library_type == UNSTRANDED && ht.xs == '+') bb1.add_hit_intervals(ht, b1t);
-		if(sp.library_type == UNSTRANDED && ht.xs == '-') bb2.add_hit_intervals(ht, b1t);
-		//if(sp.library_type == UNSTRANDED && ht.xs == '+' && ht.pos >= start1 && term1 == false) bb1.add_hit_intervals(ht, b1t);
-		//if(sp.library_type == UNSTRANDED && ht.xs == '-' && ht.pos >= start2 && term2 == false) bb2.add_hit_intervals(ht, b1t);
-		if(sp.library_type == UNSTRANDED && ht.xs == '.') 
+		if(sc.library_type != UNSTRANDED && ht.strand == '+' && ht.xs == '-') continue;
+		if(sc.library_type != UNSTRANDED && ht.strand == '-' && ht.xs == '+') continue;
+		//if(sc.library_type == UNSTRANDED && sc.bam_with_xs == 1 && ht.xs == '.') continue;
+		if(sc.library_type != UNSTRANDED && ht.strand == '.' && ht.xs != '.') ht.strand = ht.xs;
+
+		if(sc.library_type != UNSTRANDED && ht.strand == '+') bb1.add_hit_intervals(ht, cw, cfg.max_duplicates);
+		if(sc.library_type != UNSTRANDED && ht.strand == '-') bb2.add_hit_intervals(ht, cw, cfg.max_duplicates);
+
+		if(sc.library_type == UNSTRANDED && ht.xs == '+') bb1.add_hit_intervals(ht, cw, cfg.max_duplicates);
+		if(sc.library_type == UNSTRANDED && ht.xs == '-') bb2.add_hit_intervals(ht, cw, cfg.max_duplicates);
+		if(sc.library_type == UNSTRANDED && ht.xs == '.') 
 		{
-			bool b = ht.contain_splices(b1t);
-			//if(b == false && ht.pos >= start1 && term1 == false) bb1.add_hit_intervals(ht, b1t);
-			//if(b == false && ht.pos >= start2 && term2 == false) bb2.add_hit_intervals(ht, b1t);
-			if(b == false) bb1.add_hit_intervals(ht, b1t);
-			if(b == false) bb2.add_hit_intervals(ht, b1t);
+			bool b = ht.contain_splices(cw);
+			if(b == false) bb1.add_hit_intervals(ht, cw, cfg.max_duplicates);
+			if(b == false) bb2.add_hit_intervals(ht, cw, cfg.max_duplicates);
 		}
 	}
 
-	if(bb1.rpos > rrpos) rrpos = bb1.rpos;
-	if(bb2.rpos > rrpos) rrpos = bb2.rpos;
-	generate(bb1, index++);
-	generate(bb2, index++);
-	bb1.clear();
-	bb2.clear();
+	for(int c = 0; c < hss.size(); c++)
+	{
+		hit_stream &hs = hss[c];
+		if(hs.bb1.rpos > rrpos) rrpos = hs.bb1.rpos;
+		if(hs.bb2.rpos > rrpos) rrpos = hs.bb2.rpos;
+		generate(hs.bb1, c, index++);
+		generate(hs.bb2, c, index++);
+		hs.bb1.clear();
+		hs.bb2.clear();
+	}
 
     bam_destroy1(b1t);
+	st.add_items(hid);
 
-    //check_memory_usage();
 	//hts_itr_destroy(iter);
-    //check_memory_usage();
 
-	if(cfg.verbose >= 2) printf("generate target %d, region %d, start/end = %d/%d, rrpos = %d, hid = %d\n", 
-			target_id, region_id, start1, end1, rrpos, hid);
+	if(cfg.verbose >= 2) printf("generate target %d, region %d, start/end = %d/%d, rrpos = %d, hid = %d, cells = %lu\n", 
+			target_id, region_id, start1, end1, rrpos, hid, cells.size());
+
+	if(cache != NULL) cache->save(sp, target_id, region_id, chrm);
+	cache = NULL;
 
 	//if(term1 && region_id < sp.start1[target_id].size()) sp.end1[target_id][region_id] = new_start1;
 	//if(term2 && region_id < sp.start2[target_id].size()) sp.end2[target_id][region_id] = new_start2;
 	return 0;
 }
 
-int generator::generate(bundle_base &bb, int index)
+int generator::locate_cell(bam1_t *b)
+{
+	if(sp.barcode_tag == "") return 0;
+
+	uint8_t *p = bam_aux_get(b, sp.barcode_tag.c_str());
+	if(p == NULL || (*p) != 'Z') return -1;
+
+	auto it = barcodes.find(string(bam_aux2Z(p)));
+	if(it == barcodes.end()) return -1;
+	return it->second;
+}
+
+int generator::generate(bundle_base &bb, int c, int index)
 {
 	if(bb.tid < 0) return 0;
-	char buf[1024];
-	strcpy(buf, hdr->target_name[bb.tid]);
 	bb.add_buf_intervals();
 	bb.splices = bb.hcst.get_splices();
 
 	if(cfg.skip_single_exon_transcripts && bb.splices.size() <= 0) return 0;
 
+	if(cache != NULL) cache->add(bb, c, index);
+	return build(bb, c, index);
+}
+
+int generator::build(bundle_base &bb, int c, int index)
+{
+	stage_timer st(STAGE_BUILD, chrm);
+	st.add_items(1);
+	sample_profile &sp = *(cells[c]);
+	vector<bundle> &vcb = vcbs[c];
+
 	vcb.emplace_back(bundle(cfg, sp, std::move(bb)));
 	bundle &bd = vcb.back();
 	//bundle bd(cfg, sp, std::move(bb));
-	bd.chrm = string(buf);
+	bd.chrm = chrm;
 	bd.gid = "gene." + tostring(sp.sample_id) + "." + tostring(index);
 	bd.compute_strand(sp.library_type);
 	//bd.build_fragments();
 	//bd.bridge();
 
+	// reads of spliced bundles are not kept until assembly
+	if(cfg.summary_only == true && bd.splices.size() >= 1) bd.summarize();
+
 	//if(bd.splices.size() != bd.fcst.get_splices().size()) printf("hcst splices = %lu, fcst splices = %lu\n", bd.splices.size(), bd.fcst.get_splices().size());
 
 	//if(bd.splices.size() >= 1) vcb.emplace_back(std::move(bd));
@@ -262,16 +284,16 @@ int generator::partition(splice_graph &gr, phase_set &ps, vector<pereads_cluster
 
 	// group with phase_set, do not use
 	/*
-	for(MVII::const_iterator it = ps.pmap.begin(); it != ps.pmap.end(); it++)
+	for(int i = 0; i < ps.pids.size(); i++)
 	{
-		const vector<int> &v = it->first;
+		vector<int32_t> v;
+		ps.get_path(ps.pids[i], v);
 		assert(v.size() % == 0);
 		assert(v.size() >= 2);
 		
-		assert(gr.lindex.find(v.front()) != gr.lindex.end());
-		assert(gr.rindex.find(v.back()) != gr.rindex.end());
-		int kl = gr.lindex[v.front()];
-		int kr = gr.rindex[v.back()];
+		int kl = gr.locate_lbound(v.front());
+		int kr = gr.locate_rbound(v.back());
+		assert(kl != -1 && kr != -1);
 		ds.union_set(kl, kr);
 	}
 	*/
@@ -285,10 +307,9 @@ int generator::partition(splice_graph &gr, phase_set &ps, vector<pereads_cluster
 		int x = gr.locate_vertex(p1);
 		int y = gr.locate_vertex(p2);
 		*/
-		assert(gr.rindex.find(ub[i].extend[1]) != gr.rindex.end());
-		assert(gr.lindex.find(ub[i].extend[2]) != gr.lindex.end());
-		int x = gr.rindex[ub[i].extend[1]];
-		int y = gr.lindex[ub[i].extend[2]];
+		int x = gr.locate_rbound(ub[i].extend[1]);
+		int y = gr.locate_lbound(ub[i].extend[2]);
+		assert(x != -1 && y != -1);
 		ds.union_set(x, y);
 	}
 
@@ -338,26 +359,27 @@ int generator::partition(splice_graph &gr, phase_set &ps, vector<pereads_cluster
 	}
 
 	psv.resize(vv.size());
-	for(MVII::iterator it = ps.pmap.begin(); it != ps.pmap.end(); it++)
+	vector<int32_t> v;
+	for(int i = 0; i < ps.pids.size(); i++)
 	{
-		const vector<int> &v = it->first;
+		ps.get_path(ps.pids[i], v);
 		assert(v.size() % 2 == 0);
 		if(v.size() <= 1) continue;
 		
-		assert(gr.lindex.find(v.front()) != gr.lindex.end());
-		assert(gr.rindex.find(v.back()) != gr.rindex.end());
-		int j = gr.lindex[v.front()];
+		assert(gr.locate_rbound(v.back()) != -1);
+		int j = gr.locate_lbound(v.front());
+		assert(j != -1);
 		int p = ds.find_set(j);
 		assert(m.find(p) != m.end());
 		int k = m[p];
 		assert(k >= 0 && k < vv.size());
-		psv[k].add(v, it->second);
+		psv[k].add(v, ps.get_count(ps.pids[i]));
 	}
 
 	ubv.resize(vv.size());
 	for(int i = 0; i < ub.size(); i++)
 	{
-		int x = gr.rindex[ub[i].extend[1]];
+		int x = gr.locate_rbound(ub[i].extend[1]);
 		int p = ds.find_set(x);
 		int k = m[p];
 		assert(k >= 0 && k < vv.size());
@@ -11,6 +11,7 @@ See LICENSE for licensing.
 #include <fstream>
 #include <string>
 #include <mutex>
+#include <unordered_map>
 #include <boost/asio/post.hpp>
 #include <boost/asio/thread_pool.hpp>
 #include <boost/pending/disjoint_sets.hpp>
@@ -22,16 +23,29 @@ See LICENSE for licensing.
 #include "sample_profile.h"
 #include "transcript_set.h"
 #include "bundle_group.h"
+#include "bundle_cache.h"
 #include "parameters.h"
 
 using namespace std;
 
 typedef boost::asio::thread_pool thread_pool;
 
+// bundles being built for one sample (a cell in a barcoded bam)
+class hit_stream
+{
+public:
+	hit_stream();
+
+public:
+	bundle_base bb1;
+	bundle_base bb2;
+	int hid;
+};
+
 class generator
 {
 public:
-	generator(sample_profile &sp, vector<bundle> &vcb, const parameters &c, int target_id, int region_id);
+	generator(sample_profile &sp, const vector<sample_profile*> &cells, vector<vector<bundle>> &vcbs, const parameters &c, int target_id, int region_id);
 	~generator();
 
 private:
@@ -39,18 +53,24 @@ private:
 	hts_idx_t *idx;
 	samFile *sfn;
 	bam_hdr_t *hdr;
-	sample_profile &sp;
+	sample_profile &sp;						// the sample that owns the bam file
+	const vector<sample_profile*> &cells;	// samples read from the bam, routed by barcode
+	unordered_map<string, int> barcodes;	// barcode to index of cells
 	int target_id;
 	int region_id;
+	string chrm;							// name of target_id
+	bundle_cache *cache;					// saving generated bundles, if enabled
 	mutex vcb_mutex;
-	vector<bundle> &vcb;
+	vector<vector<bundle>> &vcbs;			// bundles of each cell
 	int index;
 
 public:
 	int resolve();
 
 private:
-	int generate(bundle_base &bb, int index);
+	int locate_cell(bam1_t *b);
+	int generate(bundle_base &bb, int c, int index);
+	int build(bundle_base &bb, int c, int index);
 	int partition(splice_graph &gr, phase_set &hs, vector<pereads_cluster> &ub, vector<splice_graph> &grv, vector<phase_set> &hsv, vector< vector<pereads_cluster> > &ubv);
 	bool regional(splice_graph &gr, phase_set &ps, vector<pereads_cluster> &vc);
 };
@@ -14,19 +14,28 @@ See LICENSE for licensing.
 #include "essential.h"
 #include "constants.h"
 #include "previewer.h"
+#include "gtf_buffer.h"
+#include "bundle_cache.h"
+#include "telemetry.h"
+#include "locus_trace.h"
 
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <algorithm>
+#include <chrono>
 
 incubator::incubator(vector<parameters> &v)
-	: params(v), tpool(params[DEFAULT].max_threads), gmutex(99999), tmutex(99999)
+	: params(v), tpool(params[DEFAULT].max_threads), tqueue(tpool), gmutex(99999)
 {
+	inflight_bytes = 0;
+	peak_inflight_bytes = 0;
+	num_delayed_batches = 0;
+
 	if(params[DEFAULT].profile_only == true) return;
 
-	meta_gtf.open(params[DEFAULT].output_gtf_file.c_str(), std::ofstream::out | std::ofstream::app);
-	if(meta_gtf.fail())
+	bool bgzf = params[DEFAULT].output_bgzf;
+	if(meta_gtf.open(params[DEFAULT].output_gtf_file, bgzf, bgzf, true) != 0)
 	{
 		printf("cannot open output-gtf-file %s\n", params[DEFAULT].output_gtf_file.c_str());
 		exit(0);
@@ -41,13 +50,23 @@ incubator::~incubator()
 
 int incubator::resolve()
 {
+	if(params[DEFAULT].report_file != "") telemetry::enable();
+	trace_log::init(params[DEFAULT]);
 	read_bam_list();
 	build_sample_index();
 
+	// decompression threads shared by all bam readers
+	sample_profile::init_thread_pool(params[DEFAULT].bam_threads);
+
 	init_samples();
 	//printf("finish init-samples\n");
 
-	if(params[DEFAULT].profile_only == true) return 0;
+	if(params[DEFAULT].profile_only == true)
+	{
+		sample_profile::free_thread_pool();
+		telemetry::write(params[DEFAULT].report_file);
+		return 0;
+	}
 
 	init_bundle_groups();
 	//printf("finish init-bundle-groups\n");
@@ -58,25 +77,27 @@ int incubator::resolve()
 	//for(int k = 0; k < samples.size(); k++) samples[k].open_align_file();
 
 	time_t mytime;
-	for(auto &x: sindex)
-	{
-		string chrm = x.first;
-		int m = ceil(get_max_region(chrm) * 1.0 / params[DEFAULT].batch_partition_size);
-		//int m = get_max_region(chrm);
-		for(int k = 0; k < m; k++)
-		{
-			generate_merge_assemble(chrm, k);
-		}
-	}
+	generate_merge_assemble();
 	tpool.join();
 
+	trace_log::print_slowest();
+	trace_log::close();
+
+	if(params[DEFAULT].verbose >= 1) costs.print();
+	costs.write(params[DEFAULT].cost_log_file);
+
 	mytime = time(NULL);
 	printf("postprocess and write assembled transcripts, %s", ctime(&mytime));
 	postprocess();
 
+	// close before the compression threads are released
+	meta_gtf.close();
+
 	mytime = time(NULL);
 	printf("free samples, %s", ctime(&mytime));
 	free_samples();
+	sample_profile::free_thread_pool();
+	telemetry::write(params[DEFAULT].report_file);
 	return 0;
 }
 
@@ -98,7 +119,9 @@ int incubator::read_bam_list()
 		char align_file[10240];
 		char index_file[10240];
 		char type[10240];
-		sstr >> align_file >> index_file >> type;
+		char tag[10240] = "";
+		char whitelist[10240] = "";
+		sstr >> align_file >> index_file >> type >> tag >> whitelist;
 		sp.align_file = align_file;
 		sp.index_file = index_file;
 		if(string(type) == "paired_end") sp.data_type = PAIRED_END;
@@ -108,11 +131,65 @@ int incubator::read_bam_list()
 		if(string(type) == "ont") sp.data_type = ONT;
 		assert(sp.data_type != DEFAULT);
 		assert(sp.sample_id == samples.size());
-		samples.push_back(sp);
+
+		if(string(tag) == "")
+		{
+			sp.cells.push_back(sp.sample_id);
+			samples.push_back(sp);
+			continue;
+		}
+
+		// a barcoded bam: each barcode in the whitelist is a sample,
+		// and the first of them reads the bam for all
+		vector<string> v = read_barcode_whitelist(whitelist);
+		if(v.size() == 0) printf("no barcodes in whitelist %s, skip %s\n", whitelist, align_file);
+		if(v.size() == 0) continue;
+
+		int host = samples.size();
+		for(int k = 0; k < v.size(); k++)
+		{
+			sample_profile sc(samples.size(), params[DEFAULT].region_partition_length);
+			sc.align_file = sp.align_file;
+			sc.index_file = sp.index_file;
+			sc.data_type = sp.data_type;
+			sc.barcode_tag = tag;
+			sc.barcode = v[k];
+			sc.host = host;
+			samples.push_back(sc);
+			samples[host].cells.push_back(sc.sample_id);
+		}
+		if(params[DEFAULT].verbose >= 1) printf("barcoded bam %s with tag %s: %lu cells as samples %d-%lu\n", align_file, tag, v.size(), host, samples.size() - 1);
 	}
 	return 0;
 }
 
+vector<string> incubator::read_barcode_whitelist(const string &file)
+{
+	vector<string> v;
+	ifstream fin(file.c_str());
+	if(fin.fail())
+	{
+		printf("cannot open barcode whitelist %s\n", file.c_str());
+		exit(0);
+	}
+
+	// the first field of each line; duplicates are ignored
+	set<string> s;
+	char line[10240];
+	while(fin.getline(line, 10240, '\n'))
+	{
+		stringstream sstr(line);
+		string x;
+		sstr >> x;
+		if(x == "") continue;
+		if(s.find(x) != s.end()) continue;
+		s.insert(x);
+		v.push_back(x);
+	}
+	fin.close();
+	return v;
+}
+
 int incubator::init_samples()
 {
 	if(samples.size() <= 0) return 0;
@@ -121,6 +198,7 @@ int incubator::init_samples()
 	for(int i = 0; i < samples.size(); i++)
 	{
 		sample_profile &sp = samples[i];
+		if(sp.host != i) continue;
 		set<int> tlist = get_target_list(i);
 		boost::asio::post(pool, [this, &sp] {	
 			const parameters &cfg = this->params[sp.data_type];
@@ -145,11 +223,21 @@ int incubator::init_samples()
 				if(sp.data_type == PAIRED_END) pre.infer_insertsize();
 			}
 			//sp.read_index_iterators(); 
+			bundle_cache bc(cfg, sp, vector<sample_profile*>());
+			if(bc.load_boundaries(sp) == true) return;
 			sp.set_batch_boundaries(cfg.min_bundle_gap, cfg.max_read_span);
+			bc.save_boundaries(sp);
 		});
 	}
 	pool.join();
 
+	// cells share the profile and regions of their host
+	for(int i = 0; i < samples.size(); i++)
+	{
+		if(samples[i].host == i) continue;
+		samples[i].share_profile(samples[samples[i].host]);
+	}
+
 	// post process previewed profile, to allow
 	// for samples with fewer reads to borrow 
 	// profiles from samples with more reads
@@ -200,14 +288,57 @@ int incubator::free_samples()
 	for(int i = 0; i < samples.size(); i++) 
 	{
 		samples[i].free_index_iterators();
+		samples[i].close_prefetch_file();
 		//samples[i].free_align_headers();
 	}
 	return 0;
 }
 
+int incubator::add_target(const string &s, bam_hdr_t *hdr, map<string, vector<PI32>> &m)
+{
+	// a target is a chrm name, or chrm:start-end (1-based, inclusive);
+	// the whole string is looked up in the header first, so that names
+	// containing ':' resolve; a whole chrm is kept as [0, INT32_MAX);
+	// return -1 if s is not a (non-empty) region of the header
+	PI32 p(0, INT32_MAX);
+	int tid = bam_name2id(hdr, s.c_str());
+	if(tid < 0)
+	{
+		int beg = 0, end = INT32_MAX;
+		const char *q = hts_parse_reg(s.c_str(), &beg, &end);
+		if(q == NULL) return -1;
+		string chrm = s.substr(0, q - s.c_str());
+		tid = bam_name2id(hdr, chrm.c_str());
+		if(tid < 0) return -1;
+		p = PI32(beg, end);
+	}
+
+	if(p.first >= p.second) return -1;
+	m[string(hdr->target_name[tid])].push_back(p);
+	return 0;
+}
+
+int incubator::merge_targets(map<string, vector<PI32>> &m)
+{
+	// sort and merge the intervals of each chrm
+	for(auto &z: m)
+	{
+		vector<PI32> &v = z.second;
+		sort(v.begin(), v.end());
+		vector<PI32> vv;
+		for(int k = 0; k < v.size(); k++)
+		{
+			if(vv.size() >= 1 && v[k].first <= vv.back().second) vv.back().second = max(vv.back().second, v[k].second);
+			else vv.push_back(v[k]);
+		}
+		v = vv;
+	}
+	return 0;
+}
+
 int incubator::build_sample_index()
 {
-	set<string> ss;
+	vector<string> targets;
 	if(params[DEFAULT].chrm_list_file != "")
 	{
 		ifstream fin(params[DEFAULT].chrm_list_file.c_str());
@@ -217,7 +348,7 @@ int incubator::build_sample_index()
 		while(fin.getline(line, 10240, '\n'))
 		{
 			if(string(line) == "") continue;
-			ss.insert(string(line));
+			targets.push_back(string(line));
 		}
 		fin.close();
 	}
@@ -228,19 +359,43 @@ int incubator::build_sample_index()
 		for(int i = 0; i < v.size(); i++)
 		{
 			if(v[i] == "") continue;
-			ss.insert(v[i]);
+			targets.push_back(v[i]);
 		}
 	}
 
+	vector<bool> found(targets.size(), false);
 	sindex.clear();
 	for(int i = 0; i < samples.size(); i++)
 	{
 		sample_profile &sp = samples[i];
+
+		// cells follow the targets of their host, without opening the bam again
+		if(sp.host != i)
+		{
+			for(auto &z: sindex)
+			{
+				int k = get_chrm_index(z.first, sp.host);
+				if(k >= 0) z.second.push_back(PI(i, k));
+			}
+			continue;
+		}
+
 		sp.open_align_file();
+
+		// targets are resolved against the header of each bam
+		map<string, vector<PI32>> ss;
+		for(int j = 0; j < targets.size(); j++)
+		{
+			if(add_target(targets[j], sp.hdr, ss) == 0) found[j] = true;
+		}
+		merge_targets(ss);
+
+		sp.target_regions.clear();
 		for(int k = 0; k < sp.hdr->n_targets; k++)
 		{
 			string chrm(sp.hdr->target_name[k]);
-			if(ss.size() >= 1 && ss.find(chrm) == ss.end()) continue;
+			if(targets.size() >= 1 && ss.find(chrm) == ss.end()) continue;
+			if(targets.size() >= 1) sp.target_regions.insert(make_pair(k, ss[chrm]));
 
 			if(sindex.find(chrm) == sindex.end())
 			{
@@ -255,6 +410,12 @@ int incubator::build_sample_index()
 		}
 		sp.close_align_file();
 	}
+
+	for(int j = 0; j < targets.size(); j++)
+	{
+		if(found[j] == true) continue;
+		printf("ignore target %s, which is not a region of any alignment file\n", targets[j].c_str());
+	}
 	return 0;
 }
 
@@ -291,8 +452,9 @@ int incubator::get_max_region(string chrm)
 	for(auto &z: sindex[chrm])
 	{
 		//printf("get max-region: chrm = %s, z.first = %d, z.second = %d, samples[z.first].start1[z.second].size = %lu\n", chrm.c_str(), z.first, z.second, samples[z.first].start1[z.second].size());
-		if(max_region < samples[z.first].start1[z.second].size()) 
-			max_region = samples[z.first].start1[z.second].size();
+		const sample_profile &sp = samples[samples[z.first].host];
+		if(max_region < sp.start1[z.second].size()) 
+			max_region = sp.start1[z.second].size();
 	}
 	return max_region;
 }
@@ -309,9 +471,9 @@ int incubator::init_bundle_groups()
 		printf("init bundle graph for chrm %s, partitions = %d\n", chrm.c_str(), m);
 		for(int k = 0; k < m; k++)
 		{
-			grps.emplace_back(bundle_group(chrm, '+', k, params[DEFAULT], sindex));
-			grps.emplace_back(bundle_group(chrm, '-', k, params[DEFAULT], sindex));
-			grps.emplace_back(bundle_group(chrm, '.', k, params[DEFAULT], sindex));
+			grps.emplace_back(bundle_group(chrm, '+', k, params[DEFAULT], sindex, samples));
+			grps.emplace_back(bundle_group(chrm, '-', k, params[DEFAULT], sindex, samples));
+			grps.emplace_back(bundle_group(chrm, '.', k, params[DEFAULT], sindex, samples));
 		}
 	}
 	return 0;
@@ -343,275 +505,304 @@ int incubator::get_bundle_group(string chrm, int rid)
 	return -1;
 }
 
-int incubator::generate_merge_assemble(string chrm, int gid)
+batch_state::batch_state(const string &c, int g, int n, int b)
+	: chrm(c), gid(g), curlocks(n * b), posted(b, false)
+{
+}
+
+int incubator::get_sample_slot(string chrm, int sid)
 {
-	if(sindex.find(chrm) == sindex.end()) return 0;
+	assert(sindex.find(chrm) != sindex.end());
 	const vector<PI> &v = sindex[chrm];
-	if(v.size() == 0) return 0;
+	for(int i = 0; i < v.size(); i++)
+	{
+		if(v[i].first == sid) return i;
+	}
+	assert(false);
+	return -1;
+}
 
-	int batch_size = params[DEFAULT].batch_partition_size;
+int incubator::generate_merge_assemble()
+{
+	// batches of all chrms in order; up to max_active_batches of them,
+	// possibly from different chrms, are generated and assembled together
+	vector<pair<string, int>> batches;
+	for(auto &x: sindex)
+	{
+		string chrm = x.first;
+		if(x.second.size() == 0) continue;
+		int m = ceil(get_max_region(chrm) * 1.0 / params[DEFAULT].batch_partition_size);
+		for(int k = 0; k < m; k++) batches.push_back(make_pair(chrm, k));
+	}
 
-	vector<mutex> curlocks(v.size() * batch_size);
-	for(int k = 0; k < curlocks.size(); k++) curlocks[k].lock();
+	int max_active = params[DEFAULT].max_active_batches;
+	if(max_active < 1) max_active = 1;
 
-	for(int j = 0; j < batch_size; j++)
+	int next = 0;
+	bool delayed = false;
+	list<batch_state> active;
+	while(next < batches.size() || active.size() >= 1)
 	{
-		for(int i = 0; i < v.size(); i++)
+		int64_t x = inflight_bytes;
+		if(x > peak_inflight_bytes) peak_inflight_bytes = x;
+		clear_completed_groups();
+
+		// under max_memory, a new batch is admitted only if the bundles
+		// held by the active ones fit; one batch is always allowed
+		while(next < batches.size() && active.size() < max_active)
 		{
-			int sid = v[i].first;
-			int tid = v[i].second;
-			//sample_profile &sp = samples[sid];
+			if(active.size() >= 1 && within_memory_budget() == false)
+			{
+				if(delayed == false && params[DEFAULT].verbose >= 1)
+				{
+					printf("delay batch %d of chrm %s, in-flight bundles = %.1lf MB, max-memory = %d MB\n", 
+							batches[next].second, batches[next].first.c_str(), inflight_bytes / 1048576.0, params[DEFAULT].max_memory);
+				}
+				if(delayed == false) num_delayed_batches++;
+				delayed = true;
+				break;
+			}
+			delayed = false;
 
-			int rid = gid * batch_size + j;
-			mutex &curlock = curlocks[i * batch_size + j];
+			const string &chrm = batches[next].first;
+			int gid = batches[next].second;
+			active.emplace_back(chrm, gid, sindex[chrm].size(), params[DEFAULT].batch_partition_size);
+			admit_batch(active.back());
+			next++;
+		}
 
-			sample_profile &sp = samples[sid];
-			if(rid >= sp.start1[tid].size() || sp.start1[tid][rid] >= sp.end1[tid][rid])
+		bool progress = false;
+		for(auto it = active.begin(); it != active.end(); )
+		{
+			if(assemble_batch(*it) == false)
 			{
-				curlock.unlock();
+				it++;
 				continue;
 			}
-
-			time_t mytime = time(NULL);
-			//printf("generate chrm %s, gid = %d, rid = %d, %s", chrm.c_str(), gid, rid, ctime(&mytime));
-			boost::asio::post(this->tpool, [this, &curlock, sid, chrm, tid, rid]{ 
-					this->generate(sid, tid, rid, chrm, curlock); 
-			});
+			it = active.erase(it);
+			progress = true;
 		}
-	}
 
-	//for(int k = 0; k < curlocks.size(); k++) curlocks[k].lock();
+		if(progress == false) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
 
-	// print start/end positions
-	/*
-	for(int i = 0; i < v.size(); i++)
+	if(params[DEFAULT].verbose >= 1)
 	{
-		int sid = v[i].first;
-		int tid = v[i].second;
-		for(int j = 0; j < batch_size; j++)
-		{
-			int rid = gid * batch_size + j;
-			if(rid >= samples[sid].start1[tid].size()) continue;
-			if(rid >= samples[sid].start2[tid].size()) continue;
-			printf("sample %d, tid = %d, rid = %d, strand +, expected end = %d, actual end = %d\n", sid, tid, rid, samples[sid].start1[tid][rid] + samples[sid].region_partition_length, samples[sid].end1[tid][rid]);
-			printf("sample %d, tid = %d, rid = %d, strand -, expected end = %d, actual end = %d\n", sid, tid, rid, samples[sid].start2[tid][rid] + samples[sid].region_partition_length, samples[sid].end2[tid][rid]);
-		}
+		printf("peak in-flight bundles = %.1lf MB, max-memory = %d MB, delayed batches = %d\n", 
+				peak_inflight_bytes / 1048576.0, params[DEFAULT].max_memory, num_delayed_batches);
 	}
-	*/
+	return 0;
+}
 
-	vector<bool> posted(batch_size, false);
-	while(true)
-	{
-		for(int k = 0; k < grps.size(); k++)
-		{
-			bundle_group &g = grps[k];
-			if(g.gset.size() <= 0) continue;
+bool incubator::within_memory_budget()
+{
+	if(params[DEFAULT].max_memory <= 0) return true;
+	int64_t x = inflight_bytes;
+	if(x < (int64_t)(params[DEFAULT].max_memory) * 1048576) return true;
+	return false;
+}
 
-			bool b = true;
-			if(g.completed.size() <= 0) b = false;
-			for(int i = 0; i < g.completed.size(); i++)
-			{
-				if(g.completed[i] != 1) b = false;
-				if(b == false) break;
-			}
-			if(b == false) continue;
+int incubator::admit_batch(batch_state &b)
+{
+	const string &chrm = b.chrm;
+	const vector<PI> &v = sindex[chrm];
+	int batch_size = params[DEFAULT].batch_partition_size;
 
-			printf("clear gset of bundle-graph %d, gset.size = %lu\n", k, g.gset.size());
-			g.gset.clear();
-			vector<bundle>().swap(g.gset);
-			//for(int i = 0; i < g.completed.size(); i++) g.completed[i] = 2;
-			printf("finish clear gset of bundle-graph %d\n", k);
-		}
+	for(int k = 0; k < b.curlocks.size(); k++) b.curlocks[k].lock();
 
-		for(int j = 0; j < batch_size; j++)
+	for(int j = 0; j < batch_size; j++)
+	{
+		for(int i = 0; i < v.size(); i++)
 		{
-			if(posted[j] == true) continue;
+			int sid = v[i].first;
+			int tid = v[i].second;
 
-			//bool succeed0 = true;
-			bool succeed1 = true;
-			//vector<bool> ck0(v.size(), false);
-			vector<bool> ck1(v.size(), false);
+			// cells are generated, and unlocked, by their host
+			sample_profile &sp = samples[sid];
+			if(sp.host != sid) continue;
 
-			/*
-			if(j >= 1)
+			int rid = b.gid * batch_size + j;
+			vector<mutex*> curlocks;
+			for(int c = 0; c < sp.cells.size(); c++)
 			{
-				for(int i = 0; i < v.size(); i++) 
-				{
-					ck0[i] = curlocks[i * batch_size + j - 1].try_lock();
-					if(ck0[i] == false) succeed0 = false;
-				}
+				int slot = (sp.cells[c] == sid) ? i : get_sample_slot(chrm, sp.cells[c]);
+				curlocks.push_back(&(b.curlocks[slot * batch_size + j]));
 			}
-			*/
 
-			for(int i = 0; i < v.size(); i++) 
+			if(rid >= sp.start1[tid].size() || sp.start1[tid][rid] >= sp.end1[tid][rid])
 			{
-				ck1[i] = curlocks[i * batch_size + j].try_lock();
-				if(ck1[i] == false) succeed1 = false;
+				for(int c = 0; c < curlocks.size(); c++) curlocks[c]->unlock();
+				continue;
 			}
 
-			//printf("test j: succeed0 = %c, succeed1 = %c\n", succeed0 ? 'T' : 'F', succeed1 ? 'T' : 'F');
+			boost::asio::post(this->tpool, [this, curlocks, sid, chrm, tid, rid]{ 
+					this->generate(sid, tid, rid, chrm, curlocks); 
+			});
+		}
+	}
+	return 0;
+}
+
+bool incubator::assemble_batch(batch_state &b)
+{
+	// post the assembly of each region whose generation
+	// has finished in all samples; return true if all posted
+	const string &chrm = b.chrm;
+	const vector<PI> &v = sindex[chrm];
+	int batch_size = params[DEFAULT].batch_partition_size;
+
+	for(int j = 0; j < batch_size; j++)
+	{
+		if(b.posted[j] == true) continue;
 
-			//if(succeed0 && succeed1)
-			if(succeed1)
+		bool succeed = true;
+		vector<bool> ck(v.size(), false);
+		for(int i = 0; i < v.size(); i++) 
+		{
+			ck[i] = b.curlocks[i * batch_size + j].try_lock();
+			if(ck[i] == false) succeed = false;
+		}
+
+		if(succeed)
+		{
+			int rid = b.gid * batch_size + j;
+			int bi = this->get_bundle_group(chrm, rid);
+			if(bi >= 0)
 			{
-				int rid = gid * batch_size + j;
-				int bi = this->get_bundle_group(chrm, rid);
-				if(bi >= 0)
+				for(int i = 0; i < 3; i++)
 				{
-					for(int i = 0; i < 3; i++)
-					{
-						bundle_group &g = this->grps[bi + i];
-						time_t mytime = time(NULL);
-						//printf("assemble chrm %s, gid = %d, rid = %d, bi = %d, %s", chrm.c_str(), gid, rid, bi, ctime(&mytime));
-						boost::asio::post(this->tpool, [this, &g, bi, rid, i]{ 
-								g.resolve(); 
-								this->assemble(g, rid, i);
-								g.clear();
-						});
-					}
+					bundle_group &g = this->grps[bi + i];
+					task_cost c;
+					for(int k = 0; k < g.gset.size(); k++) c.add(g.gset[k]);
+					this->tqueue.post(c.predict(), [this, &g, bi, rid, i]{ 
+							g.resolve(); 
+							this->assemble(g, rid, i);
+							g.clear();
+					});
 				}
-				posted[j] = true;
-			}
-
-			for(int i = 0; i < v.size(); i++) 
-			{
-				//if(j >= 1 && ck0[i] == true) curlocks[i * batch_size + j - 1].unlock();
-				if(j >= 0 && ck1[i] == true) curlocks[i * batch_size + j - 0].unlock();
 			}
+			b.posted[j] = true;
 		}
 
-		bool all_posted = true;
-		for(int j = 0; j < posted.size(); j++)
+		for(int i = 0; i < v.size(); i++) 
 		{
-			if(posted[j] == false) all_posted = false;
+			if(ck[i] == true) b.curlocks[i * batch_size + j].unlock();
 		}
-		
-		if(all_posted == true) break;
 	}
 
-	//for(int k = 0; k < samples.size(); k++) samples[k].close_align_file();
-	return 0;
+	for(int j = 0; j < b.posted.size(); j++)
+	{
+		if(b.posted[j] == false) return false;
+	}
+	return true;
 }
 
-int incubator::generate(int sid, int tid, int rid, string chrm, mutex &curlock)
-{	
-	sample_profile &sp = samples[sid];
-	/*
-	int cid = get_chrm_index(chrm, sid);
-	//printf("sp.start1[cid].size = %lu, sid = %d, rid = %d, tid = %d, cid = %d, chrm = %s\n", sp.start1[cid].size(), sid, rid, tid, cid, chrm.c_str());
-
-	if(rid >= sp.start1[cid].size()) 
+int incubator::clear_completed_groups()
+{
+	for(int k = 0; k < grps.size(); k++)
 	{
-		//printf("unlock rid = %d\n", rid);
-		curlock.unlock();
-		return 0;
-	}
-	*/
+		bundle_group &g = grps[k];
+		if(g.gset.size() <= 0) continue;
 
-	vector<bundle> v;
-	//transcript_set ts(chrm, params[DEFAULT].min_single_exon_clustering_overlap);
+		bool b = true;
+		if(g.completed.size() <= 0) b = false;
+		for(int i = 0; i < g.completed.size(); i++)
+		{
+			if(g.completed[i] != 1) b = false;
+			if(b == false) break;
+		}
+		if(b == false) continue;
 
-	//printf("in generating sid = %d, tid = %d, rid = %d, chrm = %s, cid = %d, regions = %lu\n", sid, tid, rid, chrm.c_str(), cid, sp.start1[cid].size());
-	int bi = get_bundle_group(chrm, rid);
-	assert(bi != -1);
+		printf("clear gset of bundle-graph %d, gset.size = %lu, gset.bytes = %lu\n", k, g.gset.size(), g.gset_bytes);
+		inflight_bytes -= g.gset_bytes;
+		g.gset_bytes = 0;
+		g.gset.clear();
+		vector<bundle>().swap(g.gset);
+		printf("finish clear gset of bundle-graph %d\n", k);
 
-	generator gt(sp, v, params[sp.data_type], tid, rid);
-	gt.resolve();
+		// all assembly tasks of g are done; merge their shards
+		boost::asio::post(this->tpool, [&g]{ g.merge_shards(g.tshards); });
+	}
+	return 0;
+}
 
-	//save_transcript_set(ts, tlock);
+int incubator::generate(int sid, int tid, int rid, string chrm, const vector<mutex*> &curlocks)
+{	
+	sample_profile &sp = samples[sid];
+	assert(curlocks.size() == sp.cells.size());
 
-	gmutex[bi + 0].lock();
-	for(int k = 0; k < v.size(); k++)
-	{
-		if(v[k].strand == '+' && v[k].splices.size() >= 1) grps[bi + 0].gset.emplace_back(std::move(v[k]));
-	}
-	gmutex[bi + 0].unlock();
+	// one stream of bundles for each cell read from this bam
+	vector<sample_profile*> cells;
+	for(int c = 0; c < sp.cells.size(); c++) cells.push_back(&(samples[sp.cells[c]]));
+	vector<vector<bundle>> vv(cells.size());
 
-	gmutex[bi + 1].lock();
-	for(int k = 0; k < v.size(); k++)
-	{
-		if(v[k].strand == '-' && v[k].splices.size() >= 1) grps[bi + 1].gset.emplace_back(std::move(v[k]));
-	}
-	gmutex[bi + 1].unlock();
+	generator gt(sp, cells, vv, params[sp.data_type], tid, rid);
+	gt.resolve();
 
-	gmutex[bi + 2].lock();
-	for(int k = 0; k < v.size(); k++)
+	for(int c = 0; c < cells.size(); c++)
 	{
-		if(v[k].strand == '.' && v[k].splices.size() >= 1) grps[bi + 2].gset.emplace_back(std::move(v[k]));
+		collect(sp.cells[c], rid, chrm, vv[c], *(curlocks[c]));
 	}
-	gmutex[bi + 2].unlock();
 
-	curlock.unlock();
+	printf("finish generating tid = %d, rid = %d, of sample %s\n", tid, rid, sp.align_file.c_str());
+	return 0;
+}
 
-	mutex mtx;
-	transcript_set ts0(chrm, rid, params[DEFAULT].min_single_exon_clustering_overlap);
-	transcript_set ts1(chrm, rid, params[DEFAULT].min_single_exon_clustering_overlap);
-	transcript_set ts2(chrm, rid, params[DEFAULT].min_single_exon_clustering_overlap);
+int incubator::collect(int sid, int rid, string chrm, vector<bundle> &v, mutex &curlock)
+{
+	int bi = get_bundle_group(chrm, rid);
+	assert(bi != -1);
 
-	int index = 0;
-	int cnt0 = 0, cnt1 = 0, cnt2 = 0;
-	for(int k = 0; k < v.size(); k++)
+	// spliced bundles go to the group; single-exon bundles of this
+	// sample go to its own shards, created (under the lock) only when
+	// needed; they are indexed first, as moved bundles lose splices
+	const char strands[3] = {'+', '-', '.'};
+	transcript_set *tss[3] = {NULL, NULL, NULL};
+	vector<int> singles[3];
+	for(int s = 0; s < 3; s++)
 	{
-		if(v[k].splices.size() >= 1) continue;
-
-		assert(v[k].splices.size() <= 0);
-
-		if(v[k].strand == '+')
-		{
-			assembler asmb(params[DEFAULT], ts0, mtx, rid, sid, index++);
-			asmb.assemble(v[k]);
-			cnt0++;
-		}
-		if(v[k].strand == '-')
+		bundle_group &g = grps[bi + s];
+		gmutex[bi + s].lock();
+		for(int k = 0; k < v.size(); k++)
 		{
-			assembler asmb(params[DEFAULT], ts1, mtx, rid, sid, index++);
-			asmb.assemble(v[k]);
-			cnt1++;
-		}
-		if(v[k].strand == '.')
-		{
-			assembler asmb(params[DEFAULT], ts2, mtx, rid, sid, index++);
-			asmb.assemble(v[k]);
-			cnt2++;
+			if(v[k].strand != strands[s]) continue;
+			if(v[k].splices.size() <= 0)
+			{
+				singles[s].push_back(k);
+				continue;
+			}
+			size_t bytes = v[k].get_memory_size();
+			g.gset_bytes += bytes;
+			inflight_bytes += bytes;
+			g.gset.emplace_back(std::move(v[k]));
 		}
+		if(singles[s].size() >= 1) tss[s] = &(g.get_shard(sid));
+		g.gcount += singles[s].size();
+		gmutex[bi + s].unlock();
 	}
 
-	if(cnt0 >= 1)
-	{
-		//vector<transcript> v = ts0.get_transcripts(1);
-		//for(int i = 0; i < v.size(); i++) v[i].write(cout);
-		tmutex[bi + 0].lock();
-		grps[bi + 0].num_assembled += cnt0;
-		grps[bi + 0].tmerge.add(ts0, TRANSCRIPT_COUNT_ADD_COVERAGE_ADD);
-		tmutex[bi + 0].unlock();
-	}
-
-	if(cnt1 >= 1)
-	{
-		tmutex[bi + 1].lock();
-		grps[bi + 1].num_assembled += cnt1;
-		grps[bi + 1].tmerge.add(ts1, TRANSCRIPT_COUNT_ADD_COVERAGE_ADD);
-		tmutex[bi + 1].unlock();
-	}
+	curlock.unlock();
 
-	if(cnt2 >= 1)
+	int index = 0;
+	for(int s = 0; s < 3; s++)
 	{
-		tmutex[bi + 2].lock();
-		grps[bi + 2].num_assembled += cnt2;
-		grps[bi + 2].tmerge.add(ts2, TRANSCRIPT_COUNT_ADD_COVERAGE_ADD);
-		tmutex[bi + 2].unlock();
+		for(int j = 0; j < singles[s].size(); j++)
+		{
+			assembler asmb(params[DEFAULT], *tss[s], rid, sid, index++);
+			asmb.assemble(v[singles[s][j]]);
+		}
 	}
-
-	printf("finish generating tid = %d, rid = %d, of sample %s\n", tid, rid, sp.align_file.c_str());
 	return 0;
 }
 
 int incubator::assemble(bundle_group &g, int rid, int gi)
 {
-	int instance = g.num_assembled + 1;
+	int instance = 1 + g.gcount;
+
 	vector<bool> vb(g.gset.size(), false);
 	int sid = samples.size();
 	g.completed.assign(g.gvv.size(), 0);
+	g.tshards.assign(g.gvv.size(), transcript_set(g.chrm, rid, params[DEFAULT].min_single_exon_clustering_overlap));
 	for(int k = 0; k < g.gvv.size(); k++)
 	{
 		const vector<int> &v = g.gvv[k];
@@ -624,11 +815,22 @@ int incubator::assemble(bundle_group &g, int rid, int gi)
 			vb[v[j]] = true;
 		}
 		assert(g.rid == rid);
-		int bi = get_bundle_group(g.chrm, rid);
-		mutex &mtx = tmutex[bi + gi];
-		boost::asio::post(this->tpool, [this, &g, &mtx, k, gv, rid, sid, instance]{ 
-				assembler asmb(params[DEFAULT], g.tmerge, mtx, rid, sid, instance);
+
+		task_cost c;
+		c.chrm = g.chrm;
+		c.rid = rid;
+		c.strand = g.strand;
+		c.index = k;
+		for(int j = 0; j < gv.size(); j++) c.add(*(gv[j]));
+		double cost = c.predict();
+
+		this->tqueue.post(cost, [this, &g, k, gv, rid, sid, instance, c]{ 
+				auto t0 = std::chrono::steady_clock::now();
+				assembler asmb(params[DEFAULT], g.tshards[k], rid, sid, instance, &(this->tpool));
 				asmb.resolve(gv);
+				task_cost x = c;
+				x.actual = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+				this->costs.record(x);
 				g.completed[k] = 1;
 		});
 		instance++;
@@ -672,6 +874,21 @@ int incubator::rearrange(transcript_set_pool &tsp, transcritp_set &tmerge)
 
 int incubator::postprocess()
 {
+	stage_timer st(STAGE_POSTPROCESS);
+	st.add_items(grps.size());
+
+	// merge the remaining shards of each group
+	boost::asio::thread_pool pool0(params[DEFAULT].max_threads);
+	for(int k = 0; k < grps.size(); k++)
+	{
+		bundle_group &g = grps[k];
+		boost::asio::post(pool0, [&g]{ 
+				g.merge_shards(g.tshards); 
+				g.merge_shards(g.gshards); 
+		});
+	}
+	pool0.join();
+
 	boost::asio::thread_pool pool1(params[DEFAULT].max_threads);
 	for(auto &z: tts)
 	{
@@ -712,32 +929,45 @@ int incubator::postprocess()
 
 int incubator::write_combined_gtf()
 {
-	for(auto &z: tts)
+	// transcripts of a chrm, over all strands; a tabix index
+	// requires them to be sorted by position
+	bool sorted = meta_gtf.indexed();
+	gtf_buffer ss;
+	for(auto z = tts.begin(); z != tts.end(); )
 	{
-		string chrm = z.first.first;
-		char strand = z.first.second;
-		const transcript_set &tm = z.second;
-
-		stringstream ss;
-		for(auto &it : tm.mt)
+		string chrm = z->first.first;
+		vector<pair<PI32, const trans_item*>> vt;
+		for(; z != tts.end() && z->first.first == chrm; z++)
 		{
-			auto &v = it.second;
-			for(int k = 0; k < v.size(); k++)
+			const transcript_set &tm = z->second;
+			for(auto &it : tm.mt)
 			{
-				const transcript &t = v[k].trst;
+				auto &v = it.second;
+				for(int k = 0; k < v.size(); k++)
+				{
+					vt.push_back(pair<PI32, const trans_item*>(v[k].trst.get_bounds(), &v[k]));
+				}
+			}
+		}
 
-				//if(verify_length_coverage(t, params[DEFAULT]) == false) continue;
-				//if(verify_exon_length(t, params[DEFAULT]) == false) continue;
-				assert(v[k].samples.size() == t.count2);
-				t.write(ss, -1, v[k].samples.size());
+		if(sorted == true) stable_sort(vt.begin(), vt.end(), [](const pair<PI32, const trans_item*> &x, const pair<PI32, const trans_item*> &y) { return x.first < y.first; });
 
-				//if(t.exons.size() > 1) t.write_features(-1);
-				//Only output novel transcripts in merged graph
-				//if(t.exons.size() > 1 && t.count2 == 1 && v[k].samples.find(-1) != v[k].samples.end()) t.write_features(sf);
-			}
+		for(int k = 0; k < vt.size(); k++)
+		{
+			const trans_item &ti = *(vt[k].second);
+			const transcript &t = ti.trst;
+
+			//if(verify_length_coverage(t, params[DEFAULT]) == false) continue;
+			//if(verify_exon_length(t, params[DEFAULT]) == false) continue;
+			assert(ti.samples.size() == t.count2);
+			t.write(ss, -1, ti.samples.size());
+			if(sorted == true) meta_gtf.write(ss, chrm, vt[k].first.first, vt[k].first.second);
+
+			//if(t.exons.size() > 1) t.write_features(-1);
+			//Only output novel transcripts in merged graph
+			//if(t.exons.size() > 1 && t.count2 == 1 && v[k].samples.find(-1) != v[k].samples.end()) t.write_features(sf);
 		}
-		const string &s = ss.str();
-		meta_gtf.write(s.c_str(), s.size());
+		meta_gtf.write(ss);
 	}
 	return 0;
 }
@@ -746,46 +976,58 @@ int incubator::write_individual_gtf(int sid)
 {
 	sample_profile &sp = samples[sid];
 	sp.gtf_lock.lock();
-	sp.open_individual_gtf(params[DEFAULT].output_gtf_dir);
-	sp.open_individual_ftr(params[DEFAULT].output_gtf_dir);
+	sp.open_individual_gtf(params[DEFAULT].output_gtf_dir, params[DEFAULT].output_bgzf);
+	sp.open_individual_ftr(params[DEFAULT].output_gtf_dir, params[DEFAULT].output_bgzf);
 
 	//sp.individual_gtf->write(s.c_str(), s.size());
 
-	for(auto &z: tts)
+	// features in the default format of a fresh stream
+	bool sorted = sp.individual_gtf->indexed();
+	gtf_buffer ss;
+	gtf_buffer sf;
+	for(auto z = tts.begin(); z != tts.end(); )
 	{
-		string chrm = z.first.first;
-		char strand = z.first.second;
-		const transcript_set &tm = z.second;
-
-		stringstream ss;
-		stringstream sf;
-		for(auto &it : tm.mt)
+		string chrm = z->first.first;
+		vector<pair<const trans_record*, const trans_item*>> vt;
+		for(; z != tts.end() && z->first.first == chrm; z++)
 		{
-			auto &v = it.second;
-			for(int k = 0; k < v.size(); k++)
+			const transcript_set &tm = z->second;
+			for(auto &it : tm.mt)
 			{
-				for(auto &p : v[k].samples)
+				auto &v = it.second;
+				for(int k = 0; k < v.size(); k++)
 				{
-					int j = p.first;
-					if(j == -1) j = samples.size() - 1;
-					if(j != sid) continue;
-
-					const transcript &t = p.second;
-
-					assert(p.second.count2 == t.count2);
-					assert(abs(p.second.coverage - t.coverage)<SMIN);
-
-					if(t.exons.size() == 1 && t.cov2 < params[DEFAULT].min_single_exon_individual_coverage) continue;
-					//t.write(*(sp.individual_gtf), t.cov2, t.count2);
-					t.write(ss, t.cov2, t.count2);
-					if(t.exons.size() > 1) t.write_features(sf);
+					for(auto &r : v[k].samples)
+					{
+						int j = r.sid;
+						if(j == -1) j = samples.size() - 1;
+						if(j != sid) continue;
+						vt.push_back(pair<const trans_record*, const trans_item*>(&r, &v[k]));
+					}
 				}
 			}
 		}
-		const string &s = ss.str();
-		const string &f = sf.str();
-		sp.individual_gtf->write(s.c_str(), s.size());
-		sp.individual_ftr->write(f.c_str(), f.size());
+
+		if(sorted == true) stable_sort(vt.begin(), vt.end(), [](const pair<const trans_record*, const trans_item*> &x, const pair<const trans_record*, const trans_item*> &y)
+		{
+			if(x.first->lpos != y.first->lpos) return x.first->lpos < y.first->lpos;
+			return x.first->rpos < y.first->rpos;
+		});
+
+		for(int k = 0; k < vt.size(); k++)
+		{
+			const trans_record &r = *(vt[k].first);
+			transcript t;
+			vt[k].second->build_sample_transcript(r, t);
+
+			if(t.exons.size() == 1 && t.cov2 < params[DEFAULT].min_single_exon_individual_coverage) continue;
+			//t.write(*(sp.individual_gtf), t.cov2, t.count2);
+			t.write(ss, t.cov2, t.count2);
+			if(sorted == true) sp.individual_gtf->write(ss, chrm, r.lpos, r.rpos);
+			if(t.exons.size() > 1) t.write_features(sf);
+		}
+		sp.individual_gtf->write(ss);
+		sp.individual_ftr->write(sf);
 	}
 
 	sp.close_individual_gtf();
@@ -799,7 +1041,7 @@ int incubator::write_individual_gtf(int id, const vector<transcript> &v)
 {
 	assert(id >= 0 && id < samples.size());
 
-	stringstream ss;
+	gtf_buffer ss;
 	for(int i = 0; i < v.size(); i++)
 	{
 		const transcript &t = v[i];
@@ -813,12 +1055,10 @@ int incubator::write_individual_gtf(int id, const vector<transcript> &v)
         if(t.exons.size() > 1) t.write_features(id);
 	}
 
-	const string &s = ss.str();
-
 	sample_profile &sp = samples[id];
 	sp.gtf_lock.lock();
-	sp.open_individual_gtf(params[DEFAULT].output_gtf_dir);
-	sp.individual_gtf->write(s.c_str(), s.size());
+	sp.open_individual_gtf(params[DEFAULT].output_gtf_dir, params[DEFAULT].output_bgzf);
+	sp.individual_gtf->write(ss);
 	sp.close_individual_gtf();
 	sp.gtf_lock.unlock();
 
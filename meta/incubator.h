@@ -12,7 +12,12 @@ See LICENSE for licensing.
 #include "bundle_group.h"
 #include "parameters.h"
 #include "transcript_set.h"
+#include "gtf_output.h"
+#include "task_queue.h"
+#include "cost_model.h"
 #include <ctime>
+#include <atomic>
+#include <list>
 #include <mutex>
 #include <thread>
 #include <boost/asio/post.hpp>
@@ -25,6 +30,19 @@ typedef pair< int32_t, set<int> > PISI;
 typedef pair<int, int> PI;
 typedef boost::asio::thread_pool thread_pool;
 
+// a batch of regions of one chrm being generated and assembled
+class batch_state
+{
+public:
+	batch_state(const string &c, int g, int n, int b);
+
+public:
+	string chrm;						// chrm name
+	int gid;							// batch id within chrm
+	vector<mutex> curlocks;				// locked until the region of a sample is generated
+	vector<bool> posted;				// whether each region has been posted for assembly
+};
+
 class incubator
 {
 public:
@@ -36,11 +54,15 @@ public:
 	vector<sample_profile> samples;					// samples
 	map<string, vector<PI>> sindex;					// sample index
 	map<pair<string, char>, transcript_set> tts;	// transcripts for each chrm
-	ofstream meta_gtf;								// meta gtf
+	gtf_output meta_gtf;							// meta gtf
 	vector<bundle_group> grps;						// bundle groups
 	thread_pool tpool;
+	task_queue tqueue;								// assembly tasks on tpool, costliest first
+	cost_model costs;								// predicted and actual time of assembly tasks
 	vector<mutex> gmutex;							// mutex for writing to gset in each bundle_group
-	vector<mutex> tmutex;							// mutex for transcripts in each bundle_group
+	atomic<int64_t> inflight_bytes;					// approximate bytes of bundles held in all gsets
+	int64_t peak_inflight_bytes;					// peak of inflight_bytes seen by the scheduler
+	int num_delayed_batches;						// number of batches delayed by max_memory
 	//transcript_set_pool tspool;					// a pool for ts
 	//transcript_set tmerge;						// assembled transcripts for all samples
 	//mutex tlock;									// global lock for transcripts
@@ -55,17 +77,26 @@ public:
 
 private:
 	int read_bam_list();
+	vector<string> read_barcode_whitelist(const string &file);
 	int init_samples();
 	int free_samples();
 	int build_sample_index();
+	int add_target(const string &s, bam_hdr_t *hdr, map<string, vector<PI32>> &m);
+	int merge_targets(map<string, vector<PI32>> &m);
 	int init_bundle_groups();
 	int init_transcript_sets();
 	int get_max_region(string chrm);
 	int get_chrm_index(string chrm, int sid);
 	set<int> get_target_list(int sid);
 	int get_bundle_group(string chrm, int gid);
-	int generate_merge_assemble(string chrm, int gid);
-	int generate(int sid, int tid, int rid, string chrm, mutex &curlock);
+	int get_sample_slot(string chrm, int sid);
+	int generate_merge_assemble();
+	int admit_batch(batch_state &b);
+	bool assemble_batch(batch_state &b);
+	int clear_completed_groups();
+	bool within_memory_budget();
+	int generate(int sid, int tid, int rid, string chrm, const vector<mutex*> &curlocks);
+	int collect(int sid, int rid, string chrm, vector<bundle> &v, mutex &curlock);
 	int assemble(bundle_group &g, int gid, int gi);
 	int write_individual_gtf(int id, const vector<transcript> &t);
 	int write_individual_gtf(int sid);
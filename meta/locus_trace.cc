@@ -0,0 +1,140 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#include "locus_trace.h"
+#include <cstdio>
+#include <cassert>
+
+bool trace_log::active = false;
+int trace_log::slowest = 0;
+string trace_log::dump_dir = "";
+double trace_log::dump_seconds = 0;
+mutex trace_log::tlock;
+ofstream trace_log::fout;
+multiset<locus_trace> trace_log::slow;
+
+locus_trace::locus_trace()
+{
+	strand = '.';
+	lpos = rpos = 0;
+	members = 0;
+	vertices = edges = 0;
+	phases = 0;
+	iterations = 0;
+	transcripts = 0;
+	trevise = tbridge = tdecompose = 0;
+}
+
+double locus_trace::total() const
+{
+	return trevise + tbridge + tdecompose;
+}
+
+bool locus_trace::operator<(const locus_trace &t) const
+{
+	return total() < t.total();
+}
+
+int locus_trace::write(ostream &os) const
+{
+	char buf[1024];
+	sprintf(buf, "%s\t%s\t%c\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%.4lf\t%.4lf\t%.4lf\t%.4lf\n",
+			gid.c_str(), chrm.c_str(), strand, lpos, rpos, members, vertices, edges, phases, iterations, transcripts,
+			trevise, tbridge, tdecompose, total());
+	os << buf;
+	return 0;
+}
+
+int trace_log::init(const parameters &cfg)
+{
+	slowest = cfg.slowest_loci;
+	dump_dir = cfg.trace_dump_dir;
+	dump_seconds = cfg.trace_dump_seconds;
+	active = (cfg.trace_file != "" || slowest >= 1 || dump_dir != "");
+	if(cfg.trace_file == "") return 0;
+
+	fout.open(cfg.trace_file.c_str());
+	if(fout.fail())
+	{
+		printf("cannot open trace-file %s\n", cfg.trace_file.c_str());
+		return -1;
+	}
+	fout << "gid\tchrm\tstrand\tlpos\trpos\tmembers\tvertices\tedges\tphases\titerations\ttranscripts\trevise\tbridge\tdecompose\ttotal\n";
+	return 0;
+}
+
+bool trace_log::enabled()
+{
+	return active;
+}
+
+bool trace_log::dumping()
+{
+	return (active == true && dump_dir != "");
+}
+
+int trace_log::record(const locus_trace &t, splice_graph *gr, const phase_set &ps)
+{
+	if(active == false) return 0;
+
+	// dumps are written outside of the lock
+	if(gr != NULL && gr->num_vertices() >= 2 && t.total() >= dump_seconds) dump(t, *gr, ps);
+
+	lock_guard<mutex> lg(tlock);
+	if(fout.is_open()) t.write(fout);
+
+	if(slowest <= 0) return 0;
+	if(slow.size() >= slowest && t.total() <= slow.begin()->total()) return 0;
+	slow.insert(t);
+	if(slow.size() > slowest) slow.erase(slow.begin());
+	return 0;
+}
+
+int trace_log::dump(const locus_trace &t, splice_graph &gr, const phase_set &ps)
+{
+	string file = dump_dir + "/" + t.gid + ".graph";
+	ofstream os(file.c_str());
+	if(os.fail())
+	{
+		printf("cannot open graph-dump file %s\n", file.c_str());
+		return -1;
+	}
+
+	// the graph as regions, boundaries and junctions, followed by
+	// the phasing paths as: phase count length coordinates
+	gr.write(os);
+
+	vector<int32_t> v;
+	for(int i = 0; i < ps.pids.size(); i++)
+	{
+		ps.get_path(ps.pids[i], v);
+		os << "phase " << ps.get_count(ps.pids[i]) << " " << v.size();
+		for(int k = 0; k < v.size(); k++) os << " " << v[k];
+		os << endl;
+	}
+	os.close();
+	return 0;
+}
+
+int trace_log::print_slowest()
+{
+	if(slowest <= 0 || slow.size() == 0) return 0;
+
+	printf("slowest %lu loci (gid, chrm, strand, lpos, rpos, members, vertices, edges, phases, iterations, transcripts, revise, bridge, decompose, total):\n", slow.size());
+	for(multiset<locus_trace>::reverse_iterator it = slow.rbegin(); it != slow.rend(); it++)
+	{
+		stringstream ss;
+		it->write(ss);
+		printf("  %s", ss.str().c_str());
+	}
+	return 0;
+}
+
+int trace_log::close()
+{
+	if(fout.is_open()) fout.close();
+	return 0;
+}
@@ -0,0 +1,73 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#ifndef __LOCUS_TRACE_H__
+#define __LOCUS_TRACE_H__
+
+#include "splice_graph.h"
+#include "phase_set.h"
+#include "parameters.h"
+
+#include <set>
+#include <mutex>
+#include <string>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+// size and time of assembling one splice graph
+class locus_trace
+{
+public:
+	locus_trace();
+
+public:
+	string gid;
+	string chrm;
+	char strand;
+	int32_t lpos;
+	int32_t rpos;
+	int members;				// number of graphs combined into it
+	int vertices;
+	int edges;
+	int phases;					// number of hyper-edges given to scallop
+	int iterations;				// iterations of scallop
+	int transcripts;
+	double trevise;				// seconds of building and revising the graph(s)
+	double tbridge;				// seconds of bridging the reads of its bundle(s)
+	double tdecompose;			// seconds of scallop
+
+public:
+	double total() const;
+	int write(ostream &os) const;
+	bool operator<(const locus_trace &t) const;
+};
+
+// per-graph trace of a run: a line per assembled graph, the slowest
+// loci kept for a summary, and slow graphs dumped for offline replay
+class trace_log
+{
+public:
+	static int init(const parameters &cfg);
+	static bool enabled();
+	static bool dumping();
+	static int record(const locus_trace &t, splice_graph *gr, const phase_set &ps);
+	static int print_slowest();
+	static int close();
+
+private:
+	static bool active;
+	static int slowest;
+	static string dump_dir;
+	static double dump_seconds;
+	static mutex tlock;
+	static ofstream fout;
+	static multiset<locus_trace> slow;	// the slowest loci, fastest first
+	static int dump(const locus_trace &t, splice_graph &gr, const phase_set &ps);
+};
+
+#endif
@@ -41,6 +41,7 @@ int previewer::infer_library_type()
 
 	int hid = 0;
 	bam1_t *b1t = bam_init1();
+	cigar_walker cw;
 	sp.open_align_file();
 
     while(sam_read1(sp.sfn, sp.hdr, b1t) >= 0)
@@ -58,9 +59,10 @@ int previewer::infer_library_type()
 
 		total++;
 
-		hit ht(b1t, hid++);
+		cw.walk(b1t);
+		hit ht(b1t, hid++, cw);
 		ht.set_tags(b1t);
-		vector<int32_t> spos = ht.extract_splices(b1t);
+		vector<int32_t> spos = ht.extract_splices(cw);
 
 		if(spos.size() <= 0) continue;
 		spliced++;
@@ -160,6 +162,7 @@ int previewer::infer_insertsize()
 
 	sp.open_align_file();
 	bam1_t *b1t = bam_init1();
+	cigar_walker cw;
     while(sam_read1(sp.sfn, sp.hdr, b1t) >= 0)
 	{
 		bam1_core_t &p = b1t->core;
@@ -170,7 +173,8 @@ int previewer::infer_insertsize()
 		if(p.qual < cfg.min_mapping_quality) continue;								// ignore hits with small quality
 		if(p.n_cigar < 1) continue;												// should never happen
 
-		hit ht(b1t, hid++);
+		cw.walk(b1t);
+		hit ht(b1t, hid++, cw);
 		ht.set_tags(b1t);
 		ht.set_strand(sp.library_type);
 
@@ -195,12 +199,12 @@ int previewer::infer_insertsize()
 		if(sp.library_type != UNSTRANDED && ht.strand == '+' && ht.xs == '-') continue;
 		if(sp.library_type != UNSTRANDED && ht.strand == '-' && ht.xs == '+') continue;
 		if(sp.library_type != UNSTRANDED && ht.strand == '.' && ht.xs != '.') ht.strand = ht.xs;
-		if(sp.library_type != UNSTRANDED && ht.strand == '+') bb1.add_hit_intervals(ht, b1t);
-		if(sp.library_type != UNSTRANDED && ht.strand == '-') bb2.add_hit_intervals(ht, b1t);
-		if(sp.library_type == UNSTRANDED && ht.xs == '.') bb1.add_hit_intervals(ht, b1t);
-		if(sp.library_type == UNSTRANDED && ht.xs == '.') bb2.add_hit_intervals(ht, b1t);
-		if(sp.library_type == UNSTRANDED && ht.xs == '+') bb1.add_hit_intervals(ht, b1t);
-		if(sp.library_type == UNSTRANDED && ht.xs == '-') bb2.add_hit_intervals(ht, b1t);
+		if(sp.library_type != UNSTRANDED && ht.strand == '+') bb1.add_hit_intervals(ht, cw);
+		if(sp.library_type != UNSTRANDED && ht.strand == '-') bb2.add_hit_intervals(ht, cw);
+		if(sp.library_type == UNSTRANDED && ht.xs == '.') bb1.add_hit_intervals(ht, cw);
+		if(sp.library_type == UNSTRANDED && ht.xs == '.') bb2.add_hit_intervals(ht, cw);
+		if(sp.library_type == UNSTRANDED && ht.xs == '+') bb1.add_hit_intervals(ht, cw);
+		if(sp.library_type == UNSTRANDED && ht.xs == '-') bb2.add_hit_intervals(ht, cw);
 	}
 
     bam_destroy1(b1t);
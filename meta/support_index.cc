@@ -0,0 +1,395 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#include "support_index.h"
+
+#include <cassert>
+#include <cstdio>
+#include <algorithm>
+
+support_point::support_point(int32_t _p, int _j, int _seq, double _w)
+	: p(_p), j(_j), seq(_seq), w(_w)
+{}
+
+bool support_point::operator<(const support_point &x) const
+{
+	if(p < x.p) return true;
+	if(p > x.p) return false;
+	return seq < x.seq;
+}
+
+support_index::support_index(const vector<splice_graph*> &_grv, const vector<int> &_idv, const parameters &c)
+	: cfg(c), grv(_grv), idv(_idv)
+{
+	assert(grv.size() == idv.size());
+	build_points();
+	build_queries();
+}
+
+int support_index::build_points()
+{
+	// seq follows the order of graphs and then of edges,
+	// which is the order supports are accumulated in
+	int seq = 0;
+	for(int j = 0; j < grv.size(); j++)
+	{
+		splice_graph &gr = *(grv[j]);
+		int n = gr.num_vertices() - 1;
+
+		PEEI pei = gr.out_edges(0);
+		for(edge_iterator it = pei.first; it != pei.second; it++)
+		{
+			edge_descriptor e = (*it);
+			int t = e->target();
+			starts.push_back(support_point(gr.get_vertex_info(t).rpos, j, seq++, gr.get_edge_weight(e)));
+		}
+
+		pei = gr.in_edges(n);
+		for(edge_iterator it = pei.first; it != pei.second; it++)
+		{
+			edge_descriptor e = (*it);
+			int s = e->source();
+			ends.push_back(support_point(gr.get_vertex_info(s).lpos, j, seq++, gr.get_edge_weight(e)));
+		}
+	}
+
+	sort(starts.begin(), starts.end());
+	sort(ends.begin(), ends.end());
+	return 0;
+}
+
+int support_index::build_queries()
+{
+	// positions that will be located in each member graph
+	for(int k = 0; k < grv.size(); k++)
+	{
+		splice_graph &gr = *(grv[k]);
+		int n = gr.num_vertices() - 1;
+
+		PEEI pei = gr.edges();
+		for(edge_iterator it = pei.first; it != pei.second; it++)
+		{
+			edge_descriptor e = (*it);
+			int s = e->source();
+			int t = e->target();
+			if(s == 0) continue;
+			if(t == n) continue;
+			int32_t p = gr.get_vertex_info(t).lpos;
+			if(gr.get_vertex_info(s).rpos != p) continue;
+			add_query(p - 1);
+			add_query(p);
+		}
+
+		pei = gr.out_edges(0);
+		for(edge_iterator it = pei.first; it != pei.second; it++)
+		{
+			const vertex_info &vi = gr.get_vertex_info((*it)->target());
+			add_query(vi.lpos);
+			add_query(vi.rpos - 1);
+			add_query(vi.rpos);
+		}
+
+		pei = gr.in_edges(n);
+		for(edge_iterator it = pei.first; it != pei.second; it++)
+		{
+			const vertex_info &vi = gr.get_vertex_info((*it)->source());
+			add_query(vi.rpos - 1);
+			add_query(vi.lpos);
+			add_query(vi.lpos - 1);
+		}
+	}
+
+	sort(qpos.begin(), qpos.end());
+	qpos.erase(unique(qpos.begin(), qpos.end()), qpos.end());
+
+	// vertices of a graph are sorted and disjoint, so each
+	// position is covered by at most one vertex of each graph
+	qhits.resize(qpos.size());
+	for(int j = 0; j < grv.size(); j++)
+	{
+		splice_graph &gr = *(grv[j]);
+		for(int v = 1; v < (int)(gr.num_vertices()) - 1; v++)
+		{
+			const vertex_info &vi = gr.get_vertex_info(v);
+			int i = lower_bound(qpos.begin(), qpos.end(), vi.lpos) - qpos.begin();
+			for(; i < qpos.size() && qpos[i] < vi.rpos; i++)
+			{
+				qhits[i].push_back(PI(j, v));
+			}
+		}
+	}
+	return 0;
+}
+
+int support_index::add_query(int32_t p)
+{
+	qpos.push_back(p);
+	return 0;
+}
+
+const vector<PI>& support_index::locate(int32_t p) const
+{
+	int i = lower_bound(qpos.begin(), qpos.end(), p) - qpos.begin();
+	assert(i < qpos.size() && qpos[i] == p);
+	return qhits[i];
+}
+
+int support_index::collect(const vector<support_point> &v, int32_t p1, int32_t p2, vector<support_point> &sv) const
+{
+	sv.clear();
+	if(p1 > p2) return 0;
+	auto a = lower_bound(v.begin(), v.end(), support_point(p1, -1, -1, 0));
+	auto b = lower_bound(v.begin(), v.end(), support_point(p2 + 1, -1, -1, 0));
+	sv.assign(a, b);
+	sort(sv.begin(), sv.end(), [](const support_point &x, const support_point &y){ return x.seq < y.seq; });
+	return 0;
+}
+
+int support_index::annotate(int k)
+{
+	assert(k >= 0 && k < grv.size());
+	start_support(k);
+	end_support(k);
+	non_splicing_support(k);
+	boundary_extend(k, 1);
+	boundary_extend(k, 2);
+	boundary_extend(k, 3);
+	return 0;
+}
+
+int support_index::start_support(int k)
+{
+	splice_graph &gr = *(grv[k]);
+	int n = gr.num_vertices() - 1;
+	vector<support_point> sv;
+
+	PEEI pei = gr.out_edges(0);
+	for(edge_iterator it = pei.first; it != pei.second; it++)
+	{
+		edge_descriptor e = (*it);
+		int x = e->target();
+		if(x == n) continue;
+
+		// a starting position is assigned to x if it falls into x or into
+		// the adjacent non-starting vertices following x, within 200bp
+		int y = x;
+		while(y + 1 < n)
+		{
+			if(gr.get_vertex_info(y).rpos != gr.get_vertex_info(y + 1).lpos) break;
+			if(gr.edge(y, y + 1).second == false) break;
+			if(gr.edge(0, y + 1).second == true) break;
+			y++;
+		}
+
+		int32_t p1 = gr.get_vertex_info(x).lpos + 1;
+		int32_t p2 = gr.get_vertex_info(y).rpos;
+		if(p2 > gr.get_vertex_info(x).rpos + 200) p2 = gr.get_vertex_info(x).rpos + 200;
+
+		collect(starts, p1, p2, sv);
+
+		edge_info &ei = gr.get_editable_edge_info(e);
+		for(int i = 0; i < sv.size(); i++)
+		{
+			int sid = idv[sv[i].j];
+			ei.samples.insert(sid);
+			ei.count = ei.samples.size();
+			ei.spAbd[sid] += sv[i].w;
+			ei.abd += sv[i].w;
+			if(cfg.verbose >= 3) printf("Sample %d supports (%d, %d) at %d\n", sid, 0, x, sv[i].p);
+		}
+	}
+	return 0;
+}
+
+int support_index::end_support(int k)
+{
+	splice_graph &gr = *(grv[k]);
+	int n = gr.num_vertices() - 1;
+	vector<support_point> sv;
+
+	PEEI pei = gr.in_edges(n);
+	for(edge_iterator it = pei.first; it != pei.second; it++)
+	{
+		edge_descriptor e = (*it);
+		int x = e->source();
+		if(x == 0) continue;
+
+		// an ending position is assigned to x if it falls into x or into
+		// the adjacent non-ending vertices preceding x, within 200bp
+		int y = x;
+		while(y - 1 >= 1)
+		{
+			if(gr.get_vertex_info(y - 1).rpos != gr.get_vertex_info(y).lpos) break;
+			if(gr.edge(y - 1, y).second == false) break;
+			if(gr.edge(y - 1, n).second == true) break;
+			y--;
+		}
+
+		int32_t p1 = gr.get_vertex_info(y).lpos;
+		int32_t p2 = gr.get_vertex_info(x).rpos - 1;
+		if(p1 < gr.get_vertex_info(x).lpos - 200) p1 = gr.get_vertex_info(x).lpos - 200;
+
+		collect(ends, p1, p2, sv);
+
+		edge_info &ei = gr.get_editable_edge_info(e);
+		for(int i = 0; i < sv.size(); i++)
+		{
+			int sid = idv[sv[i].j];
+			ei.samples.insert(sid);
+			ei.count = ei.samples.size();
+			ei.spAbd[sid] += sv[i].w;
+			ei.abd += sv[i].w;
+			if(cfg.verbose >= 3) printf("Sample %d supports (%d, %d) at %d\n", sid, x, n, sv[i].p);
+		}
+	}
+	return 0;
+}
+
+int support_index::non_splicing_support(int k)
+{
+	splice_graph &gr = *(grv[k]);
+	int n = gr.num_vertices() - 1;
+
+	PEEI pei = gr.edges();
+	for(edge_iterator it = pei.first; it != pei.second; it++)
+	{
+		edge_descriptor e = (*it);
+		int s = e->source();
+		int t = e->target();
+		if(s == 0) continue;
+		if(t == n) continue;
+
+		int32_t p = gr.get_vertex_info(t).lpos;
+		if(gr.get_vertex_info(s).rpos != p) continue;
+
+		// members covering both sides of p
+		const vector<PI> &v1 = locate(p - 1);
+		const vector<PI> &v2 = locate(p);
+		edge_info &ei = gr.get_editable_edge_info(e);
+
+		int a = 0, b = 0;
+		while(a < v1.size() && b < v2.size())
+		{
+			if(v1[a].first < v2[b].first) { a++; continue; }
+			if(v1[a].first > v2[b].first) { b++; continue; }
+
+			int j = v1[a].first;
+			int k1 = v1[a].second;
+			int k2 = v2[b].second;
+			int sid = idv[j];
+			splice_graph &gx = *(grv[j]);
+			a++;
+			b++;
+
+			double w = 0;
+			if(k1 == k2)
+			{
+				w = gx.get_vertex_weight(k1);
+			}
+			else if(gx.get_vertex_info(k1).rpos == gx.get_vertex_info(k2).lpos && gx.edge(k1, k2).second)
+			{
+				w = gx.get_edge_weight(gx.edge(k1, k2).first);
+			}
+			else continue;
+
+			ei.samples.insert(sid);
+			ei.count = ei.samples.size();
+			ei.spAbd[sid] += w;
+			ei.abd += w;
+			if(cfg.verbose >= 3) printf("Non-splicing edge(%d, %d) supported by (%d, %d), sample_id=%d, weight=%.2f\n", s, t, k1, k2, sid, w);
+		}
+	}
+	return 0;
+}
+
+int support_index::boundary_extend(int k, int pos_type)
+{
+	splice_graph &gr = *(grv[k]);
+	int n = gr.num_vertices() - 1;
+
+	// losses of each vertex, keyed by 2 * j for starting and 2 * j + 1
+	// for ending, so that they are accumulated in the order of members
+	vector<vector<pair<int, double>>> vl(gr.num_vertices());
+
+	// loss of start
+	PEEI pei = gr.out_edges(0);
+	for(edge_iterator it = pei.first; it != pei.second; it++)
+	{
+		int t = (*it)->target();
+		const vertex_info &vi = gr.get_vertex_info(t);
+
+		int32_t p = 0;
+		if(pos_type == 1) p = vi.lpos;
+		else if(pos_type == 2) p = vi.rpos - 1;
+		else if(pos_type == 3 && gr.edge(t, t + 1).second && vi.rpos == gr.get_vertex_info(t + 1).lpos && t + 1 < n) p = vi.rpos;
+		else continue;
+
+		const vector<PI> &v = locate(p);
+		for(int i = 0; i < v.size(); i++)
+		{
+			int j = v[i].first;
+			int x = v[i].second;
+			splice_graph &gx = *(grv[j]);
+			if(gx.edge(0, x).second) continue;
+
+			double loss = gx.get_in_weights(x);
+			PEB peb = gx.edge(x - 1, x);
+			if(peb.second && gx.get_vertex_info(x - 1).rpos == gx.get_vertex_info(x).lpos) loss -= gx.get_edge_weight(peb.first);
+
+			vl[t].push_back(pair<int, double>(2 * j, loss));
+			if(cfg.verbose >= 2) printf("Start vertex %d(gx=%d, vertex=%d) boundary_loss = %.2lf\n", t, idv[j], x, loss);
+		}
+	}
+
+	// loss of end
+	pei = gr.in_edges(n);
+	for(edge_iterator it = pei.first; it != pei.second; it++)
+	{
+		int s = (*it)->source();
+		const vertex_info &vi = gr.get_vertex_info(s);
+
+		int32_t p = 0;
+		if(pos_type == 1) p = vi.rpos - 1;
+		else if(pos_type == 2) p = vi.lpos;
+		else if(pos_type == 3 && s > 1 && gr.edge(s - 1, s).second && gr.get_vertex_info(s - 1).rpos == vi.lpos) p = vi.lpos - 1;
+		else continue;
+
+		const vector<PI> &v = locate(p);
+		for(int i = 0; i < v.size(); i++)
+		{
+			int j = v[i].first;
+			int x = v[i].second;
+			splice_graph &gx = *(grv[j]);
+			int m = gx.num_vertices() - 1;
+			if(x == m || gx.edge(x, m).second) continue;
+
+			double loss = gx.get_out_weights(x);
+			PEB peb = gx.edge(x, x + 1);
+			if(peb.second && gx.get_vertex_info(x).rpos == gx.get_vertex_info(x + 1).lpos) loss -= gx.get_edge_weight(peb.first);
+
+			vl[s].push_back(pair<int, double>(2 * j + 1, loss));
+			if(cfg.verbose >= 2) printf("End vertex %d(gx=%d, vertex=%d) boundary_loss = %.2lf\n", s, idv[j], x, loss);
+		}
+	}
+
+	for(int v = 0; v < vl.size(); v++)
+	{
+		if(vl[v].size() == 0) continue;
+		sort(vl[v].begin(), vl[v].end());
+
+		vertex_info &vi = gr.get_editable_vertex_info(v);
+		for(int i = 0; i < vl[v].size(); i++)
+		{
+			int sid = idv[vl[v][i].first / 2];
+			double loss = vl[v][i].second;
+			if(sid == -1 && pos_type == 1) vi.boundary_merged_loss += loss;
+			else if(pos_type == 1) vi.boundary_loss1 += loss;
+			else if(pos_type == 2) vi.boundary_loss2 += loss;
+			else if(pos_type == 3) vi.boundary_loss3 += loss;
+		}
+	}
+	return 0;
+}
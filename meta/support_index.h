@@ -0,0 +1,72 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#ifndef __SUPPORT_INDEX_H__
+#define __SUPPORT_INDEX_H__
+
+#include "splice_graph.h"
+#include "parameters.h"
+#include "util.h"
+
+#include <vector>
+
+using namespace std;
+
+// a starting (or ending) edge of a member graph, keyed by the position
+// at which it is matched against other graphs
+class support_point
+{
+public:
+	support_point(int32_t p, int j, int seq, double w);
+
+public:
+	int32_t p;				// rpos of the first (lpos of the last) vertex
+	int j;					// index of the member graph
+	int seq;				// order of the edge over all member graphs
+	double w;				// weight of the edge
+
+public:
+	bool operator<(const support_point &x) const;
+};
+
+// evidence of all member graphs of a bundle group, held in arrays sorted
+// by coordinate; the supports that graph k receives from every member
+// (including itself) are then collected with binary searches, in place of
+// comparing each pair of graphs; the supports applied, and the order in
+// which they are accumulated, are the same as calling start_end_support,
+// non_splicing_support and boundary_extend (type 1, 2, 3) of assembler
+// for each member in turn, provided that the graphs are not modified
+// other than these supports between construction and annotation
+class support_index
+{
+public:
+	support_index(const vector<splice_graph*> &grv, const vector<int> &idv, const parameters &cfg);
+
+private:
+	const parameters &cfg;
+	vector<splice_graph*> grv;		// member graphs
+	vector<int> idv;				// sample-id of each member graph
+	vector<support_point> starts;	// starting edges of all members, sorted
+	vector<support_point> ends;		// ending edges of all members, sorted
+	vector<int32_t> qpos;			// sorted positions queried against vertices
+	vector<vector<PI>> qhits;		// members (j, vertex of j covering qpos[i]), ordered by j
+
+public:
+	int annotate(int k);
+
+private:
+	int build_points();
+	int build_queries();
+	int add_query(int32_t p);
+	const vector<PI>& locate(int32_t p) const;
+	int start_support(int k);
+	int end_support(int k);
+	int non_splicing_support(int k);
+	int boundary_extend(int k, int pos_type);
+	int collect(const vector<support_point> &v, int32_t p1, int32_t p2, vector<support_point> &sv) const;
+};
+
+#endif
@@ -0,0 +1,53 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#include "task_group.h"
+
+task_group::task_group(thread_pool *p, int n, const function<void(int)> &f)
+	: pool(p), s(new state())
+{
+	s->next = 0;
+	s->n = n;
+	s->done = 0;
+	s->f = f;
+}
+
+int task_group::run()
+{
+	if(s->n <= 0) return 0;
+
+	// helpers that start after all subtasks are claimed do nothing
+	if(pool != NULL)
+	{
+		std::shared_ptr<state> x = s;
+		for(int k = 1; k < s->n; k++)
+		{
+			boost::asio::post(*pool, [x]{ task_group::work(*x); });
+		}
+	}
+
+	work(*s);
+
+	unique_lock<mutex> lock(s->m);
+	s->cv.wait(lock, [this]{ return s->done >= s->n; });
+	return 0;
+}
+
+int task_group::work(state &s)
+{
+	while(true)
+	{
+		int k = s.next++;
+		if(k >= s.n) break;
+
+		s.f(k);
+
+		lock_guard<mutex> lock(s.m);
+		s.done++;
+		if(s.done >= s.n) s.cv.notify_all();
+	}
+	return 0;
+}
@@ -0,0 +1,52 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#ifndef __TASK_GROUP_H__
+#define __TASK_GROUP_H__
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+using namespace std;
+
+typedef boost::asio::thread_pool thread_pool;
+
+// subtasks f(0), ..., f(n-1) shared with a thread pool; the thread waiting
+// for them also runs them, so a task of the pool can wait for its own
+// subtasks without blocking a worker that they depend on
+class task_group
+{
+public:
+	task_group(thread_pool *pool, int n, const function<void(int)> &f);
+
+private:
+	class state
+	{
+	public:
+		atomic<int> next;				// next subtask to be claimed
+		int n;							// number of subtasks
+		int done;						// number of finished subtasks
+		function<void(int)> f;
+		mutex m;
+		condition_variable cv;
+	};
+
+	thread_pool *pool;					// NULL to run all subtasks in place
+	std::shared_ptr<state> s;				// kept alive by helpers posted late
+
+public:
+	int run();
+
+private:
+	static int work(state &s);
+};
+
+#endif
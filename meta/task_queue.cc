@@ -0,0 +1,35 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#include "task_queue.h"
+#include <cassert>
+
+task_queue::task_queue(thread_pool &p)
+	: pool(p), count(0)
+{}
+
+int task_queue::post(double cost, const function<void()> &f)
+{
+	qlock.lock();
+	tasks.insert(make_pair(make_pair(0 - cost, count++), f));
+	qlock.unlock();
+
+	boost::asio::post(pool, [this]{ this->run_next(); });
+	return 0;
+}
+
+int task_queue::run_next()
+{
+	// each runner is paired with one posted task, so the queue is not empty
+	qlock.lock();
+	assert(tasks.size() >= 1);
+	function<void()> f = std::move(tasks.begin()->second);
+	tasks.erase(tasks.begin());
+	qlock.unlock();
+
+	f();
+	return 0;
+}
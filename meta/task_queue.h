@@ -0,0 +1,43 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#ifndef __TASK_QUEUE_H__
+#define __TASK_QUEUE_H__
+
+#include <map>
+#include <mutex>
+#include <functional>
+#include <stdint.h>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+using namespace std;
+
+typedef boost::asio::thread_pool thread_pool;
+
+// tasks run on a thread pool in order of decreasing predicted cost:
+// each post adds the task to a queue and a runner to the pool, and
+// a runner executes the costliest task pending when it starts, so
+// whichever worker is idle takes the largest remaining task
+class task_queue
+{
+public:
+	task_queue(thread_pool &pool);
+
+private:
+	thread_pool &pool;
+	mutex qlock;
+	map<pair<double, int64_t>, function<void()>> tasks;	// keyed by (-cost, order of posting)
+	int64_t count;											// number of posted tasks
+
+public:
+	int post(double cost, const function<void()> &f);
+
+private:
+	int run_next();
+};
+
+#endif
@@ -1,4 +1,7 @@
 #include "binomial.h"
+#include "util.h"
+#include <ctime>
+#include <cstdio>
 
 uint32_t compute_binomial_score(int n, double pr, int x)
 {
@@ -9,6 +12,14 @@ uint32_t compute_binomial_score(int n, double pr, int x)
 }
 
 double compute_binomial_pvalue(int n, double pr, int x)
+{
+	// compute the probability that observed >= x among n trials
+	assert(x >= 0 && x <= n);
+	if(x == 0) return 0;
+	return binomial_engine::local().pvalue(n, pr, x);
+}
+
+double compute_binomial_pvalue_exact(int n, double pr, int x)
 {
 	// compute the probability that observed >= x among n trials
 	assert(x >= 0 && x <= n);
@@ -17,3 +28,180 @@ double compute_binomial_pvalue(int n, double pr, int x)
 	binomial_distribution<> b(n, pr);
 	return cdf(complement(b, x - 1));
 }
+
+binomial_engine::binomial_engine()
+{
+	num_queries = 0;
+	num_hits = 0;
+	num_approx = 0;
+}
+
+binomial_engine& binomial_engine::local()
+{
+	static thread_local binomial_engine be;
+	return be;
+}
+
+int binomial_engine::clear()
+{
+	vector<cache_entry>().swap(cache);
+	num_queries = 0;
+	num_hits = 0;
+	num_approx = 0;
+	return 0;
+}
+
+double binomial_engine::pvalue(int n, double pr, int x)
+{
+	assert(x >= 0 && x <= n);
+	num_queries++;
+
+	if(x == 0) return 0;
+	if(pr <= 0) return 0;
+	if(pr >= 1) return 1;
+
+	// quantise pr so that nearby queries share entries;
+	// the returned value is always evaluated at the quantised pr
+	const uint32_t qmax = (1u << pr_quantum_bits);
+	uint32_t q = (uint32_t)(pr * qmax + 0.5);
+	if(q <= 0) q = 1;
+	if(q >= qmax) q = qmax - 1;
+	double qpr = q * 1.0 / qmax;
+
+	if(cache.size() == 0) cache.assign(1 << cache_bits, cache_entry({0, 0, 0}));
+
+	int64_t nx = pack(n, x);
+	uint64_t h = (uint64_t)(nx) * 0x9e3779b97f4a7c15ull + q * 0xc2b2ae3d27d4eb4full;
+	cache_entry &e = cache[h >> (64 - cache_bits)];
+	if(e.q == q && e.nx == nx)
+	{
+		num_hits++;
+		return e.p;
+	}
+
+	double p = 0;
+	int a = approximation(n, qpr, x);
+	if(a == 1) p = normal_tail(n, qpr, x);
+	if(a == 2) p = poisson_tail(n, qpr, x);
+	if(a == 0) p = compute_binomial_pvalue_exact(n, qpr, x);
+	if(a != 0) num_approx++;
+
+	e.nx = nx;
+	e.q = q;
+	e.p = p;
+	return p;
+}
+
+int binomial_engine::approximation(int n, double pr, int x) const
+{
+	// 0: exact, 1: normal, 2: poisson
+	// the normal approximation is only used near the mean,
+	// where its absolute and relative errors are both small
+	if(n < min_approx_trials) return 0;
+	double mean = n * pr;
+	double var = mean * (1.0 - pr);
+	if(var >= min_normal_variance && fabs(x - 0.5 - mean) <= max_normal_deviation * sqrt(var)) return 1;
+	if(mean <= max_poisson_lambda && pr <= max_poisson_pr) return 2;
+	return 0;
+}
+
+double binomial_engine::normal_tail(int n, double pr, int x) const
+{
+	// P(X >= x) with continuity correction
+	double mean = n * pr;
+	double sd = sqrt(mean * (1.0 - pr));
+	double z = (x - 0.5 - mean) / sd;
+	return 0.5 * erfc(z / sqrt(2.0));
+}
+
+double binomial_engine::poisson_tail(int n, double pr, int x) const
+{
+	// P(X >= x) for X ~ Poisson(n * pr)
+	double lambda = n * pr;
+	if(x <= lambda)
+	{
+		// 1 - P(X < x), at most max_poisson_lambda terms
+		double t = exp(-lambda);
+		double s = 0;
+		for(int k = 0; k < x; k++)
+		{
+			s += t;
+			t = t * lambda / (k + 1);
+		}
+		double p = 1.0 - s;
+		return p < 0 ? 0 : p;
+	}
+
+	// sum the upper tail directly to avoid cancellation
+	double t = exp(-lambda + x * log(lambda) - lgamma(x + 1.0));
+	double s = 0;
+	for(int k = x; k <= n; k++)
+	{
+		s += t;
+		t = t * lambda / (k + 1);
+		if(t < s * 1e-16) break;
+	}
+	return s > 1 ? 1 : s;
+}
+
+int test_binomial_pvalue()
+{
+	// queries resemble region::calculate_significance: a few totals per region,
+	// each evaluated against many partial exons, repeated until convergence
+	srand(13);
+	vector<int> vn;
+	vector<double> vp;
+	vector<int> vx;
+	for(int r = 0; r < 2000; r++)
+	{
+		int n = 10 + rand() % 20000;
+		int m = 2 + rand() % 20;
+		for(int i = 0; i < m; i++)
+		{
+			double pr = (1 + rand() % 1000) / 1000.0 / m;
+			double mean = n * pr;
+			double sd = sqrt(mean * (1 - pr));
+			int x = (int)(mean + sd * ((rand() % 1200) / 100.0 - 4.0));
+			if(x < 1) x = 1;
+			if(x > n) x = n;
+			for(int k = 0; k < 3; k++)
+			{
+				vn.push_back(n);
+				vp.push_back(pr);
+				vx.push_back(x);
+			}
+		}
+	}
+
+	vector<double> v1(vn.size(), 0);
+	vector<double> v2(vn.size(), 0);
+
+	clock_t t0 = clock();
+	for(int i = 0; i < vn.size(); i++) v1[i] = compute_binomial_pvalue_exact(vn[i], vp[i], vx[i]);
+	clock_t t1 = clock();
+
+	binomial_engine &be = binomial_engine::local();
+	be.clear();
+	for(int i = 0; i < vn.size(); i++) v2[i] = be.pvalue(vn[i], vp[i], vx[i]);
+	clock_t t2 = clock();
+
+	double abs_err = 0;
+	double rel_err = 0;
+	double approx_abs_err = 0;
+	for(int i = 0; i < vn.size(); i++)
+	{
+		double e = fabs(v1[i] - v2[i]);
+		if(e > abs_err) abs_err = e;
+		if(v1[i] >= 1e-6 && e / v1[i] > rel_err) rel_err = e / v1[i];
+
+		if(be.approximation(vn[i], vp[i], vx[i]) == 0) continue;
+		if(e > approx_abs_err) approx_abs_err = e;
+	}
+
+	double s1 = (t1 - t0) * 1.0 / CLOCKS_PER_SEC;
+	double s2 = (t2 - t1) * 1.0 / CLOCKS_PER_SEC;
+	printf("binomial p-value: %lu queries, exact = %.3lf sec, engine = %.3lf sec, speedup = %.1lfx\n", vn.size(), s1, s2, s1 / (s2 > 0 ? s2 : 1e-9));
+	printf("binomial p-value: cache hits = %ld, approximated = %ld, cache misses = %ld\n", be.num_hits, be.num_approx, be.num_queries - be.num_hits);
+	printf("binomial p-value: max abs error = %.3e (approximated: %.3e), max rel error (p >= 1e-6) = %.3e\n", abs_err, approx_abs_err, rel_err);
+	return 0;
+}
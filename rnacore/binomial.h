@@ -1,13 +1,63 @@
 #ifndef __BINOMIAL_H__
 #define __BINOMIAL_H__
 
+#include <stdint.h>
+#include <vector>
+
 // boost::binomial distribution
 #include "boost/math/distributions/binomial.hpp"
 using namespace boost::math;
+using namespace std;
 
 // return the score(transformed from probability)
 // that >= x is observed
 double compute_binomial_pvalue(int n, double pr, int x);
 uint32_t compute_binomial_score(int n, double pr, int x);
 
+// the same probability evaluated by boost without caching
+double compute_binomial_pvalue_exact(int n, double pr, int x);
+
+// memoising p-value engine; one instance per thread
+class binomial_engine
+{
+public:
+	binomial_engine();
+
+public:
+	static const int min_approx_trials = 1000;		// use approximation only for n >= this
+	static const int min_normal_variance = 100;		// normal approximation if n * pr * (1 - pr) >= this
+	static const int max_normal_deviation = 2;		// and x is within this many sd of the mean
+	static const int max_poisson_lambda = 20;		// poisson approximation if n * pr <= this
+	static constexpr double max_poisson_pr = 0.001;	// and pr <= this
+	static const int pr_quantum_bits = 20;			// pr is quantised to 1 / 2^20
+	static const int cache_bits = 16;				// direct-mapped cache of 2^16 entries (1.5 MB)
+
+	long num_queries;
+	long num_hits;
+	long num_approx;
+
+public:
+	static binomial_engine& local();
+	double pvalue(int n, double pr, int x);
+	int approximation(int n, double pr, int x) const;
+	int clear();
+
+private:
+	// a new entry replaces the one in its slot; q = 0 marks empty slots
+	struct cache_entry
+	{
+		int64_t nx;
+		uint32_t q;
+		double p;
+	};
+	vector<cache_entry> cache;			// allocated on first use
+
+private:
+	double normal_tail(int n, double pr, int x) const;
+	double poisson_tail(int n, double pr, int x) const;
+};
+
+// testing
+int test_binomial_pvalue();
+
 #endif
@@ -21,6 +21,7 @@ bundle_base::bundle_base()
 	lpos = 1 << 30;
 	rpos = 0;
 	strand = '.';
+	dup_pos = -1;
 	//unbridged = -1;
 	for(int i = 0; i < INTERVAL_BUF_SIZE; i++) 
 	{
@@ -30,11 +31,20 @@ bundle_base::bundle_base()
 	}
 }
 
-int bundle_base::add_hit_intervals(const hit &ht, bam1_t *b)
+int bundle_base::add_hit_intervals(const hit &ht, const cigar_walker &cw, int max_duplicates)
 {
-	add_hit(ht);
-	add_intervals(b);
-	vector<int32_t> v = ht.extract_splices(b);
+	int d = add_hit(ht, cw, max_duplicates);
+	if(d < 0) return 0;
+
+	add_intervals(cw);
+	if(hits[d].weight >= 2)
+	{
+		// collapsed into hit d
+		hcst.increase(d, 1);
+		return 0;
+	}
+
+	vector<int32_t> v = ht.extract_splices(cw);
 	if(v.size() >= 1) 
 	{
 		if(ht.xs == '.') ht.print();
@@ -43,6 +53,14 @@ int bundle_base::add_hit_intervals(const hit &ht, bam1_t *b)
 	return 0;
 }
 
+int bundle_base::get_fragment_weight(int k) const
+{
+	assert(k >= 0 && k < frgs.size());
+	int w1 = hits[frgs[k][0]].weight;
+	int w2 = hits[frgs[k][1]].weight;
+	return (w1 < w2) ? w1 : w2;
+}
+
 int bundle_base::add_borrowed_path(const vector<int32_t> &p, double w)
 {
 	assert(p.size() % 2 == 0);
@@ -67,18 +85,42 @@ int bundle_base::add_borrowed_path(const vector<int32_t> &p, double w)
 	return 0;
 }
 
-int bundle_base::add_hit(const hit &ht)
+int bundle_base::add_hit(const hit &ht, const cigar_walker &cw, int max_duplicates)
 {
-	if(hits.size() >= 1)
+	// identical alignments (same blocks, mate, flag and strand) starting at the
+	// same position are stored once with a multiplicity, up to max_duplicates
+	// (0 for no limit); return the index of the hit, or -1 if ht is dropped
+	if(ht.pos != dup_pos)
 	{
-		hit &p = hits.back();
-		if(p.pos == ht.pos && p.rpos == ht.rpos) 
-		{
-			return 0;
-		}
+		dup_index.clear();
+		dup_blocks.clear();
+		dup_pos = ht.pos;
+	}
+
+	size_t key = cw.get_hash();
+	key = key * 1000003 + (uint32_t)(ht.mpos);
+	key = key * 1000003 + (uint32_t)(ht.isize);
+	key = key * 1000003 + (ht.flag << 16) + (ht.strand << 8) + ht.xs;
+
+	// keys may collide, so blocks are compared as well
+	auto range = dup_index.equal_range(key);
+	for(auto it = range.first; it != range.second; it++)
+	{
+		hit &p = hits[it->second.first];
+		if(p.rpos != ht.rpos || p.mpos != ht.mpos || p.isize != ht.isize) continue;
+		if(p.flag != ht.flag || p.strand != ht.strand || p.xs != ht.xs) continue;
+		if(cw.equal_blocks(dup_blocks.data() + it->second.second) == false) continue;
+
+		if(max_duplicates >= 1 && p.weight >= max_duplicates) return -1;
+		p.weight++;
+		return it->second.first;
 	}
+
 	// store new hit
 	hits.push_back(ht);
+	hits.back().weight = 1;
+	dup_index.insert(make_pair(key, PI(hits.size() - 1, dup_blocks.size())));
+	cw.append_blocks(dup_blocks);
 
 	// calcuate the boundaries on reference
 	if(ht.pos < lpos) lpos = ht.pos;
@@ -97,59 +139,48 @@ int bundle_base::add_hit(const hit &ht)
 	if(hits.size() <= 1) strand = ht.strand;
 	assert(strand == ht.strand);
 
-	return 0;
+	return hits.size() - 1;
 }
 
-int bundle_base::add_intervals(bam1_t *b)
+int bundle_base::add_intervals(const cigar_walker &cw)
 {
-	int32_t p = b->core.pos;
-	uint32_t *cigar = bam_get_cigar(b);
-
-	int z = 0;
-    for(int k = 0; k < b->core.n_cigar; k++)
+	for(int z = 0; z < cw.nm; z++)
 	{
-		if(bam_cigar_type(bam_cigar_op(cigar[k]))&2)
+		int32_t s = cw.mblocks[z * 2 + 0];
+		int32_t p = cw.mblocks[z * 2 + 1];
+
+		if(z >= INTERVAL_BUF_SIZE)
 		{
-			p += bam_cigar_oplen(cigar[k]);
+			mmap += make_pair(ROI(s, p), 1);
 		}
-
-		if(bam_cigar_op(cigar[k]) == BAM_CMATCH)
+		else
 		{
-			int32_t s = p - bam_cigar_oplen(cigar[k]);
-
-			if(z >= INTERVAL_BUF_SIZE)
+			if(s == interval_buf[z * 2 + 0] && p == interval_buf[z * 2 + 1])
 			{
-				mmap += make_pair(ROI(s, p), 1);
+				interval_cnt[z]++;
 			}
 			else
 			{
-				if(s == interval_buf[z * 2 + 0] && p == interval_buf[z * 2 + 1])
+				if(interval_buf[z * 2 + 0] != -1 && interval_buf[z * 2 + 1] != -1)
 				{
-					interval_cnt[z]++;
-				}
-				else
-				{
-					if(interval_buf[z * 2 + 0] != -1 && interval_buf[z * 2 + 1] != -1)
-					{
-						mmap += make_pair(ROI(interval_buf[z * 2 + 0], interval_buf[z * 2 + 1]), interval_cnt[z]);
-					}
-					interval_buf[z * 2 + 0] = s;
-					interval_buf[z * 2 + 1] = p;
-					interval_cnt[z] = 1;
+					mmap += make_pair(ROI(interval_buf[z * 2 + 0], interval_buf[z * 2 + 1]), interval_cnt[z]);
 				}
+				interval_buf[z * 2 + 0] = s;
+				interval_buf[z * 2 + 1] = p;
+				interval_cnt[z] = 1;
 			}
-			z++;
-		}
-		if(bam_cigar_op(cigar[k]) == BAM_CINS)
-		{
-			imap += make_pair(ROI(p - 1, p + 1), 1);
 		}
+	}
 
-		if(bam_cigar_op(cigar[k]) == BAM_CDEL)
-		{
-			int32_t s = p - bam_cigar_oplen(cigar[k]);
-			imap += make_pair(ROI(s, p), 1);
-		}
+	for(int k = 0; k < cw.ni; k++)
+	{
+		int32_t p = cw.iblocks[k * 2 + 0];
+		imap += make_pair(ROI(p - 1, p + 1), 1);
+	}
+
+	for(int k = 0; k < cw.nd; k++)
+	{
+		imap += make_pair(ROI(cw.dblocks[k * 2 + 0], cw.dblocks[k * 2 + 1]), 1);
 	}
 	return 0;
 }
@@ -166,6 +197,11 @@ int bundle_base::add_buf_intervals()
 		interval_buf[i * 2 + 1] = -1;
 		interval_cnt[i] = 0;
 	}
+
+	// no more hits will be collapsed
+	dup_pos = -1;
+	unordered_multimap<size_t, PI>().swap(dup_index);
+	vector<int32_t>().swap(dup_blocks);
 	return 0;
 }
 
@@ -197,6 +233,9 @@ int bundle_base::clear()
 	imap.clear();
 	split_interval_map().swap(mmap);
 	split_interval_map().swap(imap);
+	dup_pos = -1;
+	unordered_multimap<size_t, PI>().swap(dup_index);
+	vector<int32_t>().swap(dup_blocks);
 	return 0;
 }
 
@@ -242,6 +281,25 @@ int bundle_base::check_right_ascending()
 	return 0;
 }
 
+size_t bundle_base::get_memory_size() const
+{
+	// approximate bytes held by hits, fragments, chain sets and interval maps;
+	// a node of an interval map costs about 48 bytes besides its value
+	size_t s = sizeof(bundle_base);
+	s += hits.capacity() * sizeof(hit);
+	for(int i = 0; i < hits.size(); i++)
+	{
+		if(hits[i].qname.size() > 15) s += hits[i].qname.capacity();
+	}
+	s += frgs.capacity() * sizeof(AI3);
+	s += splices.capacity() * sizeof(int32_t);
+	s += hcst.get_memory_size();
+	s += fcst.get_memory_size();
+	s += mmap.iterative_size() * (48 + sizeof(pair<ROI, int32_t>));
+	s += imap.iterative_size() * (48 + sizeof(pair<ROI, int32_t>));
+	return s;
+}
+
 int bundle_base::print(int index)
 {
 	printf("bundle_base%d: ", index);
@@ -261,6 +319,12 @@ int bundle_base::print(int index)
 	return 0;
 }
 
+static size_t mate_key(int32_t pos, int32_t mpos, int32_t isize)
+{
+	size_t key = ((size_t)((uint32_t)(pos)) << 32) | (uint32_t)(mpos);
+	return key * 1000003 + (uint32_t)(isize);
+}
+
 int bundle_base::build_fragments()
 {
 	frgs.clear();
@@ -284,6 +348,16 @@ int bundle_base::build_fragments()
 		vv[k].push_back(i);
 	}
 
+	// collapsed hits may keep the names of different reads than their
+	// mates, so they are also indexed by position only
+	unordered_map<size_t, vector<int>> cv;
+	for(int i = 0; i < hits.size(); i++)
+	{
+		const hit &h = hits[i];
+		if(h.hid < 0 || h.weight <= 1) continue;
+		cv[mate_key(h.pos, h.mpos, h.isize)].push_back(i);
+	}
+
 	for(int i = 0; i < hits.size(); i++)
 	{
 		const hit &h = hits[i];
@@ -307,7 +381,25 @@ int bundle_base::build_fragments()
 			break;
 		}
 
+		// collapsed mates may keep the names of different reads
+		if(x == -1 && h.weight >= 2)
+		{
+			auto it = cv.find(mate_key(h.mpos, h.pos, 0 - h.isize));
+			for(int j = 0; it != cv.end() && j < it->second.size(); j++)
+			{
+				int u = it->second[j];
+				const hit &z = hits[u];
+				if(u == i) continue;
+				if(paired[u] == true) continue;
+				if(z.pos != h.mpos || z.mpos != h.pos) continue;
+				if(z.isize + h.isize != 0) continue;
+				x = u;
+				break;
+			}
+		}
+
 		if(x == -1) continue;
+		if(hits[x].qname != h.qname) hits[x].qname = h.qname;
 
 		assert(i != x);
 		frgs.push_back(AI3({i, x, 0}));
@@ -334,6 +426,12 @@ int bundle_base::count_unbridged()
 
 int bundle_base::build_phase_set(phase_set &ps, splice_graph &gr)
 {
+	// hits come in increasing pos, so their first vertices are located in one walk
+	vector<int32_t> hp(hits.size());
+	for(int i = 0; i < hits.size(); i++) hp[i] = hits[i].pos;
+	vector<int> hv;
+	gr.locate_vertices(hp, hv);
+
 	vector<int> fb(hits.size(), -1);
 	for(int i = 0; i < frgs.size(); i++)
 	{
@@ -352,7 +450,7 @@ int bundle_base::build_phase_set(phase_set &ps, splice_graph &gr)
 			continue;
 		}
 
-		int u1 = gr.locate_vertex(hits[h1].pos);
+		int u1 = hv[h1];
 		int u2 = gr.locate_vertex(hits[h2].rpos - 1);
 
 		if(u1 < 0 || u2 < 0) continue;
@@ -387,7 +485,7 @@ int bundle_base::build_phase_set(phase_set &ps, splice_graph &gr)
 		fb[h1] = 1;			// bridged
 		fb[h2] = 1;			// bridged
 
-		ps.add(xy, 1);
+		ps.add(xy, get_fragment_weight(i));
 	}
 
 	for(int i = 0; i < hits.size(); i++)
@@ -395,7 +493,7 @@ int bundle_base::build_phase_set(phase_set &ps, splice_graph &gr)
 		if(fb[i] >= 0) continue;
 		if(hits[i].hid < 0) continue;
 
-		int u1 = gr.locate_vertex(hits[i].pos);
+		int u1 = hv[i];
 		int u2 = gr.locate_vertex(hits[i].rpos - 1);
 
 		if(u1 < 0 || u2 < 0) continue;
@@ -409,7 +507,7 @@ int bundle_base::build_phase_set(phase_set &ps, splice_graph &gr)
 		bool b = check_increasing_sequence(xy);
 		if(b == false) continue;
 
-		ps.add(xy, 1);
+		ps.add(xy, hits[i].weight);
 	}
 	return 0;
 }
@@ -455,6 +553,7 @@ int bundle_base::update_bridges(const vector<int> &frlist, const vector<int32_t>
 		if(h1.rpos < h2.pos && check_increasing_sequence(v1) == false) continue;
 
 		cnt++;
+		int w = get_fragment_weight(k);
 
 		if(chain.size() <= 0)
 		{
@@ -481,14 +580,14 @@ int bundle_base::update_bridges(const vector<int> &frlist, const vector<int32_t>
 			if(s == ss)
 			{
 				//if(s == '.') printf("h1 = %c, h2 = %c, ss = %c\n", h1.xs, h2.xs, ss);
-				fcst.add(chain, k, ss);
+				fcst.add(chain, k, ss, w);
 			}
-			else if(s != '.' && ss == '.') fcst.add(chain, k, s);
-			else if(ss != '.' && s == '.') fcst.add(chain, k, ss);
+			else if(s != '.' && ss == '.') fcst.add(chain, k, s, w);
+			else if(ss != '.' && s == '.') fcst.add(chain, k, ss, w);
 			else 
 			{
 				//printf("h1 = %c, h2 = %c, ss = %c\n", h1.xs, h2.xs, ss);
-				fcst.add(chain, k, '.');
+				fcst.add(chain, k, '.', w);
 			}
 		}
 
@@ -497,7 +596,7 @@ int bundle_base::update_bridges(const vector<int> &frlist, const vector<int32_t>
 			int32_t p1 = v1[k * 2 + 0];
 			int32_t p2 = v1[k * 2 + 1];
 			if(p1 >= p2) continue;
-			mmap += make_pair(ROI(p1, p2), 1);
+			mmap += make_pair(ROI(p1, p2), w);
 		}
 	}
 	return cnt;
@@ -514,6 +613,7 @@ int bundle_base::eliminate_bridge(int k)
 	assert(h2.hid >= 0);
 
 	vector<int32_t> chain = fcst.get(k).first;
+	int w = get_fragment_weight(k);
 
 	vector<int32_t> v1;
 	v1.push_back(h1.rpos);
@@ -525,11 +625,11 @@ int bundle_base::eliminate_bridge(int k)
 		int32_t p1 = v1[i * 2 + 0];
 		int32_t p2 = v1[i * 2 + 1];
 		if(p1 >= p2) continue;
-		mmap += make_pair(ROI(p1, p2), -1);
+		mmap += make_pair(ROI(p1, p2), -w);
 	}
 
 	frgs[k][2] = -1;
-	fcst.remove(k);
+	fcst.remove(k, w);
 
 	return 0;
 }
@@ -553,11 +653,11 @@ int bundle_base::eliminate_hit(int k)
 		int32_t p1 = v1[i * 2 + 0];
 		int32_t p2 = v1[i * 2 + 1];
 		if(p1 >= p2) continue;
-		mmap += make_pair(ROI(p1, p2), -1);
+		mmap += make_pair(ROI(p1, p2), -h1.weight);
 	}
 
 	h1.hid = -1;
-	hcst.remove(k);
+	hcst.remove(k, h1.weight);
 
 	return 0;
 }
@@ -599,7 +699,7 @@ int bundle_base::filter_secondary_hits()
 		if(redundant[i] == true) continue;
 		v.push_back(hits[i]);
 		vector<int32_t> chain = hcst.get(i).first;
-		if(chain.size() >= 1) s.add(chain, v.size() - 1, hits[i].xs);
+		if(chain.size() >= 1) s.add(chain, v.size() - 1, hits[i].xs, hits[i].weight);
 	}
 	hits = v;
 	hcst = s;
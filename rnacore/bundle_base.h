@@ -11,6 +11,7 @@ See LICENSE for licensing.
 #include <cstring>
 #include <string>
 #include <vector>
+#include <unordered_map>
 
 #include "hit.h"
 #include "interval_map.h"
@@ -42,6 +43,9 @@ public:
 	split_interval_map imap;		// indel interval map
 	int32_t interval_buf[INTERVAL_BUF_SIZE * 2];
 	int32_t interval_cnt[INTERVAL_BUF_SIZE];
+	int32_t dup_pos;				// position of hits in dup_index
+	unordered_multimap<size_t, PI> dup_index;	// hits starting at dup_pos, keyed by alignment, with offsets in dup_blocks
+	vector<int32_t> dup_blocks;		// blocks of hits in dup_index, to tell identical alignments from collisions
 
 public:
 	int clear();
@@ -49,7 +53,8 @@ public:
 	int compute_strand(int libtype);
 	int check_left_ascending();
 	int check_right_ascending();
-	int add_hit_intervals(const hit &ht, bam1_t *b);
+	int add_hit_intervals(const hit &ht, const cigar_walker &cw, int max_duplicates = 0);
+	int get_fragment_weight(int k) const;
 	int build_fragments();
 	int count_unbridged();
 	int build_phase_set(phase_set &ps, splice_graph &gr);
@@ -57,10 +62,11 @@ public:
 	int filter_multialigned_hits();
 	int add_borrowed_path(const vector<int32_t> &p, double w);
 	int add_buf_intervals();
+	size_t get_memory_size() const;
 
 private:
-	int add_hit(const hit &ht);
-	int add_intervals(bam1_t *b);
+	int add_hit(const hit &ht, const cigar_walker &cw, int max_duplicates);
+	int add_intervals(const cigar_walker &cw);
 	int filter_secondary_hits();
 	int eliminate_hit(int k);
 	int eliminate_bridge(int k);
@@ -0,0 +1,476 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "bundle_cache.h"
+
+#define BUNDLE_CACHE_MAGIC 0x31434442544c41ULL		// "ALTBDC1"
+
+template<typename T>
+static void put(string &s, const T &x)
+{
+	s.append((const char*)(&x), sizeof(T));
+}
+
+template<typename T>
+static void put(string &s, const vector<T> &v)
+{
+	put(s, (int32_t)(v.size()));
+	if(v.size() >= 1) s.append((const char*)(v.data()), v.size() * sizeof(T));
+}
+
+static void put(string &s, const string &x)
+{
+	put(s, (int32_t)(x.size()));
+	s.append(x);
+}
+
+static uint64_t hash_string(const string &s)
+{
+	// FNV-1a
+	uint64_t h = 14695981039346656037ULL;
+	for(int i = 0; i < s.size(); i++)
+	{
+		h ^= (unsigned char)(s[i]);
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+bundle_cache::bundle_cache(const parameters &cfg, const sample_profile &sp, const vector<sample_profile*> &cells)
+{
+	dir = cfg.bundle_cache_dir;
+	bkey = key = 0;
+	count = 0;
+	data = NULL;
+	size = 0;
+	offset = 0;
+	remaining = 0;
+
+	if(dir == "") return;
+
+	// identity of the bam file
+	struct stat st;
+	if(stat(sp.align_file.c_str(), &st) != 0)
+	{
+		dir = "";
+		return;
+	}
+
+	// boundaries depend on the file, the partition and the requested regions
+	ostringstream s1;
+	s1 << sp.align_file << " " << st.st_size << " " << st.st_mtime << " " << sp.region_partition_length;
+	s1 << " " << cfg.min_bundle_gap << " " << cfg.max_read_span;
+	for(auto &z: sp.target_regions)
+	{
+		s1 << " " << z.first;
+		for(int k = 0; k < z.second.size(); k++) s1 << ":" << z.second[k].first << "-" << z.second[k].second;
+	}
+	bkey = hash_string(s1.str());
+
+	// bundles further depend on the read filters, the library and the cells
+	ostringstream s2;
+	s2 << s1.str() << " " << sp.data_type << " " << sp.library_type;
+	s2 << " " << cfg.min_mapping_quality << " " << cfg.max_num_cigar << " " << cfg.use_second_alignment;
+	s2 << " " << cfg.uniquely_mapped_only << " " << cfg.max_duplicates << " " << cfg.skip_single_exon_transcripts;
+	s2 << " " << sp.barcode_tag;
+	for(int k = 0; k < cells.size(); k++) s2 << " " << cells[k]->barcode;
+	key = hash_string(s2.str());
+}
+
+bundle_cache::~bundle_cache()
+{
+	close();
+}
+
+bool bundle_cache::enabled() const
+{
+	return (dir != "");
+}
+
+string bundle_cache::get_file(uint64_t k, int tid, int rid) const
+{
+	char name[10240];
+	if(tid < 0) sprintf(name, "%s/%016llx.boundaries", dir.c_str(), (unsigned long long)(k));
+	else sprintf(name, "%s/%016llx.%d.%d.bundles", dir.c_str(), (unsigned long long)(k), tid, rid);
+	return string(name);
+}
+
+int bundle_cache::write_file(const string &file, const string &s) const
+{
+	// write to a temporary file and rename, so that readers never see partial files
+	string tmp = file + ".tmp";
+	ofstream fout(tmp.c_str(), ofstream::binary);
+	if(fout.fail())
+	{
+		printf("cannot write bundle cache %s\n", tmp.c_str());
+		return -1;
+	}
+	fout.write(s.c_str(), s.size());
+	fout.close();
+	if(fout.fail() || rename(tmp.c_str(), file.c_str()) != 0)
+	{
+		printf("cannot write bundle cache %s\n", file.c_str());
+		unlink(tmp.c_str());
+		return -1;
+	}
+	return 0;
+}
+
+bool bundle_cache::map_file(const string &file)
+{
+	close();
+	int fd = ::open(file.c_str(), O_RDONLY);
+	if(fd < 0) return false;
+
+	struct stat st;
+	if(fstat(fd, &st) != 0 || st.st_size <= 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(p == MAP_FAILED) return false;
+
+	data = (char*)(p);
+	size = st.st_size;
+	offset = 0;
+	return true;
+}
+
+int bundle_cache::close()
+{
+	if(data != NULL) munmap(data, size);
+	data = NULL;
+	size = 0;
+	offset = 0;
+	remaining = 0;
+	return 0;
+}
+
+template<typename T>
+bool bundle_cache::decode(T &x)
+{
+	if(offset + sizeof(T) > size) return false;
+	memcpy(&x, data + offset, sizeof(T));
+	offset += sizeof(T);
+	return true;
+}
+
+template<typename T>
+bool bundle_cache::decode(vector<T> &v)
+{
+	int32_t n;
+	if(decode(n) == false || n < 0) return false;
+	if(offset + n * sizeof(T) > size) return false;
+	v.resize(n);
+	if(n >= 1) memcpy(v.data(), data + offset, n * sizeof(T));
+	offset += n * sizeof(T);
+	return true;
+}
+
+bool bundle_cache::decode(string &s)
+{
+	int32_t n;
+	if(decode(n) == false || n < 0) return false;
+	if(offset + n > size) return false;
+	s.assign(data + offset, n);
+	offset += n;
+	return true;
+}
+
+bool bundle_cache::load_boundaries(sample_profile &sp)
+{
+	if(enabled() == false) return false;
+	if(map_file(get_file(bkey, -1, 0)) == false) return false;
+
+	uint64_t magic, k;
+	int32_t n;
+	bool b = decode(magic) && decode(k) && decode(n);
+	if(b == false || magic != BUNDLE_CACHE_MAGIC || k != bkey || n < 0)
+	{
+		close();
+		return false;
+	}
+
+	vector<vector<int32_t>> s1(n), s2(n), e1(n), e2(n);
+	vector<vector<off_t>> so(n);
+	for(int i = 0; i < n && b == true; i++)
+	{
+		b = decode(s1[i]) && decode(s2[i]) && decode(e1[i]) && decode(e2[i]) && decode(so[i]);
+	}
+	close();
+	if(b == false) return false;
+
+	sp.start1 = std::move(s1);
+	sp.start2 = std::move(s2);
+	sp.end1 = std::move(e1);
+	sp.end2 = std::move(e2);
+	sp.start_off = std::move(so);
+	printf("load boundaries of %s from bundle cache\n", sp.align_file.c_str());
+	return true;
+}
+
+int bundle_cache::save_boundaries(const sample_profile &sp)
+{
+	if(enabled() == false) return 0;
+
+	string s;
+	put(s, (uint64_t)(BUNDLE_CACHE_MAGIC));
+	put(s, bkey);
+	put(s, (int32_t)(sp.start1.size()));
+	for(int i = 0; i < sp.start1.size(); i++)
+	{
+		put(s, sp.start1[i]);
+		put(s, sp.start2[i]);
+		put(s, sp.end1[i]);
+		put(s, sp.end2[i]);
+		put(s, sp.start_off[i]);
+	}
+	return write_file(get_file(bkey, -1, 0), s);
+}
+
+bool bundle_cache::open(const sample_profile &sp, int tid, int rid, string &chrm)
+{
+	if(enabled() == false) return false;
+	if(map_file(get_file(key, tid, rid)) == false) return false;
+
+	// the region must have the same boundaries as when it was cached
+	uint64_t magic, k;
+	int32_t t, r, n;
+	off_t so;
+	int32_t e1;
+	bool b = decode(magic) && decode(k) && decode(t) && decode(r) && decode(so) && decode(e1) && decode(chrm) && decode(n);
+	if(b == false || magic != BUNDLE_CACHE_MAGIC || k != key || t != tid || r != rid || n < 0)
+	{
+		close();
+		return false;
+	}
+	if(so != sp.start_off[tid][rid] || e1 != sp.end1[tid][rid])
+	{
+		close();
+		return false;
+	}
+
+	remaining = n;
+	return true;
+}
+
+bool bundle_cache::next(bundle_base &bb, int &c, int &index)
+{
+	if(data == NULL || remaining <= 0) return false;
+
+	int32_t x, y;
+	if(decode(x) == false || decode(y) == false || decode(bb) == false)
+	{
+		printf("corrupted bundle cache, %d bundles are not loaded\n", remaining);
+		remaining = 0;
+		return false;
+	}
+
+	c = x;
+	index = y;
+	remaining--;
+	return true;
+}
+
+int bundle_cache::add(const bundle_base &bb, int c, int index)
+{
+	if(enabled() == false) return 0;
+	put(buf, (int32_t)(c));
+	put(buf, (int32_t)(index));
+	encode(bb, buf);
+	count++;
+	return 0;
+}
+
+int bundle_cache::save(const sample_profile &sp, int tid, int rid, const string &chrm)
+{
+	if(enabled() == false) return 0;
+
+	string s;
+	put(s, (uint64_t)(BUNDLE_CACHE_MAGIC));
+	put(s, key);
+	put(s, (int32_t)(tid));
+	put(s, (int32_t)(rid));
+	put(s, sp.start_off[tid][rid]);
+	put(s, sp.end1[tid][rid]);
+	put(s, chrm);
+	put(s, (int32_t)(count));
+	s.append(buf);
+
+	buf.clear();
+	string().swap(buf);
+	count = 0;
+	return write_file(get_file(key, tid, rid), s);
+}
+
+int bundle_cache::encode(const bundle_base &bb, string &s) const
+{
+	put(s, bb.tid);
+	put(s, bb.lpos);
+	put(s, bb.rpos);
+	put(s, bb.strand);
+
+	// hits without cigar, sequence and tags
+	put(s, (int32_t)(bb.hits.size()));
+	for(int i = 0; i < bb.hits.size(); i++)
+	{
+		const hit &h = bb.hits[i];
+		put(s, (const bam1_core_t&)(h));
+		put(s, h.hid);
+		put(s, h.weight);
+		put(s, h.rpos);
+		put(s, h.nh);
+		put(s, h.hi);
+		put(s, h.nm);
+		put(s, h.strand);
+		put(s, h.xs);
+		put(s, h.ts);
+		put(s, h.qname);
+	}
+
+	put(s, bb.frgs);
+	put(s, bb.splices);
+	encode(bb.hcst, s);
+	encode(bb.fcst, s);
+	encode(bb.mmap, s);
+	encode(bb.imap, s);
+	return 0;
+}
+
+int bundle_cache::encode(const chain_set &cs, string &s) const
+{
+	put(s, (int32_t)(cs.hmap.size()));
+	for(auto &z: cs.hmap)
+	{
+		put(s, (int32_t)(z.first));
+		put(s, z.second);
+	}
+
+	put(s, (int32_t)(cs.pmap.size()));
+	for(auto &z: cs.pmap)
+	{
+		put(s, z.first);
+		put(s, (int32_t)(z.second));
+	}
+
+	put(s, (int32_t)(cs.chains.size()));
+	for(int i = 0; i < cs.chains.size(); i++)
+	{
+		put(s, (int32_t)(cs.chains[i].size()));
+		for(int j = 0; j < cs.chains[i].size(); j++)
+		{
+			put(s, cs.chains[i][j].first);
+			put(s, cs.chains[i][j].second);
+		}
+	}
+	return 0;
+}
+
+int bundle_cache::encode(const split_interval_map &m, string &s) const
+{
+	put(s, (int32_t)(m.iterative_size()));
+	for(SIMI it = m.begin(); it != m.end(); it++)
+	{
+		put(s, lower(it->first));
+		put(s, upper(it->first));
+		put(s, it->second);
+	}
+	return 0;
+}
+
+bool bundle_cache::decode(bundle_base &bb)
+{
+	bb.clear();
+	if(decode(bb.tid) == false) return false;
+	if(decode(bb.lpos) == false) return false;
+	if(decode(bb.rpos) == false) return false;
+	if(decode(bb.strand) == false) return false;
+
+	int32_t n;
+	if(decode(n) == false || n < 0) return false;
+	bb.hits.reserve(n);
+	for(int i = 0; i < n; i++)
+	{
+		bam1_core_t core;
+		if(decode(core) == false) return false;
+		hit h(core, -1);
+		bool b = decode(h.hid) && decode(h.weight) && decode(h.rpos) && decode(h.nh) && decode(h.hi) && decode(h.nm);
+		b = b && decode(h.strand) && decode(h.xs) && decode(h.ts) && decode(h.qname);
+		if(b == false) return false;
+		bb.hits.push_back(std::move(h));
+	}
+
+	if(decode(bb.frgs) == false) return false;
+	if(decode(bb.splices) == false) return false;
+	if(decode(bb.hcst) == false) return false;
+	if(decode(bb.fcst) == false) return false;
+	if(decode(bb.mmap) == false) return false;
+	if(decode(bb.imap) == false) return false;
+	return true;
+}
+
+bool bundle_cache::decode(chain_set &cs)
+{
+	cs.clear();
+	int32_t n;
+	if(decode(n) == false || n < 0) return false;
+	for(int i = 0; i < n; i++)
+	{
+		int32_t h;
+		AI3 a;
+		if(decode(h) == false || decode(a) == false) return false;
+		cs.hmap.insert(make_pair(h, a));
+	}
+
+	if(decode(n) == false || n < 0) return false;
+	for(int i = 0; i < n; i++)
+	{
+		int32_t p, k;
+		if(decode(p) == false || decode(k) == false) return false;
+		cs.pmap.insert(make_pair(p, k));
+	}
+
+	if(decode(n) == false || n < 0) return false;
+	cs.chains.resize(n);
+	for(int i = 0; i < n; i++)
+	{
+		int32_t m;
+		if(decode(m) == false || m < 0) return false;
+		cs.chains[i].resize(m);
+		for(int j = 0; j < m; j++)
+		{
+			if(decode(cs.chains[i][j].first) == false) return false;
+			if(decode(cs.chains[i][j].second) == false) return false;
+		}
+	}
+	return true;
+}
+
+bool bundle_cache::decode(split_interval_map &m)
+{
+	m.clear();
+	int32_t n;
+	if(decode(n) == false || n < 0) return false;
+	for(int i = 0; i < n; i++)
+	{
+		int32_t l, r, w;
+		if(decode(l) == false || decode(r) == false || decode(w) == false) return false;
+		m.add(m.end(), make_pair(ROI(l, r), w));
+	}
+	return true;
+}
@@ -0,0 +1,69 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#ifndef __BUNDLE_CACHE_H__
+#define __BUNDLE_CACHE_H__
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "bundle_base.h"
+#include "sample_profile.h"
+#include "parameters.h"
+
+using namespace std;
+
+// on-disk cache of the region boundaries and the generated bundles of a
+// sample, keyed by the identity of the bam file and the parameters used
+// for reading it; a file that does not match the key is ignored
+class bundle_cache
+{
+public:
+	bundle_cache(const parameters &cfg, const sample_profile &sp, const vector<sample_profile*> &cells);
+	~bundle_cache();
+
+public:
+	string dir;							// cache directory, empty if disabled
+	uint64_t bkey;						// key of region boundaries
+	uint64_t key;						// key of bundles
+
+private:
+	string buf;							// encoded bundles to be saved
+	int count;							// number of bundles in buf
+	char *data;							// mapped file being loaded
+	size_t size;						// size of data
+	size_t offset;						// current position in data
+	int remaining;						// number of bundles left in data
+
+public:
+	bool enabled() const;
+	bool load_boundaries(sample_profile &sp);
+	int save_boundaries(const sample_profile &sp);
+
+	// bundles of region (tid, rid), in the order they were generated
+	bool open(const sample_profile &sp, int tid, int rid, string &chrm);
+	bool next(bundle_base &bb, int &c, int &index);
+	int close();
+	int add(const bundle_base &bb, int c, int index);
+	int save(const sample_profile &sp, int tid, int rid, const string &chrm);
+
+private:
+	string get_file(uint64_t k, int tid, int rid) const;
+	bool map_file(const string &file);
+	int write_file(const string &file, const string &s) const;
+	int encode(const bundle_base &bb, string &s) const;
+	int encode(const chain_set &cs, string &s) const;
+	int encode(const split_interval_map &m, string &s) const;
+	bool decode(bundle_base &bb);
+	bool decode(chain_set &cs);
+	bool decode(split_interval_map &m);
+	bool decode(string &s);
+	template<typename T> bool decode(T &x);
+	template<typename T> bool decode(vector<T> &v);
+};
+
+#endif
@@ -61,7 +61,7 @@ int chain_set::add(const vector<int32_t> &v, const AI3 &a)
 	return 0;
 }
 
-int chain_set::add(const vector<int32_t> &v, int h, char c)
+int chain_set::add(const vector<int32_t> &v, int h, char c, int w)
 {
 	if(v.size() <= 0)
 	{
@@ -85,7 +85,7 @@ int chain_set::add(const vector<int32_t> &v, int h, char c)
 	if(pmap.find(p) == pmap.end())
 	{
 		AI3 a = {0, 0, 0};
-		a[xs] = 1;
+		a[xs] = w;
 		vector<PVI3> vv;
 		vv.push_back(PVI3(v, a));
 		chains.push_back(vv);
@@ -104,7 +104,7 @@ int chain_set::add(const vector<int32_t> &v, int h, char c)
 			if(vv[i].first == v)
 			{
 				if(h >= 0) hmap.insert(make_pair(h, AI3({k, i, xs})));
-				vv[i].second[xs]++;
+				vv[i].second[xs] += w;
 				found = true;
 				break;
 			}
@@ -113,7 +113,7 @@ int chain_set::add(const vector<int32_t> &v, int h, char c)
 		if(found == false)
 		{
 			AI3 a = {0, 0, 0};
-			a[xs] = 1;
+			a[xs] = w;
 			vv.push_back(PVI3(v, a));
 			int n = vv.size() - 1;
 			if(h >= 0) hmap.insert(make_pair(h, AI3({k, n, xs})));
@@ -122,14 +122,25 @@ int chain_set::add(const vector<int32_t> &v, int h, char c)
 	return 0;
 }
 
-int chain_set::remove(int h)
+int chain_set::increase(int h, int w)
 {
 	if(hmap.find(h) == hmap.end()) return 0;
 	AI3 p = hmap[h];
 	assert(p[0] >= 0 && p[0] < chains.size());
 	assert(p[1] >= 0 && p[1] < chains[p[0]].size());
 	assert(p[2] >= 0 && p[2] <= 2);
-	chains[p[0]][p[1]].second[p[2]]--;
+	chains[p[0]][p[1]].second[p[2]] += w;
+	return 0;
+}
+
+int chain_set::remove(int h, int w)
+{
+	if(hmap.find(h) == hmap.end()) return 0;
+	AI3 p = hmap[h];
+	assert(p[0] >= 0 && p[0] < chains.size());
+	assert(p[1] >= 0 && p[1] < chains[p[0]].size());
+	assert(p[2] >= 0 && p[2] <= 2);
+	chains[p[0]][p[1]].second[p[2]] -= w;
 	if(chains[p[0]][p[1]].second[p[2]] <= 0) chains[p[0]][p[1]].second[p[2]] = 0;
 	hmap.erase(h);
 	return 0;
@@ -184,6 +195,21 @@ int chain_set::clear()
 	return 0;
 }
 
+size_t chain_set::get_memory_size() const
+{
+	// a node of std::map costs about 32 bytes besides its value
+	size_t s = sizeof(chain_set);
+	s += hmap.size() * (32 + sizeof(pair<int, AI3>));
+	s += pmap.size() * (32 + sizeof(pair<int32_t, int>));
+	s += chains.capacity() * sizeof(vector<PVI3>);
+	for(int i = 0; i < chains.size(); i++)
+	{
+		s += chains[i].capacity() * sizeof(PVI3);
+		for(int j = 0; j < chains[i].size(); j++) s += chains[i][j].first.capacity() * sizeof(int32_t);
+	}
+	return s;
+}
+
 vector<int32_t> chain_set::get_splices() const
 {
 	set<int32_t> s;
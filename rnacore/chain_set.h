@@ -25,13 +25,15 @@ public:
 public:
 	int add(const chain_set &cst);							// if h < 0, don't store the handle
 	int add(const vector<int32_t> &v, const AI3 &a);	// if h < 0, don't store the handle
-	int add(const vector<int32_t> &v, int h, char xs);	// if h < 0, don't store the handle
-	int remove(int h);									// remove handle and decrease count
+	int add(const vector<int32_t> &v, int h, char xs, int w = 1);	// if h < 0, don't store the handle; count w
+	int increase(int h, int w);							// increase count of the chain of handle by w
+	int remove(int h, int w = 1);						// remove handle and decrease count by w
 	int clear();										// clear everything
 	int print();										// print
 	PVI3 get(int h) const;								// get chain and return count
 	vector<int32_t> get_chain(int h) const;				// get chain
 	vector<int32_t> get_splices() const;				// get the set of all splices
+	size_t get_memory_size() const;						// approximate bytes held
 };
 
 #endif
@@ -0,0 +1,166 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#include <cassert>
+#include <cstring>
+
+#include "cigar_walker.h"
+
+// buffer of each operation: 0 for match, 1 for insertion,
+// 2 for deletion, 3 for splice, 4 for not recorded
+static const int8_t cigar_class[16] = {0, 1, 2, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4};
+
+// -1 if the operation consumes reference (M, D, N, =, X), 0 otherwise
+static const int32_t cigar_ref_mask[16] = {-1, 0, -1, -1, 0, 0, 0, -1, -1, 0, 0, 0, 0, 0, 0, 0};
+
+cigar_walker::cigar_walker()
+{
+	lpos = 0;
+	rpos = 0;
+	spliced = false;
+	nm = ni = nd = ns = 0;
+	mblocks = buf[0];
+	iblocks = buf[1];
+	dblocks = buf[2];
+	sblocks = buf[3];
+}
+
+cigar_walker::cigar_walker(const bam1_t *b)
+	: cigar_walker()
+{
+	walk(b);
+}
+
+int cigar_walker::walk(const bam1_t *b)
+{
+	return walk(b->core.pos, bam_get_cigar(b), b->core.n_cigar);
+}
+
+int cigar_walker::walk(int32_t pos, const uint32_t *cigar, int n)
+{
+	lpos = pos;
+	spliced = false;
+
+	// fast path: a single matched block
+	if(n == 1 && bam_cigar_op(cigar[0]) == BAM_CMATCH)
+	{
+		rpos = pos + bam_cigar_oplen(cigar[0]);
+		buf[0][0] = pos;
+		buf[0][1] = rpos;
+		mblocks = buf[0];
+		iblocks = buf[1];
+		dblocks = buf[2];
+		sblocks = buf[3];
+		nm = 1;
+		ni = nd = ns = 0;
+		return 0;
+	}
+
+	int32_t *out[5];
+	if(n <= CIGAR_WALKER_BUF_SIZE)
+	{
+		for(int i = 0; i < 4; i++) out[i] = buf[i];
+	}
+	else
+	{
+		if(spill.size() < 8 * n) spill.resize(8 * n);
+		for(int i = 0; i < 4; i++) out[i] = spill.data() + i * 2 * n;
+	}
+	out[4] = sink;
+
+	// table-driven: each operation writes [s, p) to the buffer of its class;
+	// unrecorded operations go to sink without advancing any counter
+	int cnt[5] = {0, 0, 0, 0, 0};
+	int32_t p = pos;
+	for(int k = 0; k < n; k++)
+	{
+		uint32_t c = cigar[k];
+		int op = bam_cigar_op(c);
+		int32_t s = p;
+		p += bam_cigar_oplen(c) & cigar_ref_mask[op];
+
+		int t = cigar_class[op];
+		if(t == 3) spliced = true;
+		if(t == 3 && (k == 0 || k == n - 1)) t = 4;
+
+		int32_t *o = out[t] + 2 * cnt[t];
+		o[0] = s;
+		o[1] = p;
+		cnt[t] += (t != 4);
+	}
+
+	rpos = p;
+	mblocks = out[0];
+	iblocks = out[1];
+	dblocks = out[2];
+	sblocks = out[3];
+	nm = cnt[0];
+	ni = cnt[1];
+	nd = cnt[2];
+	ns = cnt[3];
+	return 0;
+}
+
+vector<int32_t> cigar_walker::get_splices() const
+{
+	return vector<int32_t>(sblocks, sblocks + 2 * ns);
+}
+
+size_t cigar_walker::get_hash() const
+{
+	size_t h = (nm << 24) ^ (ni << 16) ^ (nd << 8) ^ ns;
+	const int32_t *v[4] = {mblocks, iblocks, dblocks, sblocks};
+	const int n[4] = {nm, ni, nd, ns};
+	for(int i = 0; i < 4; i++)
+	{
+		for(int k = 0; k < 2 * n[i]; k++)
+		{
+			h = h * 1000003 + (uint32_t)(v[i][k]);
+		}
+	}
+	return h;
+}
+
+int cigar_walker::append_blocks(vector<int32_t> &v) const
+{
+	v.push_back(nm);
+	v.push_back(ni);
+	v.push_back(nd);
+	v.push_back(ns);
+	v.insert(v.end(), mblocks, mblocks + 2 * nm);
+	v.insert(v.end(), iblocks, iblocks + 2 * ni);
+	v.insert(v.end(), dblocks, dblocks + 2 * nd);
+	v.insert(v.end(), sblocks, sblocks + 2 * ns);
+	return 0;
+}
+
+bool cigar_walker::equal_blocks(const int32_t *v) const
+{
+	if(v[0] != nm || v[1] != ni || v[2] != nd || v[3] != ns) return false;
+	v += 4;
+	if(memcmp(v, mblocks, 2 * nm * sizeof(int32_t)) != 0) return false;
+	v += 2 * nm;
+	if(memcmp(v, iblocks, 2 * ni * sizeof(int32_t)) != 0) return false;
+	v += 2 * ni;
+	if(memcmp(v, dblocks, 2 * nd * sizeof(int32_t)) != 0) return false;
+	v += 2 * nd;
+	if(memcmp(v, sblocks, 2 * ns * sizeof(int32_t)) != 0) return false;
+	return true;
+}
+
+int cigar_walker::encode(int32_t pos, const vector<int32_t> &chain, int32_t rpos, uint32_t *cigar)
+{
+	int n = chain.size() + 1;
+	int32_t x1 = pos;
+	for(int i = 0; i < n; i++)
+	{
+		int32_t x2 = (i < chain.size()) ? chain[i] : rpos;
+		if(x1 >= x2) return -1;
+		cigar[i] = bam_cigar_gen(x2 - x1, (i % 2 == 0) ? BAM_CMATCH : BAM_CREF_SKIP);
+		x1 = x2;
+	}
+	return n;
+}
@@ -0,0 +1,60 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#ifndef __CIGAR_WALKER_H__
+#define __CIGAR_WALKER_H__
+
+#include <stdint.h>
+#include <vector>
+
+#include "htslib/sam.h"
+
+#define CIGAR_WALKER_BUF_SIZE 32
+
+using namespace std;
+
+// decode a CIGAR in a single pass into blocks on the reference;
+// every block is stored as a pair [s, e) in one of four buffers
+class cigar_walker
+{
+public:
+	cigar_walker();
+	cigar_walker(const bam1_t *b);
+	cigar_walker(const cigar_walker &cw) = delete;
+	cigar_walker& operator=(const cigar_walker &cw) = delete;
+
+public:
+	int32_t lpos;					// leftmost position on reference
+	int32_t rpos;					// right position on reference [lpos, rpos)
+	bool spliced;					// whether any BAM_CREF_SKIP exists (including the first/last operation)
+	int nm;							// number of matched blocks (BAM_CMATCH)
+	int ni;							// number of insertions, stored as [p, p)
+	int nd;							// number of deletions
+	int ns;							// number of splices, excluding the first/last operation
+	const int32_t *mblocks;
+	const int32_t *iblocks;
+	const int32_t *dblocks;
+	const int32_t *sblocks;
+
+private:
+	int32_t buf[4][CIGAR_WALKER_BUF_SIZE * 2];	// fixed buffers for short CIGARs
+	int32_t sink[2];							// target of operations that are not recorded
+	vector<int32_t> spill;						// used only if n_cigar > CIGAR_WALKER_BUF_SIZE
+
+public:
+	int walk(const bam1_t *b);
+	int walk(int32_t pos, const uint32_t *cigar, int n);
+	vector<int32_t> get_splices() const;
+	size_t get_hash() const;			// hash of all blocks, equal for identical alignments
+	int append_blocks(vector<int32_t> &v) const;	// append the counts and all blocks to v
+	bool equal_blocks(const int32_t *v) const;		// compare with blocks written by append_blocks
+
+	// encode [pos, chain, rpos] as alternating match / skip operations;
+	// return the number of operations, or -1 if positions are not increasing
+	static int encode(int32_t pos, const vector<int32_t> &chain, int32_t rpos, uint32_t *cigar);
+};
+
+#endif
@@ -176,10 +176,9 @@ int check_strand_from_intron_coordinates(splice_graph &gr, const vector<int32_t>
 		int32_t q = v[2 * k + 1];
 		assert(p >= 0 && q >= 0);
 		if(p >= q) return -1;
-		if(gr.rindex.find(p) == gr.rindex.end()) return -1;
-		if(gr.lindex.find(q) == gr.lindex.end()) return -1;
-		int kp = gr.rindex[p];
-		int kq = gr.lindex[q];
+		int kp = gr.locate_rbound(p);
+		int kq = gr.locate_lbound(q);
+		if(kp == -1 || kq == -1) return -1;
 
 		PEB pe = gr.edge(kp, kq);
 		if(pe.second == false) return -1;
@@ -341,10 +340,9 @@ bool build_path_from_exon_coordinates(splice_graph &gr, const vector<int32_t> &v
 
 		assert(p >= 0 && q >= 0);
 		if(p >= q) return false;
-		if(gr.lindex.find(p) == gr.lindex.end()) return false;
-		if(gr.rindex.find(q) == gr.rindex.end()) return false;
-		int kp = gr.lindex[p];
-		int kq = gr.rindex[q];
+		int kp = gr.locate_lbound(p);
+		int kq = gr.locate_rbound(q);
+		if(kp == -1 || kq == -1) return false;
 		pp[k].first = kp;
 		pp[k].second = kq;
 	}
@@ -380,10 +378,9 @@ bool build_path_from_intron_coordinates(splice_graph &gr, const vector<int32_t>
 		int32_t q = v[2 * k + 1];
 		assert(p >= 0 && q >= 0);
 		if(p >= q) return false;
-		if(gr.rindex.find(p) == gr.rindex.end()) return false;
-		if(gr.lindex.find(q) == gr.lindex.end()) return false;
-		int kp = gr.rindex[p];
-		int kq = gr.lindex[q];
+		int kp = gr.locate_rbound(p);
+		int kq = gr.locate_lbound(q);
+		if(kp == -1 || kq == -1) return false;
 		pp[k].first = kp;
 		pp[k].second = kq;
 	}
@@ -537,26 +534,15 @@ bool build_bam1_t(bam1_t &b1t, const hit_core &h, const vector<int32_t> &chain)
 	}
 	assert(b1t.l_data == b1t.core.l_qname);
 
-	vector<int32_t> z;
-	z.push_back(h.pos);
-	z.insert(z.end(), chain.begin(), chain.end());
-	z.push_back(h.rpos);
-
 	// CIGAR
-	for(int i = 0; i < z.size() - 1; i++)
+	int n = cigar_walker::encode(h.pos, chain, h.rpos, (uint32_t*)(b1t.data + b1t.l_data));
+	if(n < 0)
 	{
-		int32_t x1 = z[i + 0];
-		int32_t x2 = z[i + 1];
-
-		if(x1 >= x2)
-		{
-			printf("fail to build bam1 for %s\n", h.qname.c_str());
-			return false;
-		}
-
-		if(i % 2 == 0) add_cigar_match(b1t, x1, x2);
-		else add_cigar_skip(b1t, x1, x2);
+		printf("fail to build bam1 for %s\n", h.qname.c_str());
+		return false;
 	}
+	b1t.l_data += 4 * n;
+	b1t.core.n_cigar = n;
 
 	if(h.xs !='.') bam_aux_append(&(b1t), "XS", 'A', 1, (uint8_t*)(&h.xs));
 	if(h.hi != -1) bam_aux_append(&(b1t), "HI", 'i', 4, (uint8_t*)(&h.hi));
@@ -593,27 +579,15 @@ bool build_bam1_t(bam1_t &b1t, const hit_core &h1, const hit_core &h2, const vec
 	}
 	assert(b1t.l_data == b1t.core.l_qname);
 
-	vector<int32_t> z;
-	z.push_back(h1.pos);
-	z.insert(z.end(), chain.begin(), chain.end());
-	z.push_back(h2.rpos);
-
 	// CIGAR
-	for(int i = 0; i < z.size() - 1; i++)
+	int n = cigar_walker::encode(h1.pos, chain, h2.rpos, (uint32_t*)(b1t.data + b1t.l_data));
+	if(n < 0)
 	{
-		int32_t x1 = z[i + 0];
-		int32_t x2 = z[i + 1];
-
-		if(x1 >= x2)
-		{
-			printf("fail to build bam1 for %s\n", h1.qname.c_str());
-			return false;
-		}
-
-		//assert(x1 <= x2);
-		if(i % 2 == 0) add_cigar_match(b1t, x1, x2);
-		else add_cigar_skip(b1t, x1, x2);
+		printf("fail to build bam1 for %s\n", h1.qname.c_str());
+		return false;
 	}
+	b1t.l_data += 4 * n;
+	b1t.core.n_cigar = n;
 
 	char c = h1.xs;
 	if(c == '.' && h2.xs != '.') c = h2.xs;
@@ -134,14 +134,15 @@ int graph_cluster::build_pereads_clusters(int g, vector<pereads_cluster> &vc)
 		{
 			h1 = bd.frgs[fs[zz[i][k]]][0];
 			h2 = bd.frgs[fs[zz[i][k]]][1];
+			int w = bd.get_fragment_weight(fs[zz[i][k]]);
 
-			pc.bounds[0] += bd.hits[h1].pos  - bounds[0];
-			pc.bounds[1] += bd.hits[h1].rpos - bounds[1];
-			pc.bounds[2] += bd.hits[h2].pos  - bounds[2];
-			pc.bounds[3] += bd.hits[h2].rpos - bounds[3];
+			pc.bounds[0] += (bd.hits[h1].pos  - bounds[0]) * w;
+			pc.bounds[1] += (bd.hits[h1].rpos - bounds[1]) * w;
+			pc.bounds[2] += (bd.hits[h2].pos  - bounds[2]) * w;
+			pc.bounds[3] += (bd.hits[h2].rpos - bounds[3]) * w;
 
 			pc.frlist.push_back(fs[zz[i][k]]);
-			pc.count++;
+			pc.count += w;
 			
 			if(store_hits == true)
 			{
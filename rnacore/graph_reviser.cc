@@ -11,6 +11,7 @@ See LICENSE for licensing.
 #include <iomanip>
 #include <fstream>
 #include <algorithm>
+#include <deque>
 
 #include "graph_reviser.h"
 #include "undirected_graph.h"
@@ -19,41 +20,8 @@ See LICENSE for licensing.
 
 int revise_splice_graph_full(splice_graph &gr, const parameters &cfg)
 {
-	refine_splice_graph(gr);
-
-	while(true)
-	{
-		bool b = false;
-
-		//b = remove_trivial_vertices(gr);
-		//if(b == true) continue;
-
-		b = extend_boundaries(gr);
-		if(b == true) continue;
-
-		b = remove_inner_boundaries(gr);
-		if(b == true) continue;
-
-		b = remove_small_exons(gr, cfg.min_exon_length);
-		if(b == true) refine_splice_graph(gr);
-		if(b == true) continue;
-
-		b = remove_small_junctions(gr);
-		if(b == true) refine_splice_graph(gr);
-		if(b == true) continue;
-
-		b = keep_surviving_edges(gr, cfg.min_surviving_edge_weight);
-		if(b == true) refine_splice_graph(gr);
-		if(b == true) continue;
-
-		b = remove_intron_contamination(gr, cfg.max_intron_contamination_coverage);
-		if(b == true) continue;
-
-		break;
-	}
-
-	refine_splice_graph(gr);
-
+	revise_worklist rw(gr, cfg);
+	rw.resolve();
 	return 0;
 }
 
@@ -84,42 +52,54 @@ bool extend_boundaries(splice_graph &gr)
 	for(pei = gr.edges(), it1 = pei.first, it2 = pei.second; it1 != it2; it1++)
 	{
 		edge_descriptor e = (*it1);
-		int s = e->source();
-		int t = e->target();
-		int32_t p = gr.get_vertex_info(t).lpos - gr.get_vertex_info(s).rpos;
-		double we = gr.get_edge_weight(e);
-		double ws = gr.get_vertex_weight(s);
-		double wt = gr.get_vertex_weight(t);
-
-		if(p <= 0) continue;
-		if(s == 0) continue;
-		if(t == gr.num_vertices() - 1) continue;
-
-		bool b = false;
-		if(gr.out_degree(s) == 1 && ws >= 10.0 * we * we + 10.0) b = true;
-		if(gr.in_degree(t) == 1 && wt >= 10.0 * we * we + 10.0) b = true;
+		if(is_extendable(gr, e) == false) continue;
+		extend_boundary(gr, e);
+		return true;
+	}
 
-		if(b == false) continue;
+	return false;
+}
 
-		if(gr.out_degree(s) == 1)
-		{
-			edge_descriptor ee = gr.add_edge(s, gr.num_vertices() - 1);
-			gr.set_edge_weight(ee, ws);
-			gr.set_edge_info(ee, edge_info());
-		}
-		if(gr.in_degree(t) == 1)
-		{
-			edge_descriptor ee = gr.add_edge(0, t);
-			gr.set_edge_weight(ee, wt);
-			gr.set_edge_info(ee, edge_info());
-		}
+bool is_extendable(splice_graph &gr, edge_descriptor e)
+{
+	int s = e->source();
+	int t = e->target();
+	int32_t p = gr.get_vertex_info(t).lpos - gr.get_vertex_info(s).rpos;
+	double we = gr.get_edge_weight(e);
+	double ws = gr.get_vertex_weight(s);
+	double wt = gr.get_vertex_weight(t);
+
+	if(p <= 0) return false;
+	if(s == 0) return false;
+	if(t == gr.num_vertices() - 1) return false;
+
+	if(gr.out_degree(s) == 1 && ws >= 10.0 * we * we + 10.0) return true;
+	if(gr.in_degree(t) == 1 && wt >= 10.0 * we * we + 10.0) return true;
+	return false;
+}
 
-		gr.remove_edge(e);
+int extend_boundary(splice_graph &gr, edge_descriptor e)
+{
+	int s = e->source();
+	int t = e->target();
+	double ws = gr.get_vertex_weight(s);
+	double wt = gr.get_vertex_weight(t);
 
-		return true;
+	if(gr.out_degree(s) == 1)
+	{
+		edge_descriptor ee = gr.add_edge(s, gr.num_vertices() - 1);
+		gr.set_edge_weight(ee, ws);
+		gr.set_edge_info(ee, edge_info());
+	}
+	if(gr.in_degree(t) == 1)
+	{
+		edge_descriptor ee = gr.add_edge(0, t);
+		gr.set_edge_weight(ee, wt);
+		gr.set_edge_info(ee, edge_info());
 	}
 
-	return false;
+	gr.remove_edge(e);
+	return 0;
 }
 
 VE compute_maximal_edges(splice_graph &gr)
@@ -193,111 +173,50 @@ bool remove_small_exons(splice_graph &gr, int min_exon)
 	bool flag = false;
 	for(int i = 1; i < gr.num_vertices() - 1; i++)
 	{
-		bool b = true;
-		edge_iterator it1, it2;
-		PEEI pei;
-		int32_t p1 = gr.get_vertex_info(i).lpos;
-		int32_t p2 = gr.get_vertex_info(i).rpos;
-
-		if(p2 - p1 >= min_exon) continue;
-		if(gr.degree(i) <= 0) continue;
-
-		for(pei = gr.in_edges(i), it1 = pei.first, it2 = pei.second; it1 != it2; it1++)
-		{
-			edge_descriptor e = (*it1);
-			int s = e->source();
-			//if(gr.out_degree(s) <= 1) b = false;
-			if(s != 0 && gr.get_vertex_info(s).rpos == p1) b = false;
-			if(b == false) break;
-		}
-		for(pei = gr.out_edges(i), it1 = pei.first, it2 = pei.second; it1 != it2; it1++)
-		{
-			edge_descriptor e = (*it1);
-			int t = e->target();
-			//if(gr.in_degree(t) <= 1) b = false;
-			if(t != gr.num_vertices() - 1 && gr.get_vertex_info(t).lpos == p2) b = false;
-			if(b == false) break;
-		}
-
-		if(b == false) continue;
-
-		// only consider boundary small exons
-		if(gr.edge(0, i).second == false && gr.edge(i, gr.num_vertices() - 1).second == false) continue;
-
+		if(is_small_exon(gr, i, min_exon) == false) continue;
 		gr.clear_vertex(i);
 		flag = true;
 	}
 	return flag;
 }
 
-bool remove_small_junctions(splice_graph &gr)
+bool is_small_exon(splice_graph &gr, int i, int min_exon)
 {
-	SE se;
-	for(int i = 1; i < gr.num_vertices() - 1; i++)
-	{
-		if(gr.degree(i) <= 0) continue;
-
-		bool b = true;
-		edge_iterator it1, it2;
-		PEEI pei;
-		int32_t p1 = gr.get_vertex_info(i).lpos;
-		int32_t p2 = gr.get_vertex_info(i).rpos;
-		double wi = gr.get_vertex_weight(i);
-
-		// compute max in-adjacent edge
-		double ws = 0;
-		for(pei = gr.in_edges(i), it1 = pei.first, it2 = pei.second; it1 != it2; it1++)
-		{
-			edge_descriptor e = (*it1);
-			int s = e->source();
-			double w = gr.get_vertex_weight(s);
-			if(s == 0) continue;
-			if(gr.get_vertex_info(s).rpos != p1) continue;
-			if(w < ws) continue;
-			ws = w;
-		}
+	edge_iterator it1, it2;
+	PEEI pei;
+	int32_t p1 = gr.get_vertex_info(i).lpos;
+	int32_t p2 = gr.get_vertex_info(i).rpos;
 
-		// remove small in-junction
-		for(pei = gr.in_edges(i), it1 = pei.first, it2 = pei.second; it1 != it2; it1++)
-		{
-			edge_descriptor e = (*it1);
-			int s = e->source();
-			double w = gr.get_edge_weight(e);
-			if(s == 0) continue;
-			if(gr.get_vertex_info(s).rpos == p1) continue;
-			if(ws < 2.0 * w * w + 18.0) continue;
-			if(wi < 2.0 * w * w + 18.0) continue;
-
-			se.insert(e);
-		}
+	if(p2 - p1 >= min_exon) return false;
+	if(gr.degree(i) <= 0) return false;
 
-		// compute max out-adjacent edge
-		double wt = 0;
-		for(pei = gr.out_edges(i), it1 = pei.first, it2 = pei.second; it1 != it2; it1++)
-		{
-			edge_descriptor e = (*it1);
-			int t = e->target();
-			double w = gr.get_vertex_weight(t);
-			if(t == gr.num_vertices() - 1) continue;
-			if(gr.get_vertex_info(t).lpos != p2) continue;
-			if(w < wt) continue;
-			wt = w;
-		}
+	for(pei = gr.in_edges(i), it1 = pei.first, it2 = pei.second; it1 != it2; it1++)
+	{
+		edge_descriptor e = (*it1);
+		int s = e->source();
+		//if(gr.out_degree(s) <= 1) return false;
+		if(s != 0 && gr.get_vertex_info(s).rpos == p1) return false;
+	}
+	for(pei = gr.out_edges(i), it1 = pei.first, it2 = pei.second; it1 != it2; it1++)
+	{
+		edge_descriptor e = (*it1);
+		int t = e->target();
+		//if(gr.in_degree(t) <= 1) return false;
+		if(t != gr.num_vertices() - 1 && gr.get_vertex_info(t).lpos == p2) return false;
+	}
 
-		// remove small in-junction
-		for(pei = gr.out_edges(i), it1 = pei.first, it2 = pei.second; it1 != it2; it1++)
-		{
-			edge_descriptor e = (*it1);
-			double w = gr.get_edge_weight(e);
-			int t = e->target();
-			if(t == gr.num_vertices() - 1) continue;
-			if(gr.get_vertex_info(t).lpos == p2) continue;
-			if(ws < 2.0 * w * w + 18.0) continue;
-			if(wi < 2.0 * w * w + 18.0) continue;
+	// only consider boundary small exons
+	if(gr.edge(0, i).second == false && gr.edge(i, gr.num_vertices() - 1).second == false) return false;
 
-			se.insert(e);
-		}
+	return true;
+}
 
+bool remove_small_junctions(splice_graph &gr)
+{
+	SE se;
+	for(int i = 1; i < gr.num_vertices() - 1; i++)
+	{
+		collect_small_junctions(gr, i, se);
 	}
 
 	if(se.size() <= 0) return false;
@@ -311,32 +230,78 @@ bool remove_small_junctions(splice_graph &gr)
 	return true;
 }
 
-bool remove_inner_boundaries(splice_graph &gr)
+int collect_small_junctions(splice_graph &gr, int i, SE &se)
 {
-	bool flag = false;
-	int n = gr.num_vertices() - 1;
-	for(int i = 1; i < gr.num_vertices() - 1; i++)
+	if(gr.degree(i) <= 0) return 0;
+
+	edge_iterator it1, it2;
+	PEEI pei;
+	int32_t p1 = gr.get_vertex_info(i).lpos;
+	int32_t p2 = gr.get_vertex_info(i).rpos;
+	double wi = gr.get_vertex_weight(i);
+
+	// compute max in-adjacent edge
+	double ws = 0;
+	for(pei = gr.in_edges(i), it1 = pei.first, it2 = pei.second; it1 != it2; it1++)
 	{
-		if(gr.in_degree(i) != 1) continue;
-		if(gr.out_degree(i) != 1) continue;
+		edge_descriptor e = (*it1);
+		int s = e->source();
+		double w = gr.get_vertex_weight(s);
+		if(s == 0) continue;
+		if(gr.get_vertex_info(s).rpos != p1) continue;
+		if(w < ws) continue;
+		ws = w;
+	}
 
-		PEEI pei = gr.in_edges(i);
-		edge_iterator it1 = pei.first, it2 = pei.second;
-		edge_descriptor e1 = (*it1);
+	// remove small in-junction
+	for(pei = gr.in_edges(i), it1 = pei.first, it2 = pei.second; it1 != it2; it1++)
+	{
+		edge_descriptor e = (*it1);
+		int s = e->source();
+		double w = gr.get_edge_weight(e);
+		if(s == 0) continue;
+		if(gr.get_vertex_info(s).rpos == p1) continue;
+		if(ws < 2.0 * w * w + 18.0) continue;
+		if(wi < 2.0 * w * w + 18.0) continue;
 
-		pei = gr.out_edges(i);
-		it1 = pei.first;
-		it2 = pei.second;
-		edge_descriptor e2 = (*it1);
-		vertex_info vi = gr.get_vertex_info(i);
-		int s = e1->source();
-		int t = e2->target();
+		se.insert(e);
+	}
+
+	// compute max out-adjacent edge
+	double wt = 0;
+	for(pei = gr.out_edges(i), it1 = pei.first, it2 = pei.second; it1 != it2; it1++)
+	{
+		edge_descriptor e = (*it1);
+		int t = e->target();
+		double w = gr.get_vertex_weight(t);
+		if(t == gr.num_vertices() - 1) continue;
+		if(gr.get_vertex_info(t).lpos != p2) continue;
+		if(w < wt) continue;
+		wt = w;
+	}
 
-		if(s != 0 && t != n) continue;
-		if(s != 0 && gr.out_degree(s) == 1) continue;
-		if(t != n && gr.in_degree(t) == 1) continue;
+	// remove small in-junction
+	for(pei = gr.out_edges(i), it1 = pei.first, it2 = pei.second; it1 != it2; it1++)
+	{
+		edge_descriptor e = (*it1);
+		double w = gr.get_edge_weight(e);
+		int t = e->target();
+		if(t == gr.num_vertices() - 1) continue;
+		if(gr.get_vertex_info(t).lpos == p2) continue;
+		if(ws < 2.0 * w * w + 18.0) continue;
+		if(wi < 2.0 * w * w + 18.0) continue;
+
+		se.insert(e);
+	}
+	return 0;
+}
 
-		if(vi.stddev >= 0.01) continue;
+bool remove_inner_boundaries(splice_graph &gr)
+{
+	bool flag = false;
+	for(int i = 1; i < gr.num_vertices() - 1; i++)
+	{
+		if(is_inner_boundary(gr, i) == false) continue;
 
 		//if(verbose >= 2) printf("remove inner boundary: vertex = %d, weight = %.2lf, length = %d, pos = %d-%d\n", i, gr.get_vertex_weight(i), vi.length, vi.lpos, vi.rpos);
 
@@ -346,39 +311,38 @@ bool remove_inner_boundaries(splice_graph &gr)
 	return flag;
 }
 
+bool is_inner_boundary(splice_graph &gr, int i)
+{
+	int n = gr.num_vertices() - 1;
+	if(gr.in_degree(i) != 1) return false;
+	if(gr.out_degree(i) != 1) return false;
+
+	PEEI pei = gr.in_edges(i);
+	edge_iterator it1 = pei.first, it2 = pei.second;
+	edge_descriptor e1 = (*it1);
+
+	pei = gr.out_edges(i);
+	it1 = pei.first;
+	it2 = pei.second;
+	edge_descriptor e2 = (*it1);
+	const vertex_info &vi = gr.get_vertex_info(i);
+	int s = e1->source();
+	int t = e2->target();
+
+	if(s != 0 && t != n) return false;
+	if(s != 0 && gr.out_degree(s) == 1) return false;
+	if(t != n && gr.in_degree(t) == 1) return false;
+
+	if(vi.stddev >= 0.01) return false;
+	return true;
+}
+
 bool remove_intron_contamination(splice_graph &gr, double ratio)
 {
 	bool flag = false;
 	for(int i = 1; i < gr.num_vertices(); i++)
 	{
-		if(gr.in_degree(i) != 1) continue;
-		if(gr.out_degree(i) != 1) continue;
-
-		edge_iterator it1, it2;
-		PEEI pei = gr.in_edges(i);
-		it1 = pei.first;
-		edge_descriptor e1 = (*it1);
-		pei = gr.out_edges(i);
-		it1 = pei.first;
-		edge_descriptor e2 = (*it1);
-		int s = e1->source();
-		int t = e2->target();
-		double wv = gr.get_vertex_weight(i);
-		vertex_info vi = gr.get_vertex_info(i);
-
-		if(s == 0) continue;
-		if(t == gr.num_vertices() - 1) continue;
-		if(gr.get_vertex_info(s).rpos != vi.lpos) continue;
-		if(gr.get_vertex_info(t).lpos != vi.rpos) continue;
-
-		PEB p = gr.edge(s, t);
-		if(p.second == false) continue;
-
-		edge_descriptor ee = p.first;
-		double we = gr.get_edge_weight(ee);
-
-		if(wv > we) continue;
-		if(wv > ratio) continue;
+		if(is_intron_contamination(gr, i, ratio) == false) continue;
 
 		//if(verbose >= 2) printf("clear intron contamination %d, weight = %.2lf, length = %d, edge weight = %.2lf\n", i, wv, vi.length, we); 
 
@@ -388,7 +352,54 @@ bool remove_intron_contamination(splice_graph &gr, double ratio)
 	return flag;
 }
 
+bool is_intron_contamination(splice_graph &gr, int i, double ratio)
+{
+	if(gr.in_degree(i) != 1) return false;
+	if(gr.out_degree(i) != 1) return false;
+
+	edge_iterator it1, it2;
+	PEEI pei = gr.in_edges(i);
+	it1 = pei.first;
+	edge_descriptor e1 = (*it1);
+	pei = gr.out_edges(i);
+	it1 = pei.first;
+	edge_descriptor e2 = (*it1);
+	int s = e1->source();
+	int t = e2->target();
+	double wv = gr.get_vertex_weight(i);
+	const vertex_info &vi = gr.get_vertex_info(i);
+
+	if(s == 0) return false;
+	if(t == gr.num_vertices() - 1) return false;
+	if(gr.get_vertex_info(s).rpos != vi.lpos) return false;
+	if(gr.get_vertex_info(t).lpos != vi.rpos) return false;
+
+	PEB p = gr.edge(s, t);
+	if(p.second == false) return false;
+
+	edge_descriptor ee = p.first;
+	double we = gr.get_edge_weight(ee);
+
+	if(wv > we) return false;
+	if(wv > ratio) return false;
+	return true;
+}
+
 bool keep_surviving_edges(splice_graph &gr, double surviving)
+{
+	VE ve = compute_unsurviving_edges(gr, surviving);
+
+	for(int i = 0; i < ve.size(); i++)
+	{
+		//if(verbose >= 2) printf("remove edge (%d, %d), weight = %.2lf\n", ve[i]->source(), ve[i]->target(), gr.get_edge_weight(ve[i]));
+		gr.remove_edge(ve[i]);
+	}
+
+	if(ve.size() >= 1) return true;
+	else return false;
+}
+
+VE compute_unsurviving_edges(splice_graph &gr, double surviving)
 {
 	set<int> sv1;
 	set<int> sv2;
@@ -458,14 +469,7 @@ bool keep_surviving_edges(splice_graph &gr, double surviving)
 		ve.push_back(*it1);
 	}
 
-	for(int i = 0; i < ve.size(); i++)
-	{
-		//if(verbose >= 2) printf("remove edge (%d, %d), weight = %.2lf\n", ve[i]->source(), ve[i]->target(), gr.get_edge_weight(ve[i]));
-		gr.remove_edge(ve[i]);
-	}
-
-	if(ve.size() >= 1) return true;
-	else return false;
+	return ve;
 }
 
 int keep_surviving_edges(splice_graph &gr, const set<PI32> &js, double surviving)
@@ -898,17 +902,39 @@ int filter_graph(splice_graph &gr, const set<int32_t> &js, const set<int32_t> &a
 
 int refine_splice_graph(splice_graph &gr)
 {
-	while(true)
+	// clearing a vertex can only make its neighbors removable
+	int n = gr.num_vertices() - 1;
+	vector<bool> queued(n + 1, false);
+	deque<int> q;
+	for(int i = 1; i < n; i++)
 	{
-		bool b = false;
-		for(int i = 1; i < gr.num_vertices() - 1; i++)
+		q.push_back(i);
+		queued[i] = true;
+	}
+
+	while(q.size() >= 1)
+	{
+		int i = q.front();
+		q.pop_front();
+		queued[i] = false;
+
+		if(gr.degree(i) == 0) continue;
+		if(gr.in_degree(i) >= 1 && gr.out_degree(i) >= 1) continue;
+
+		vector<int> sv;
+		PEEI pei = gr.in_edges(i);
+		for(edge_iterator it = pei.first; it != pei.second; it++) sv.push_back((*it)->source());
+		pei = gr.out_edges(i);
+		for(edge_iterator it = pei.first; it != pei.second; it++) sv.push_back((*it)->target());
+		gr.clear_vertex(i);
+
+		for(int j = 0; j < sv.size(); j++)
 		{
-			if(gr.degree(i) == 0) continue;
-			if(gr.in_degree(i) >= 1 && gr.out_degree(i) >= 1) continue;
-			gr.clear_vertex(i);
-			b = true;
+			int k = sv[j];
+			if(k <= 0 || k >= n || queued[k] == true) continue;
+			q.push_back(k);
+			queued[k] = true;
 		}
-		if(b == false) break;
 	}
 	return 0;
 }
@@ -1305,16 +1331,18 @@ int remove_false_boundaries(splice_graph &gr, bundle_base &bb, const parameters
 
 		//printf("%s: u1 = %d, %d-%d, u2 = %d, %d-%d, h1.rpos = %d, h2.lpos = %d\n", h1.qname.c_str(), u1, v1.lpos, v1.rpos, u2, v2.lpos, v2.rpos, h1.rpos, h2.pos);
 
+		int w = bb.get_fragment_weight(i);
+
 		//if(gr.get_vertex_info(u1).rpos == h1.rpos)
 		{
-			if(fb1.find(u1) != fb1.end()) fb1[u1]++;
-			else fb1.insert(make_pair(u1, 1));
+			if(fb1.find(u1) != fb1.end()) fb1[u1] += w;
+			else fb1.insert(make_pair(u1, w));
 		}
 
 		//if(gr.get_vertex_info(u2).lpos == h2.pos)
 		{
-			if(fb2.find(u2) != fb2.end()) fb2[u2]++;
-			else fb2.insert(make_pair(u2, 1));
+			if(fb2.find(u2) != fb2.end()) fb2[u2] += w;
+			else fb2.insert(make_pair(u2, w));
 		}
 	}
 
@@ -1399,8 +1427,9 @@ int catch_false_boundaries(splice_graph &gr, bundle_base &bb, const parameters &
 		//printf("%s: u1 = %d, %d-%d, u2 = %d, %d-%d, h1.rpos = %d, h2.lpos = %d\n", h1.qname.c_str(), u1, v1.lpos, v1.rpos, u2, v2.lpos, v2.rpos, h1.rpos, h2.pos);
 
 		PI p(u1, u2);
-		if(fb.find(p) != fb.end()) fb[p]++;
-		else fb.insert(make_pair(p, 1));
+		int w = bb.get_fragment_weight(i);
+		if(fb.find(p) != fb.end()) fb[p] += w;
+		else fb.insert(make_pair(p, w));
 	}
 
 	for(auto &x : fb)
@@ -1419,3 +1448,211 @@ int catch_false_boundaries(splice_graph &gr, bundle_base &bb, const parameters &
 
 	return 0;
 }
+
+revise_worklist::revise_worklist(splice_graph &g, const parameters &c)
+	: gr(g), cfg(c)
+{
+	n = gr.num_vertices() - 1;
+	vs.assign(4, set<int>());
+	for(int i = 1; i < n; i++)
+	{
+		for(int k = 0; k < vs.size(); k++) vs[k].insert(i);
+		rs.insert(i);
+	}
+	edge_iterator it1, it2;
+	PEEI pei;
+	for(pei = gr.edges(), it1 = pei.first, it2 = pei.second; it1 != it2; it1++) es.insert(*it1);
+	surviving = true;
+}
+
+int revise_worklist::resolve()
+{
+	refine();
+
+	while(true)
+	{
+		bool b = false;
+
+		b = extend_boundaries();
+		if(b == true) continue;
+
+		b = remove_vertices(REVISE_INNER_BOUNDARY);
+		if(b == true) continue;
+
+		b = remove_vertices(REVISE_SMALL_EXON);
+		if(b == true) refine();
+		if(b == true) continue;
+
+		b = remove_small_junctions();
+		if(b == true) refine();
+		if(b == true) continue;
+
+		b = keep_surviving_edges();
+		if(b == true) refine();
+		if(b == true) continue;
+
+		b = remove_vertices(REVISE_INTRON_CONTAMINATION);
+		if(b == true) continue;
+
+		break;
+	}
+
+	refine();
+	return 0;
+}
+
+int revise_worklist::touch(int s, int t)
+{
+	// items whose rules read the degrees or the edges of s and t
+	if(s > 0 && s < n) rs.insert(s);
+	if(t > 0 && t < n) rs.insert(t);
+
+	set<int> sv;
+	sv.insert(s);
+	sv.insert(t);
+
+	if(s != 0)
+	{
+		PEEI pei = gr.out_edges(s);
+		for(edge_iterator it = pei.first; it != pei.second; it++)
+		{
+			sv.insert((*it)->target());
+			es.insert(*it);
+		}
+	}
+	if(t != n)
+	{
+		PEEI pei = gr.in_edges(t);
+		for(edge_iterator it = pei.first; it != pei.second; it++)
+		{
+			sv.insert((*it)->source());
+			es.insert(*it);
+		}
+	}
+
+	for(set<int>::iterator it = sv.begin(); it != sv.end(); it++)
+	{
+		int k = (*it);
+		if(k <= 0 || k >= n) continue;
+		for(int j = 0; j < vs.size(); j++) vs[j].insert(k);
+	}
+
+	surviving = true;
+	return 0;
+}
+
+int revise_worklist::remove_edge(edge_descriptor e)
+{
+	int s = e->source();
+	int t = e->target();
+	es.erase(e);
+	gr.remove_edge(e);
+	touch(s, t);
+	return 0;
+}
+
+int revise_worklist::clear_vertex(int i)
+{
+	VE ve;
+	PEEI pei = gr.in_edges(i);
+	for(edge_iterator it = pei.first; it != pei.second; it++) ve.push_back(*it);
+	pei = gr.out_edges(i);
+	for(edge_iterator it = pei.first; it != pei.second; it++) ve.push_back(*it);
+
+	for(int k = 0; k < ve.size(); k++) remove_edge(ve[k]);
+	return 0;
+}
+
+int revise_worklist::refine()
+{
+	// same as refine_splice_graph, restricted to vertices touched since
+	while(rs.size() >= 1)
+	{
+		int i = *(rs.begin());
+		rs.erase(rs.begin());
+
+		if(gr.degree(i) == 0) continue;
+		if(gr.in_degree(i) >= 1 && gr.out_degree(i) >= 1) continue;
+		clear_vertex(i);
+	}
+	return 0;
+}
+
+bool revise_worklist::extend_boundaries()
+{
+	// the first extendable edge in the order of gr.edges()
+	while(es.size() >= 1)
+	{
+		edge_descriptor e = *(es.begin());
+		es.erase(es.begin());
+		if(is_extendable(gr, e) == false) continue;
+
+		int s = e->source();
+		int t = e->target();
+		extend_boundary(gr, e);
+		touch(s, t);
+		touch(s, n);
+		touch(0, t);
+		return true;
+	}
+	return false;
+}
+
+bool revise_worklist::remove_vertices(int type)
+{
+	// a pass in increasing order, where vertices touched behind
+	// the current one are left for the next pass
+	set<int> &s = vs[type];
+	bool flag = false;
+	int i = 0;
+	while(true)
+	{
+		set<int>::iterator it = s.lower_bound(i);
+		if(it == s.end()) break;
+		i = (*it);
+		s.erase(it);
+
+		bool b = false;
+		if(type == REVISE_INNER_BOUNDARY) b = is_inner_boundary(gr, i);
+		if(type == REVISE_SMALL_EXON) b = is_small_exon(gr, i, cfg.min_exon_length);
+		if(type == REVISE_INTRON_CONTAMINATION) b = is_intron_contamination(gr, i, cfg.max_intron_contamination_coverage);
+		if(b == false) continue;
+
+		clear_vertex(i);
+		s.erase(i);
+		flag = true;
+	}
+	return flag;
+}
+
+bool revise_worklist::remove_small_junctions()
+{
+	set<int> &s = vs[REVISE_SMALL_JUNCTION];
+	SE se;
+	for(set<int>::iterator it = s.begin(); it != s.end(); it++)
+	{
+		collect_small_junctions(gr, *it, se);
+	}
+	s.clear();
+
+	if(se.size() <= 0) return false;
+
+	for(SE::iterator it = se.begin(); it != se.end(); it++)
+	{
+		remove_edge(*it);
+	}
+	return true;
+}
+
+bool revise_worklist::keep_surviving_edges()
+{
+	// a global rule, examined again only after the graph changes
+	if(surviving == false) return false;
+	surviving = false;
+
+	VE ve = compute_unsurviving_edges(gr, cfg.min_surviving_edge_weight);
+	for(int i = 0; i < ve.size(); i++) remove_edge(ve[i]);
+
+	if(ve.size() >= 1) return true;
+	else return false;
+}
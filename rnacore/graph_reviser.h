@@ -20,6 +20,7 @@ int revise_splice_graph(splice_graph &gr, const parameters &cfg);
 int revise_splice_graph_full(splice_graph &gr, const parameters &cfg);
 
 VE compute_maximal_edges(splice_graph &gr);
+VE compute_unsurviving_edges(splice_graph &gr, double surviving);
 bool extend_boundaries(splice_graph &gr);
 bool remove_trivial_vertices(splice_graph &gr);
 bool remove_small_junctions(splice_graph &gr);
@@ -27,6 +28,14 @@ bool remove_small_exons(splice_graph &gr, int min_exon);
 bool remove_inner_boundaries(splice_graph &gr);
 bool remove_intron_contamination(splice_graph &gr, double ratio);
 bool keep_surviving_edges(splice_graph &gr, double surviving);
+
+// rules of the above passes, applied to a single edge or vertex
+bool is_extendable(splice_graph &gr, edge_descriptor e);
+int extend_boundary(splice_graph &gr, edge_descriptor e);
+bool is_small_exon(splice_graph &gr, int i, int min_exon);
+bool is_inner_boundary(splice_graph &gr, int i);
+bool is_intron_contamination(splice_graph &gr, int i, double ratio);
+int collect_small_junctions(splice_graph &gr, int i, SE &se);
 int keep_surviving_edges(splice_graph &gr, const set<PI32> &js, double surviving);
 int keep_surviving_edges(splice_graph &gr, const set<int32_t> &ps, double surviving);
 int keep_surviving_edges(splice_graph &gr, const set<int32_t> &ps, const set<int32_t> &aj, double surviving);
@@ -55,4 +64,42 @@ int determine_end_boundary(splice_graph &gr, int a, int b, double &max, double &
 int remove_false_boundaries(splice_graph &gr, bundle_base &bb, const parameters &cfg);
 int catch_false_boundaries(splice_graph &gr, bundle_base &bb, const parameters &cfg);
 
+#define REVISE_INNER_BOUNDARY 0
+#define REVISE_SMALL_EXON 1
+#define REVISE_SMALL_JUNCTION 2
+#define REVISE_INTRON_CONTAMINATION 3
+
+// revise_splice_graph_full driven by worklists: each rule only examines
+// the vertices (or edges) changed or adjacent to a change since they were
+// last examined, which are the only ones whose outcome may differ; rules
+// are applied in the same order, and to the same items, as the repeated
+// full scans, so the revised graph is identical
+class revise_worklist
+{
+public:
+	revise_worklist(splice_graph &gr, const parameters &cfg);
+
+private:
+	splice_graph &gr;
+	const parameters &cfg;
+	int n;							// index of the sink
+	vector<set<int>> vs;			// vertices to be examined by each vertex rule
+	set<int> rs;					// vertices whose degree changed since refined
+	SE es;							// edges to be examined by extend_boundaries
+	bool surviving;					// whether keep_surviving_edges may change the graph
+
+public:
+	int resolve();
+
+private:
+	int touch(int s, int t);
+	int remove_edge(edge_descriptor e);
+	int clear_vertex(int i);
+	int refine();
+	bool extend_boundaries();
+	bool remove_vertices(int type);
+	bool remove_small_junctions();
+	bool keep_surviving_edges();
+};
+
 #endif
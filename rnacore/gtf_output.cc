@@ -0,0 +1,152 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "gtf_output.h"
+#include "htslib/tbx.h"
+
+gtf_output::gtf_output()
+{
+	fout = NULL;
+	fp = NULL;
+	idx = NULL;
+}
+
+gtf_output::~gtf_output()
+{
+	close();
+}
+
+int gtf_output::open(const string &f, bool c, bool x, bool append)
+{
+	file = f;
+	tids.clear();
+	names.clear();
+
+	if(c == false)
+	{
+		fout = new ofstream;
+		if(append == true) fout->open(file.c_str(), std::ofstream::out | std::ofstream::app);
+		else fout->open(file.c_str(), std::ofstream::out);
+		if(fout->fail()) return -1;
+		return 0;
+	}
+
+	// an index cannot cover data written before, so never append to an indexed file
+	if(x == true) append = false;
+
+	fp = bgzf_open(file.c_str(), append ? "a" : "w");
+	if(fp == NULL) return -1;
+
+	if(x == false) return 0;
+
+	// as tabix: min_shift 14 and 5 levels
+	idx = hts_idx_init(0, HTS_FMT_TBI, bgzf_tell(fp), 14, 5);
+	if(idx == NULL) return -1;
+	return 0;
+}
+
+bool gtf_output::compressed() const
+{
+	return (fp != NULL);
+}
+
+bool gtf_output::indexed() const
+{
+	return (idx != NULL);
+}
+
+int gtf_output::write(gtf_buffer &gb)
+{
+	if(fout != NULL) return gb.flush(*fout);
+
+	if(fp != NULL && gb.buf.size() > 0)
+	{
+		if(bgzf_write(fp, gb.buf.c_str(), gb.buf.size()) < 0) printf("fail to write to %s\n", file.c_str());
+	}
+	gb.clear();
+	return 0;
+}
+
+int gtf_output::write(gtf_buffer &gb, const string &chrm, int32_t lpos, int32_t rpos)
+{
+	write(gb);
+	if(idx == NULL || lpos < 0) return 0;
+
+	// one index entry for all lines of a record, ending at the current offset
+	int tid = get_tid(chrm);
+	if(hts_idx_push(idx, tid, lpos, rpos, bgzf_tell(fp), 1) < 0)
+	{
+		printf("fail to index %s:%d-%d in %s, records are not sorted; index is dropped\n", chrm.c_str(), lpos, rpos, file.c_str());
+		hts_idx_destroy(idx);
+		idx = NULL;
+	}
+	return 0;
+}
+
+int gtf_output::get_tid(const string &chrm)
+{
+	map<string, int>::iterator it = tids.find(chrm);
+	if(it != tids.end()) return it->second;
+
+	int tid = names.size();
+	tids.insert(pair<string, int>(chrm, tid));
+	names.push_back(chrm);
+	return tid;
+}
+
+int gtf_output::save_index()
+{
+	if(hts_idx_finish(idx, bgzf_tell(fp)) < 0) return -1;
+
+	// tabix meta: the configuration as 6 int32 values, then
+	// the length of the names and the null-terminated names
+	const tbx_conf_t &conf = tbx_conf_gff;
+	int32_t l_nm = 0;
+	for(int i = 0; i < names.size(); i++) l_nm += names[i].size() + 1;
+
+	vector<uint8_t> meta(28 + l_nm);
+	int32_t x[7] = {conf.preset, conf.sc, conf.bc, conf.ec, conf.meta_char, conf.line_skip, l_nm};
+	memcpy(meta.data(), x, 28);
+
+	uint8_t *p = meta.data() + 28;
+	for(int i = 0; i < names.size(); i++)
+	{
+		memcpy(p, names[i].c_str(), names[i].size() + 1);
+		p += names[i].size() + 1;
+	}
+
+	if(hts_idx_set_meta(idx, meta.size(), meta.data(), 1) < 0) return -1;
+	if(hts_idx_save_as(idx, file.c_str(), NULL, HTS_FMT_TBI) < 0) return -1;
+	return 0;
+}
+
+int gtf_output::close()
+{
+	if(fout != NULL)
+	{
+		fout->close();
+		delete fout;
+		fout = NULL;
+	}
+
+	if(idx != NULL)
+	{
+		if(save_index() != 0) printf("fail to save tabix index of %s\n", file.c_str());
+		hts_idx_destroy(idx);
+		idx = NULL;
+	}
+
+	if(fp != NULL)
+	{
+		if(bgzf_close(fp) != 0) printf("fail to close %s\n", file.c_str());
+		fp = NULL;
+	}
+	return 0;
+}
@@ -0,0 +1,52 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#ifndef __GTF_OUTPUT_H__
+#define __GTF_OUTPUT_H__
+
+#include <map>
+#include <string>
+#include <vector>
+#include <fstream>
+
+#include "htslib/bgzf.h"
+#include "htslib/hts.h"
+#include "gtf_buffer.h"
+
+using namespace std;
+
+// an output file of plain text or BGZF; a BGZF file can be
+// indexed by tabix (GFF preset) while it is written, in
+// which case records must be sorted by chrm and position,
+// and no thread pool may be attached to fp
+class gtf_output
+{
+public:
+	gtf_output();
+	~gtf_output();
+
+public:
+	string file;					// file name
+	ofstream *fout;					// plain text
+	BGZF *fp;						// compressed
+	hts_idx_t *idx;					// tabix index, built on the fly
+	map<string, int> tids;			// chrm to index id
+	vector<string> names;			// chrm names in the order of tid
+
+public:
+	int open(const string &file, bool compressed, bool indexed, bool append);
+	int write(gtf_buffer &gb);
+	int write(gtf_buffer &gb, const string &chrm, int32_t lpos, int32_t rpos);
+	bool compressed() const;
+	bool indexed() const;
+	int close();
+
+private:
+	int get_tid(const string &chrm);
+	int save_index();
+};
+
+#endif
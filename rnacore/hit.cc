@@ -18,6 +18,7 @@ hit& hit::operator=(const hit &h)
 {
 	bam1_core_t::operator=(h);
 	hid = h.hid;
+	weight = h.weight;
 	rpos = h.rpos;
 	qname = h.qname;
 	strand = h.strand;
@@ -34,6 +35,7 @@ hit::hit(const hit &h)
 	:bam1_core_t(h)
 {
 	hid = h.hid;
+	weight = h.weight;
 	rpos = h.rpos;
 	qname = h.qname;
 	strand = h.strand;
@@ -50,7 +52,12 @@ hit::~hit()
 }
 
 hit::hit(bam1_t *b, int id)
-	:bam1_core_t(b->core), hid(id)
+	:hit(b, id, cigar_walker(b))
+{
+}
+
+hit::hit(bam1_t *b, int id, const cigar_walker &cw)
+	:bam1_core_t(b->core), hid(id), weight(1)
 {
 	// fetch query name
 	char buf[1024];
@@ -60,47 +67,32 @@ hit::hit(bam1_t *b, int id)
 	buf[l] = '\0';
 	qname = string(buf);
 
-	// compute rpos
-	rpos = pos + (int32_t)bam_cigar2rlen(n_cigar, bam_get_cigar(b));
+	// rpos from the decoded CIGAR
+	assert(cw.lpos == pos);
+	rpos = cw.rpos;
 }
 
-bool hit::contain_splices(bam1_t *b) const
+hit::hit(const bam1_core_t &core, int id)
+	:bam1_core_t(core), hid(id), weight(1)
 {
-	uint32_t *cigar = bam_get_cigar(b);
-    for(int k = 0; k < n_cigar; k++)
-	{
-		if(bam_cigar_op(cigar[k]) == BAM_CREF_SKIP) return true;
-	}
-	return false;
+	// for hits restored without the alignment
+	rpos = pos;
+	nh = -1;
+	hi = -1;
+	nm = 0;
+	strand = '.';
+	xs = '.';
+	ts = '.';
 }
 
-vector<int32_t> hit::extract_splices(bam1_t *b) const
+bool hit::contain_splices(const cigar_walker &cw) const
 {
-	vector<int32_t> spos;
-	uint32_t *cigar = bam_get_cigar(b);
-	int32_t p = pos;
-	int32_t q = 0;
-    for(int k = 0; k < n_cigar; k++)
-	{
-		if (bam_cigar_type(bam_cigar_op(cigar[k]))&2)
-			p += bam_cigar_oplen(cigar[k]);
-
-		if (bam_cigar_type(bam_cigar_op(cigar[k]))&1)
-			q += bam_cigar_oplen(cigar[k]);
-
-		if(k == 0 || k == n_cigar - 1) continue;
-		if(bam_cigar_op(cigar[k]) != BAM_CREF_SKIP) continue;
-		//if(bam_cigar_op(cigar[k-1]) != BAM_CMATCH) continue;
-		//if(bam_cigar_op(cigar[k+1]) != BAM_CMATCH) continue;
-		////if(bam_cigar_oplen(cigar[k-1]) < min_flank) continue;
-		////if(bam_cigar_oplen(cigar[k+1]) < min_flank) continue;
-
-		int32_t s = p - bam_cigar_oplen(cigar[k]);
-		//spos.push_back(pack(s, p));
-		spos.push_back(s);
-		spos.push_back(p);
-	}
-	return spos;
+	return cw.spliced;
+}
+
+vector<int32_t> hit::extract_splices(const cigar_walker &cw) const
+{
+	return cw.get_splices();
 }
 
 int hit::set_tags(bam1_t *b)
@@ -196,8 +188,8 @@ bool hit::operator<(const hit &h) const
 int hit::print() const
 {
 	// print basic information
-	printf("Hit %s: tid = %d, hid = %d, [%d-%d), mpos = %d, flag = %d, quality = %d, strand = %c, xs = %c, ts = %c, isize = %d, hi = %d\n", 
-			qname.c_str(), tid, hid, pos, rpos, mpos, flag, qual, strand, xs, ts, isize, hi);
+	printf("Hit %s: tid = %d, hid = %d, [%d-%d), mpos = %d, flag = %d, quality = %d, strand = %c, xs = %c, ts = %c, isize = %d, hi = %d, weight = %d\n", 
+			qname.c_str(), tid, hid, pos, rpos, mpos, flag, qual, strand, xs, ts, isize, hi, weight);
 
 	return 0;
 
@@ -11,6 +11,7 @@ See LICENSE for licensing.
 #include <vector>
 
 #include "htslib/sam.h"
+#include "cigar_walker.h"
 
 using namespace std;
 
@@ -67,6 +68,8 @@ class hit: public bam1_core_t
 {
 public:
 	hit(bam1_t *b, int id);
+	hit(bam1_t *b, int id, const cigar_walker &cw);
+	hit(const bam1_core_t &core, int id);
 	hit(const hit &h);
 	virtual ~hit();
 	virtual bool operator<(const hit &h) const;
@@ -74,6 +77,7 @@ public:
 
 public:
 	int hid;								// unique id for this hit, < 0 means removed
+	int weight;								// number of identical alignments collapsed into this hit
 	int32_t rpos;							// right position mapped to reference [pos, rpos)
 	int32_t nh;								// NH aux in sam
 	int32_t hi;								// HI aux in sam
@@ -89,8 +93,8 @@ public:
 	int print() const;
 	size_t get_qhash() const;
 	bool get_concordance() const;
-	vector<int32_t> extract_splices(bam1_t *b) const;
-	bool contain_splices(bam1_t *b) const;
+	vector<int32_t> extract_splices(const cigar_walker &cw) const;
+	bool contain_splices(const cigar_walker &cw) const;
 	//int get_aligned_intervals(vector<int64_t> &v) const;
 	//size_t get_phash() const;
 	//bool equal(const hit &h) const;
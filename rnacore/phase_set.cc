@@ -9,6 +9,123 @@ See LICENSE for licensing.
 #include "constants.h"
 #include "phase_set.h"
 
+#include <algorithm>
+
+phase_set::phase_set()
+{
+	clear();
+}
+
+int phase_set::clear()
+{
+	vector<int>().swap(pids);
+	parent.assign(1, -1);
+	offset.assign(1, 0);
+	length.assign(1, 0);
+	count.assign(1, -1);
+	vector<int32_t>().swap(seq);
+	unordered_map<int64_t, int>().swap(children);
+	return 0;
+}
+
+int phase_set::extend(int p, const int32_t *x, int n)
+{
+	// follow x[0, n) from node p, splitting the label where it diverges
+	// and appending the rest as a single new label
+	int k = p;
+	int i = 0;
+	while(i < n)
+	{
+		int64_t key = (((int64_t)(k)) << 32) | (uint32_t)(x[i]);
+		unordered_map<int64_t, int>::iterator it = children.find(key);
+		if(it == children.end())
+		{
+			int c = parent.size();
+			parent.push_back(k);
+			offset.push_back(seq.size());
+			length.push_back(n - i);
+			count.push_back(-1);
+			seq.insert(seq.end(), x + i, x + n);
+			children.insert(pair<int64_t, int>(key, c));
+			return c;
+		}
+
+		int c = it->second;
+		int m = 1;
+		while(m < length[c] && i + m < n && seq[offset[c] + m] == x[i + m]) m++;
+		if(m < length[c])
+		{
+			c = split(c, m);
+			children[key] = c;
+		}
+		k = c;
+		i += m;
+	}
+	return k;
+}
+
+int phase_set::extend(int p, int32_t x)
+{
+	return extend(p, &x, 1);
+}
+
+int phase_set::split(int k, int m)
+{
+	// a new node above k takes the first m coordinates of its label
+	assert(m >= 1 && m < length[k]);
+	int q = parent.size();
+	parent.push_back(parent[k]);
+	offset.push_back(offset[k]);
+	length.push_back(m);
+	count.push_back(-1);
+
+	parent[k] = q;
+	offset[k] += m;
+	length[k] -= m;
+	int64_t key = (((int64_t)(q)) << 32) | (uint32_t)(seq[offset[k]]);
+	children.insert(pair<int64_t, int>(key, k));
+	return q;
+}
+
+int phase_set::last(int k) const
+{
+	assert(k != 0);
+	return seq[offset[k] + length[k] - 1];
+}
+
+int phase_set::ordered(vector<int> &v) const
+{
+	// all nodes, each parent before its children
+	int n = parent.size();
+	vector<int> h(n + 1, 0);
+	for(int k = 1; k < n; k++) h[parent[k] + 1]++;
+	for(int k = 0; k < n; k++) h[k + 1] += h[k];
+
+	vector<int> f(h.begin(), h.end() - 1);
+	vector<int> ch(n, 0);
+	for(int k = 1; k < n; k++) ch[f[parent[k]]++] = k;
+
+	v.assign(1, 0);
+	for(int i = 0; i < v.size(); i++)
+	{
+		int k = v[i];
+		for(int j = h[k]; j < h[k + 1]; j++) v.push_back(ch[j]);
+	}
+	assert(v.size() == n);
+	return 0;
+}
+
+int phase_set::add(int k, int c)
+{
+	if(count[k] == -1)
+	{
+		count[k] = c;
+		pids.push_back(k);
+	}
+	else count[k] += c;
+	return 0;
+}
+
 int phase_set::add(const vector<int32_t> &v, int c)
 {
 	if(v.size() <= 0)
@@ -18,17 +135,50 @@ int phase_set::add(const vector<int32_t> &v, int c)
 	}
 
 	assert(v.size() % 2 == 0);
-	if(pmap.find(v) == pmap.end()) pmap.insert(PVII(v, c));
-	else pmap[v] += c;
+	int k = extend(0, v.data(), v.size());
+	add(k, c);
 	return 0;
 }
 
+int phase_set::get_path(int k, vector<int32_t> &v) const
+{
+	v.clear();
+	for(int x = k; x != 0; x = parent[x])
+	{
+		for(int j = length[x] - 1; j >= 0; j--) v.push_back(seq[offset[x] + j]);
+	}
+	reverse(v.begin(), v.end());
+	return 0;
+}
+
+int phase_set::get_count(int k) const
+{
+	assert(count[k] != -1);
+	return count[k];
+}
+
+size_t phase_set::size() const
+{
+	return pids.size();
+}
+
+size_t phase_set::get_memory_size() const
+{
+	size_t s = sizeof(phase_set);
+	s += pids.capacity() * sizeof(int);
+	s += parent.capacity() * 4 * sizeof(int);
+	s += seq.capacity() * sizeof(int32_t);
+	s += children.size() * 32 + children.bucket_count() * sizeof(void*);
+	return s;
+}
+
 int phase_set::print()
 {
-	for(MVII::iterator it = pmap.begin(); it != pmap.end(); it++)
+	vector<int32_t> v;
+	for(int i = 0; i < pids.size(); i++)
 	{
-		const vector<int32_t> &v = it->first;
-		int c = it->second;
+		get_path(pids[i], v);
+		int c = count[pids[i]];
 		printf("phase: count = %d, exons = ( ", c);
 		printv(v);
 		printf("\n");
@@ -38,68 +188,133 @@ int phase_set::print()
 
 int phase_set::combine(const phase_set &ps)
 {
-	for(MVII::const_iterator it = ps.pmap.begin(); it != ps.pmap.end(); it++)
+	// map the nodes of ps with parents first, one label each
+	vector<int> order;
+	ps.ordered(order);
+	vector<int> m(ps.parent.size(), 0);
+	for(int i = 1; i < order.size(); i++)
 	{
-		const vector<int32_t> &v = it->first;
-		int c = it->second;
-		add(v, c);
+		int k = order[i];
+		m[k] = extend(m[ps.parent[k]], ps.seq.data() + ps.offset[k], ps.length[k]);
+	}
+
+	for(int i = 0; i < ps.pids.size(); i++)
+	{
+		int k = ps.pids[i];
+		add(m[k], ps.count[k]);
 	}
 	return 0;
 }
 
 int phase_set::project_boundaries(const map<int32_t, int32_t> &smap, const map<int32_t, int32_t> &tmap)
 {
+	// only the first and the last coordinate of a path are projected,
+	// so every label is mapped once and the last coordinate per path
 	phase_set ps;
-	for(MVII::iterator x = pmap.begin(); x != pmap.end(); x++)
+	vector<int> order;
+	ordered(order);
+	vector<int> m(parent.size(), 0);
+	vector<int32_t> x;
+	for(int i = 1; i < order.size(); i++)
+	{
+		int k = order[i];
+		x.assign(seq.begin() + offset[k], seq.begin() + offset[k] + length[k]);
+		if(parent[k] == 0)
+		{
+			map<int32_t, int32_t>::const_iterator is = smap.find(x[0]);
+			if(is != smap.end()) x[0] = is->second;
+		}
+		m[k] = ps.extend(m[parent[k]], x.data(), x.size());
+	}
+
+	for(int i = 0; i < pids.size(); i++)
 	{
-		vector<int32_t> v = x->first;
-		int c = x->second;
-		assert(v.size() % 2 == 0);
-		assert(v.size() >= 2);
-		map<int32_t, int32_t>::const_iterator is = smap.find(v.front());
-		map<int32_t, int32_t>::const_iterator it = tmap.find(v.back());
-		if(is != smap.end()) v[0] = is->second;
-		if(it != tmap.end()) v[v.size() - 1] = it->second;
-		ps.add(v, c);
+		int k = pids[i];
+		map<int32_t, int32_t>::const_iterator it = tmap.find(last(k));
+		if(it == tmap.end())
+		{
+			ps.add(m[k], count[k]);
+			continue;
+		}
+
+		// the path without its last coordinate, then the projected one
+		x.assign(seq.begin() + offset[k], seq.begin() + offset[k] + length[k] - 1);
+		if(parent[k] == 0)
+		{
+			map<int32_t, int32_t>::const_iterator is = smap.find(x[0]);
+			if(is != smap.end()) x[0] = is->second;
+		}
+		int p = ps.extend(m[parent[k]], x.data(), x.size());
+		ps.add(ps.extend(p, it->second), count[k]);
 	}
-	pmap = std::move(ps.pmap);
+
+	*this = std::move(ps);
 	return 0;
 }
 
 int phase_set::project_junctions(const map<PI32, PI32> &jm)
 {
+	// a junction is a coordinate at an odd index of the path together
+	// with the next one; the coordinate alone, when it ends a path, is
+	// not projected; y[k] is the image of prefix k with the junction it
+	// starts left open, and projected paths must stay non-decreasing
 	phase_set ps;
-	for(MVII::iterator x = pmap.begin(); x != pmap.end(); x++)
+	vector<int> order;
+	ordered(order);
+	vector<int> depth(parent.size(), 0);
+	vector<int> y(parent.size(), 0);
+	for(int i = 1; i < order.size(); i++)
 	{
-		const vector<int32_t> &v = x->first;
-		int c = x->second;
-		assert(v.size() % 2 == 0);
-		assert(v.size() >= 2);
-
-		vector<int32_t> vv;
-		vv.push_back(v.front());
-		for(int k = 0; k < v.size() / 2 - 1; k++)
+		int k = order[i];
+		int p = parent[k];
+		int d = depth[p];
+		int z = y[p];
+		int32_t u = (p == 0) ? 0 : last(p);
+		for(int j = 0; j < length[k]; j++)
 		{
-			PI32 p(v[k * 2 + 1], v[k * 2 + 2]);
-			map<PI32, PI32>::const_iterator it = jm.find(p);
-			if(it == jm.end())
+			int32_t x = seq[offset[k] + j];
+			d++;
+			if(d == 1) z = ps.extend(0, x);
+			else if(d % 2 == 1)
 			{
-				vv.push_back(v[k * 2 + 1]);
-				vv.push_back(v[k * 2 + 2]);
-			}
-			else
-			{
-				vv.push_back(it->second.first);
-				vv.push_back(it->second.second);
+				PI32 w(u, x);
+				map<PI32, PI32>::const_iterator it = jm.find(w);
+				if(it != jm.end()) w = it->second;
+				z = ps.extend(ps.extend(z, w.first), w.second);
 			}
+			u = x;
 		}
-		vv.push_back(v.back());
-		assert(v.size() == vv.size());
+		depth[k] = d;
+		y[k] = z;
+	}
+
+	vector<int> xv(pids.size());
+	for(int i = 0; i < pids.size(); i++)
+	{
+		int k = pids[i];
+		assert(depth[k] % 2 == 0);
+		xv[i] = ps.extend(y[k], last(k));
+	}
 
-		bool succeed = check_increasing_sequence(vv);
-		if(succeed == true) ps.add(vv, c);
-		//else ps.add(v, c);
+	// labels may still be split above, so check paths once all are built
+	vector<int> po;
+	ps.ordered(po);
+	vector<bool> ok(ps.parent.size(), true);
+	for(int i = 1; i < po.size(); i++)
+	{
+		int k = po[i];
+		int p = ps.parent[k];
+		const int32_t *x = ps.seq.data() + ps.offset[k];
+		bool b = ok[p] && (p == 0 || ps.last(p) <= x[0]);
+		for(int j = 1; j < ps.length[k] && b == true; j++) b = (x[j - 1] <= x[j]);
+		ok[k] = b;
 	}
-	pmap = std::move(ps.pmap);
+
+	for(int i = 0; i < pids.size(); i++)
+	{
+		if(ok[xv[i]] == true) ps.add(xv[i], count[pids[i]]);
+	}
+
+	*this = std::move(ps);
 	return 0;
 }
@@ -10,6 +10,7 @@ See LICENSE for licensing.
 #include <map>
 #include <set>
 #include <vector>
+#include <unordered_map>
 
 #include "util.h"
 
@@ -18,17 +19,48 @@ using namespace std;
 typedef pair<vector<int32_t>, int> PVII;
 typedef map<vector<int32_t>, int> MVII;
 
+// phasing paths (lists of coordinates) stored as a radix trie: a node is
+// a path prefix, identified by an integer id, whose edge from its parent
+// is labeled by a run of coordinates held in a shared array; nodes exist
+// only where paths branch or end, and are hash-consed on (parent, first
+// coordinate of the label); node 0 is the empty prefix; splitting a label
+// adds a node above an existing one, so the id of a node, and the prefix
+// it stands for, never change, but a parent may have a larger id
 class phase_set
 {
 public:
-	MVII pmap;			// hyper-edges using list-of-coordinates
+	phase_set();
+
+public:
+	vector<int> pids;			// ids of the nodes ending a path, in order of insertion
+
+private:
+	vector<int> parent;			// parent of each node
+	vector<int> offset;			// start of the label of each node in seq
+	vector<int> length;			// length of the label of each node
+	vector<int> count;			// count of the path ending at each node, -1 if none
+	vector<int32_t> seq;		// coordinates of all labels
+	unordered_map<int64_t, int> children;	// (parent, first coordinate) to node
 
 public:
 	int add(const vector<int32_t> &s, int c);
 	int combine(const phase_set &ps);
 	int project_boundaries(const map<int32_t, int32_t> &smap, const map<int32_t, int32_t> &tmap);
 	int project_junctions(const map<PI32, PI32> &jm);
+	int get_path(int pid, vector<int32_t> &v) const;
+	int get_count(int pid) const;
+	size_t size() const;
+	int clear();
+	size_t get_memory_size() const;
 	int print();
+
+private:
+	int extend(int p, const int32_t *x, int n);
+	int extend(int p, int32_t x);
+	int split(int k, int m);
+	int last(int k) const;
+	int ordered(vector<int> &v) const;
+	int add(int k, int c);
 };
 
 #endif
@@ -7,20 +7,28 @@ See LICENSE for licensing.
 #include "hit.h"
 #include "sample_profile.h"
 #include "htslib/bgzf.h"
+#include "htslib/thread_pool.h"
 #include "constants.h"
 #include "parameters.h"
 #include <cassert>
 #include <cmath>
+#include <fcntl.h>
+#include <unistd.h>
 
 mutex sample_profile::bam_lock;
 mutex sample_profile::gtf_lock;
+htsThreadPool sample_profile::hts_pool = {NULL, 0};
+int sample_profile::num_prefetch_fds = 0;
 
 sample_profile::sample_profile(int id, int32_t p)
 {
 	sample_id = id;
+	host = id;
 	sfn = NULL;
 	hdr = NULL;
+	prefetch_fd = -1;
 	individual_gtf = NULL;
+	individual_ftr = NULL;
 	data_type = DEFAULT;
 	insertsize_low = 80;
 	insertsize_high = 500;
@@ -109,37 +117,132 @@ int sample_profile::free_align_headers()
 int sample_profile::open_align_file()
 {
 	sfn = sam_open(align_file.c_str(), "r");
+	attach_thread_pool(sfn);
 	hdr = sam_hdr_read(sfn);
 	return 0;
 }
 
-int sample_profile::open_individual_ftr(const string &dir)
+int sample_profile::init_thread_pool(int n)
+{
+	if(hts_pool.pool != NULL) return 0;
+	if(n <= 0) return 0;
+	hts_pool.pool = hts_tpool_init(n);
+	hts_pool.qsize = 0;
+	if(hts_pool.pool == NULL) printf("cannot create htslib thread pool with %d threads\n", n);
+	return 0;
+}
+
+int sample_profile::free_thread_pool()
+{
+	if(hts_pool.pool == NULL) return 0;
+	hts_tpool_destroy(hts_pool.pool);
+	hts_pool.pool = NULL;
+	return 0;
+}
+
+int sample_profile::attach_thread_pool(samFile *fp)
+{
+	if(fp == NULL) return 0;
+	if(hts_pool.pool == NULL) return 0;
+	hts_set_thread_pool(fp, &hts_pool);
+	return 0;
+}
+
+int sample_profile::attach_thread_pool(BGZF *fp)
+{
+	if(fp == NULL) return 0;
+	if(hts_pool.pool == NULL) return 0;
+	bgzf_thread_pool(fp, hts_pool.pool, hts_pool.qsize);
+	return 0;
+}
+
+int sample_profile::prefetch_region(int tid, int rid)
+{
+	// hint the kernel to read the compressed blocks of region
+	// (tid, rid) while the current region is being processed
+	if(tid < 0 || tid >= start_off.size()) return 0;
+	if(rid < 0 || rid >= start_off[tid].size()) return 0;
+	if(start1[tid][rid] >= end1[tid][rid]) return 0;
+
+	off_t s = start_off[tid][rid] >> 16;
+	off_t t = -1;
+	for(int i = tid; i < start_off.size() && t < 0; i++)
+	{
+		for(int k = (i == tid ? rid + 1 : 0); k < start_off[i].size(); k++)
+		{
+			if(start1[i][k] >= end1[i][k]) continue;
+			t = start_off[i][k] >> 16;
+			break;
+		}
+	}
+
+	// the last region extends to the end of the file
+	off_t len = (t > s) ? t - s : 0;
+
+	// keep the descriptor for the next regions, unless
+	// too many are held and the generators could run out
+	bam_lock.lock();
+	if(prefetch_fd < 0 && num_prefetch_fds < max_prefetch_fds)
+	{
+		prefetch_fd = open(align_file.c_str(), O_RDONLY);
+		if(prefetch_fd >= 0) num_prefetch_fds++;
+	}
+	int fd = prefetch_fd;
+	bam_lock.unlock();
+
+	if(fd >= 0) 
+	{
+		posix_fadvise(fd, s, len, POSIX_FADV_WILLNEED);
+		return 0;
+	}
+
+	fd = open(align_file.c_str(), O_RDONLY);
+	if(fd < 0) return 0;
+	posix_fadvise(fd, s, len, POSIX_FADV_WILLNEED);
+	close(fd);
+	return 0;
+}
+
+int sample_profile::close_prefetch_file()
+{
+	if(prefetch_fd < 0) return 0;
+	close(prefetch_fd);
+	prefetch_fd = -1;
+	num_prefetch_fds--;
+	return 0;
+}
+
+int sample_profile::open_individual_ftr(const string &dir, bool bgzf)
 {
 	char file[10240];
-	sprintf(file, "%s/%d.trstFeature.csv", dir.c_str(), sample_id);
-	individual_ftr = new ofstream;
-	individual_ftr->open(file, std::ofstream::app);
-    individual_ftr->setf(ios::fixed, ios::floatfield);
-    individual_ftr->precision(2);
-	if(individual_ftr->fail()) 
+	if(bgzf == false) sprintf(file, "%s/%d.trstFeature.csv", dir.c_str(), sample_id);
+	else sprintf(file, "%s/%d.trstFeature.csv.gz", dir.c_str(), sample_id);
+
+	// features carry no coordinates, so they are compressed but not indexed
+	individual_ftr = new gtf_output;
+	if(individual_ftr->open(file, bgzf, false, true) != 0) 
 	{
 		printf("cannot open individual feature file %s\n", file);
 		exit(0);
 	}
+	if(bgzf == true) attach_thread_pool(individual_ftr->fp);
 	return 0;
 }
 
-int sample_profile::open_individual_gtf(const string &dir)
+int sample_profile::open_individual_gtf(const string &dir, bool bgzf)
 {
 	char file[10240];
-	sprintf(file, "%s/%d.gtf", dir.c_str(), sample_id);
-	individual_gtf = new ofstream;
-	individual_gtf->open(file, std::ofstream::app);
-	if(individual_gtf->fail()) 
+	if(bgzf == false) sprintf(file, "%s/%d.gtf", dir.c_str(), sample_id);
+	else sprintf(file, "%s/%d.gtf.gz", dir.c_str(), sample_id);
+
+	individual_gtf = new gtf_output;
+	if(individual_gtf->open(file, bgzf, bgzf, true) != 0) 
 	{
 		printf("cannot open individual gtf %s\n", file);
 		exit(0);
 	}
+	// no thread pool: with one, bgzf_tell is not the offset of the
+	// block being written, and the tabix index would be wrong
 	return 0;
 }
 
@@ -147,6 +250,7 @@ int sample_profile::close_individual_gtf()
 {
 	individual_gtf->close();
 	delete individual_gtf;
+	individual_gtf = NULL;
 	return 0;
 }
 
@@ -154,6 +258,7 @@ int sample_profile::close_individual_ftr()
 {
 	individual_ftr->close();
 	delete individual_ftr;
+	individual_ftr = NULL;
 	return 0;
 }
 
@@ -168,6 +273,26 @@ int sample_profile::set_batch_boundaries(int min_bundle_gap, int max_read_span)
 {
 	open_align_file();
 
+	// with requested regions, only reads overlapping them are visited through the index
+	hts_idx_t *idx = NULL;
+	vector<hts_itr_t*> qs;
+	if(target_regions.size() >= 1)
+	{
+		idx = sam_index_load(sfn, index_file.c_str());
+		if(idx == NULL) printf("cannot load index of %s, regions are ignored\n", align_file.c_str());
+	}
+
+	for(auto &z: target_regions)
+	{
+		if(idx == NULL) break;
+		for(int k = 0; k < z.second.size(); k++)
+		{
+			hts_itr_t *iter = sam_itr_queryi(idx, z.first, z.second[k].first, z.second[k].second);
+			if(iter != NULL) qs.push_back(iter);
+		}
+	}
+	int passes = (idx == NULL) ? 1 : qs.size();
+
 	start1.resize(hdr->n_targets);
 	start2.resize(hdr->n_targets);
 	start_off.resize(hdr->n_targets);
@@ -191,56 +316,67 @@ int sample_profile::set_batch_boundaries(int min_bundle_gap, int max_read_span)
 	int rid = 0;
 	int32_t rpos = 0;
 	bam1_t *b1t = bam_init1();
-    while(sam_read1(sfn, hdr, b1t) >= 0)
+	for(int j = 0; j < passes; j++)
 	{
-		bam1_core_t &p = b1t->core;
-
-		if((p.flag & 0x4) >= 1) continue;												// read is not mapped
-		//if((p.flag & 0x100) >= 1) continue;											// secondary alignment
-		//if(p.n_cigar > cfg.max_num_cigar) continue;									// ignore hits with more than max-num-cigar types
-		//if(p.qual < cfg.min_mapping_quality) continue;								// ignore hits with small quality
-		//if(p.n_cigar < 1) continue;													// should never happen
+		hts_itr_t *iter = (idx == NULL) ? NULL : qs[j];
+		while((iter == NULL ? sam_read1(sfn, hdr, b1t) : sam_itr_next(sfn, iter, b1t)) >= 0)
+		{
+			bam1_core_t &p = b1t->core;
 
-		hit ht(b1t, hid++);
-        if(fabs(ht.pos - ht.rpos) >= max_read_span) continue;
-		//ht.set_tags(b1t);
-		//ht.set_strand(library_type);
+			if((p.flag & 0x4) >= 1) continue;												// read is not mapped
+			//if((p.flag & 0x100) >= 1) continue;											// secondary alignment
+			//if(p.n_cigar > cfg.max_num_cigar) continue;									// ignore hits with more than max-num-cigar types
+			//if(p.qual < cfg.min_mapping_quality) continue;								// ignore hits with small quality
+			//if(p.n_cigar < 1) continue;													// should never happen
 
-		if(ht.tid != tid)
-		{
-			if(tid >= 0) end1[tid][rid] = rpos;
-			assert(ht.tid < start1.size());
-			tid = ht.tid;
-			rid = 0;
-			off_t offt = bgzf_tell(sfn->fp.bgzf);
-			start1[tid][rid] = ht.pos;
-			start2[tid][rid] = ht.rpos;
-			start_off[tid][rid] = offt;
-			rpos = ht.rpos;
-		}
+			hit ht(b1t, hid++);
+	        if(fabs(ht.pos - ht.rpos) >= max_read_span) continue;
+			//ht.set_tags(b1t);
+			//ht.set_strand(library_type);
 
-		if(ht.pos > rpos + min_bundle_gap)
-		{
-			if(ht.pos >= region_partition_length * (1 + rid))
+			if(ht.tid != tid)
 			{
-				end1[tid][rid] = rpos;
-				rid = ht.pos / region_partition_length;
-				assert(rid < start1[tid].size());
+				if(tid >= 0) end1[tid][rid] = rpos;
+				assert(ht.tid < start1.size());
+				tid = ht.tid;
+				rid = 0;
 				off_t offt = bgzf_tell(sfn->fp.bgzf);
 				start1[tid][rid] = ht.pos;
 				start2[tid][rid] = ht.rpos;
 				start_off[tid][rid] = offt;
+				rpos = ht.rpos;
+			}
+
+			if(ht.pos > rpos + min_bundle_gap)
+			{
+				if(ht.pos >= region_partition_length * (1 + rid))
+				{
+					end1[tid][rid] = rpos;
+					rid = ht.pos / region_partition_length;
+					assert(rid < start1[tid].size());
+					off_t offt = bgzf_tell(sfn->fp.bgzf);
+					start1[tid][rid] = ht.pos;
+					start2[tid][rid] = ht.rpos;
+					start_off[tid][rid] = offt;
+				}
 			}
-		}
 
-		if(ht.rpos > rpos) rpos = ht.rpos;
+			if(ht.rpos > rpos) rpos = ht.rpos;
+		}
 	}
 
+	// close the last region
+	if(tid >= 0) end1[tid][rid] = rpos;
+
+	for(int j = 0; j < qs.size(); j++) hts_itr_destroy(qs[j]);
+	if(idx != NULL) hts_idx_destroy(idx);
+
 	for(int i = 0; i < hdr->n_targets; i++)
 	{
 		int32_t len = hdr->target_len[i];
 		for(int k = 0; k < start1[i].size(); k++)
 		{
+			if(idx != NULL && start1[i][k] >= end1[i][k]) continue;
 			printf("boundaries of tid %d, region %d: %d(%d)-%d | %d-%d, len = %d\n", 
 					i, k, start1[i][k], start2[i][k], end1[i][k], k * region_partition_length, (k+1)* region_partition_length, len);
 		}
@@ -305,6 +441,23 @@ int sample_profile::free_index_iterators()
 	return 0;
 }
 
+int sample_profile::share_profile(const sample_profile &sp)
+{
+	// cells in a barcoded bam are profiled together by the host
+	data_type = sp.data_type;
+	library_type = sp.library_type;
+	bam_with_xs = sp.bam_with_xs;
+	spn = sp.spn;
+	num_xs = sp.num_xs;
+	insert_total = sp.insert_total;
+	insertsize_low = sp.insertsize_low;
+	insertsize_high = sp.insertsize_high;
+	insertsize_median = sp.insertsize_median;
+	insertsize_ave = sp.insertsize_ave;
+	insertsize_std = sp.insertsize_std;
+	return 0;
+}
+
 int sample_profile::print()
 {
 	printf("file = %s, type = %d\n", align_file.c_str(), data_type);
@@ -9,9 +9,11 @@ See LICENSE for licensing.
 
 #include <vector>
 #include <string>
+#include <map>
 #include <htslib/sam.h>
 #include <mutex>
 #include <fstream>
+#include "gtf_output.h"
 
 using namespace std;
 
@@ -24,12 +26,20 @@ public:
 	int sample_id;
 	string align_file;
 	string index_file;
+	string barcode_tag;					// tag of cell barcodes (e.g., CB), empty for bulk samples
+	string barcode;						// cell barcode of this sample
+	int host;							// sample that reads the alignment file shared by cells
+	vector<int> cells;					// samples read together by this host, including itself
 	samFile *sfn;
 	bam_hdr_t *hdr;
-	ofstream *individual_gtf;
-	ofstream *individual_ftr;
+	gtf_output *individual_gtf;
+	gtf_output *individual_ftr;
 	static mutex bam_lock;
 	static mutex gtf_lock;
+	static htsThreadPool hts_pool;		// decompression threads shared by all readers
+	static int num_prefetch_fds;		// descriptors kept open for readahead
+	static const int max_prefetch_fds = 256;
+	int prefetch_fd;					// kept open across regions, -1 if not yet opened
 	int data_type;
 	int spn;
 	int num_xs;
@@ -49,14 +59,15 @@ public:
 	vector<vector<int32_t>> end1;
 	vector<vector<int32_t>> end2;
 	vector<vector<off_t>> start_off;
+	map<int, vector<pair<int32_t, int32_t>>> target_regions;	// requested [start, end) of each target, empty for the whole bam
 
 public:
 	int set_batch_boundaries(int gap, int max_read_span);
 	int load_profile(const string &dir);
 	int save_profile(const string &dir);
 	int open_align_file();
-	int open_individual_gtf(const string &dir);
-	int open_individual_ftr(const string &dir);
+	int open_individual_gtf(const string &dir, bool bgzf);
+	int open_individual_ftr(const string &dir, bool bgzf);
 	int read_align_headers();
 	int read_index_iterators();
 	int free_align_headers();
@@ -64,7 +75,16 @@ public:
 	int close_individual_gtf();
 	int close_individual_ftr();
 	int close_align_file();
+	int prefetch_region(int tid, int rid);
+	int close_prefetch_file();
+	int share_profile(const sample_profile &sp);
 	int print();
+
+public:
+	static int init_thread_pool(int n);
+	static int free_thread_pool();
+	static int attach_thread_pool(samFile *fp);
+	static int attach_thread_pool(BGZF *fp);
 };
 
 #endif
@@ -17,8 +17,47 @@ See LICENSE for licensing.
 
 using namespace std;
 
+// the first k such that v[k] >= p (strict: v[k] > p), without branching
+// on the comparisons, so that the loop compiles to conditional moves
+static int search_sorted(const vector<int32_t> &v, int32_t p, bool strict)
+{
+	if(v.size() == 0) return 0;
+	const int32_t *base = v.data();
+	int n = v.size();
+	while(n > 1)
+	{
+		int h = n / 2;
+		bool b = strict ? (base[h] <= p) : (base[h] < p);
+		base = b ? base + h : base;
+		n -= h;
+	}
+	bool b = strict ? (*base <= p) : (*base < p);
+	return (base - v.data()) + (b ? 1 : 0);
+}
+
+// sort boundaries by position; vertices sharing a position keep
+// increasing order, so that the smallest one is found first
+static int sort_boundaries(vector<int32_t> &pos, vector<int> &vid)
+{
+	vector<int> k(pos.size());
+	for(int i = 0; i < k.size(); i++) k[i] = i;
+	stable_sort(k.begin(), k.end(), [&pos](int a, int b){ return pos[a] < pos[b]; });
+	vector<int32_t> pp(k.size());
+	vector<int> vv(k.size());
+	for(int i = 0; i < k.size(); i++)
+	{
+		pp[i] = pos[k[i]];
+		vv[i] = vid[k[i]];
+	}
+	pos.swap(pp);
+	vid.swap(vv);
+	return 0;
+}
+
 splice_graph::splice_graph()
-{}
+{
+	indexed = false;
+}
 
 splice_graph::splice_graph(const splice_graph &gr)
 {
@@ -27,12 +66,17 @@ splice_graph::splice_graph(const splice_graph &gr)
 	strand = gr.strand;
     reads = gr.reads;
     subgraph = gr.subgraph;
-	lindex = gr.lindex;
-	rindex = gr.rindex;
 
 	MEE x2y;
 	MEE y2x;
 	copy(gr, x2y, y2x);
+
+	// positions are the same, so is the index
+	lindex = gr.lindex;
+	lvertex = gr.lvertex;
+	rindex = gr.rindex;
+	rvertex = gr.rvertex;
+	indexed = gr.indexed;
 }
 
 int splice_graph::copy(const splice_graph &gr, MEE &x2y, MEE &y2x)
@@ -73,13 +117,22 @@ int splice_graph::clear()
 	ewrt.clear();
 	einf.clear();
 	lindex.clear();
+	lvertex.clear();
 	rindex.clear();
+	rvertex.clear();
+	indexed = false;
 	return 0;
 }
 
 splice_graph::~splice_graph()
 {}
 
+int splice_graph::add_vertex()
+{
+	indexed = false;
+	return directed_graph::add_vertex();
+}
+
 double splice_graph::get_vertex_weight(int v) const
 {
 	assert(v >= 0 && v < vwrt.size());
@@ -88,6 +141,7 @@ double splice_graph::get_vertex_weight(int v) const
 
 vertex_info & splice_graph::get_editable_vertex_info(int v)
 {
+	// for fields other than positions, which keep the index valid
 	assert(v >= 0 && v < vinf.size());
 	return vinf[v];
 }
@@ -132,6 +186,7 @@ int splice_graph::set_vertex_info(int v, const vertex_info &vi)
 	assert(v >= 0 && v < vv.size());
 	if(vinf.size() != vv.size()) vinf.resize(vv.size());
 	vinf[v] = vi;
+	indexed = false;
 	return 0;
 }
 
@@ -1087,21 +1142,28 @@ double splice_graph::compute_average_vertex_weight()
 int splice_graph::build_vertex_index()
 {
 	lindex.clear();
+	lvertex.clear();
 	rindex.clear();
+	rvertex.clear();
 	int n = num_vertices() - 1;
 	for(int i = 0; i <= n; i++)
 	{
 		const vertex_info &v = get_vertex_info(i);
-		if(i != 0) lindex.insert(pair<int32_t, int>(v.lpos, i));
-		if(i != n) rindex.insert(pair<int32_t, int>(v.rpos, i));
-	}
+		if(i != 0) lindex.push_back(v.lpos);
+		if(i != 0) lvertex.push_back(i);
+		if(i != n) rindex.push_back(v.rpos);
+		if(i != n) rvertex.push_back(i);
+	}
+	sort_boundaries(lindex, lvertex);
+	sort_boundaries(rindex, rvertex);
+	indexed = true;
 	return 0;
 }
 
 int splice_graph::determine_position_right_type(int32_t p)
 {
-	if(rindex.find(p) == rindex.end()) return -1;
-	int x = rindex[p];
+	int x = locate_rbound(p);
+	if(x == -1) return -1;
 	int n = num_vertices() - 1;
 
 	if(edge(x, n).second == true) return END_BOUNDARY;
@@ -1127,8 +1189,8 @@ int splice_graph::determine_position_right_type(int32_t p)
 
 int splice_graph::determine_position_left_type(int32_t p)
 {
-	if(lindex.find(p) == lindex.end()) return -1;
-	int x = lindex[p];
+	int x = locate_lbound(p);
+	if(x == -1) return -1;
 
 	if(edge(0, x).second == true) return START_BOUNDARY;
 
@@ -1153,18 +1215,32 @@ int splice_graph::determine_position_left_type(int32_t p)
 
 int splice_graph::locate_lbound(int32_t p)
 {
-	if(lindex.find(p) == lindex.end()) return -1;
-	else return lindex[p];
+	int k = search_sorted(lindex, p, false);
+	if(k >= lindex.size() || lindex[k] != p) return -1;
+	else return lvertex[k];
 }
 
 int splice_graph::locate_rbound(int32_t p)
 {
-	if(rindex.find(p) == rindex.end()) return -1;
-	else return rindex[p];
+	int k = search_sorted(rindex, p, false);
+	if(k >= rindex.size() || rindex[k] != p) return -1;
+	else return rvertex[k];
 }
 
 int splice_graph::locate_vertex(int32_t p)
 {
+	// vertices are disjoint and sorted, so the leftmost vertex with
+	// p < rpos is the first rpos greater than p in the index
+	if(indexed == true && rindex.size() == num_vertices() - 1)
+	{
+		int k = search_sorted(rindex, p, true);
+		if(k >= rindex.size()) return -1;
+		int m = rvertex[k];
+		const vertex_info &v = get_vertex_info(m);
+		if(m >= 1 && p >= v.lpos && p < v.rpos) return m;
+		else return -1;
+	}
+
 	int m = locate_vertex(p, 1, num_vertices() - 1);
 	assert(m >= 1 && m <= num_vertices() - 1);
 	if(m == num_vertices()) return -1;
@@ -1173,6 +1249,24 @@ int splice_graph::locate_vertex(int32_t p)
 	else return -1;
 }
 
+int splice_graph::locate_vertices(const vector<int32_t> &p, vector<int> &v)
+{
+	// locate a stream of positions in a single walk along the vertices;
+	// the walk jumps back with a binary search whenever the positions decrease
+	v.assign(p.size(), -1);
+	int n = num_vertices() - 1;
+	int k = 1;
+	for(int i = 0; i < p.size(); i++)
+	{
+		if(i >= 1 && p[i] < p[i - 1]) k = locate_vertex(p[i], 1, n);
+		while(k < n && get_vertex_info(k).rpos <= p[i]) k++;
+		if(k >= n) continue;
+		const vertex_info &x = get_vertex_info(k);
+		if(p[i] >= x.lpos && p[i] < x.rpos) v[i] = k;
+	}
+	return 0;
+}
+
 int splice_graph::locate_vertex0(int32_t p, int a, int b)
 {
 	if(a >= b) return -1;
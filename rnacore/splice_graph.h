@@ -29,6 +29,9 @@ public:
 	splice_graph(const splice_graph &gr);
 	virtual ~splice_graph();
 
+public:
+	int add_vertex();
+
 public:
 	string chrm;
 	string gid;
@@ -41,15 +44,20 @@ public:
 	MED ewrt;
 	MEIF einf;
 
-	map<int32_t, int> lindex;
-	map<int32_t, int> rindex;
+	// boundaries of vertices as flat arrays sorted by position, built by
+	// build_vertex_index; lpos of vertices 1..n, and rpos of vertices 0..n-1
+	vector<int32_t> lindex;
+	vector<int> lvertex;
+	vector<int32_t> rindex;
+	vector<int> rvertex;
+	bool indexed;			// vertex positions unchanged since the index was built
 
 public:
 	// get and set properties
 	double get_vertex_weight(int v) const;
 	double get_edge_weight(edge_base *e) const;
 	const vertex_info & get_vertex_info(int v) const;
-    vertex_info & get_editable_vertex_info(int v);
+    vertex_info & get_editable_vertex_info(int v);		// must not move lpos or rpos, use set_vertex_info
 	const edge_info & get_edge_info(edge_base *e) const;
 	edge_info & get_editable_edge_info(edge_base *e);
 
@@ -118,6 +126,7 @@ public:
 	int locate_vertex0(int32_t p, int a, int b);
 	int locate_vertex(int32_t p, int a, int b);
 	int locate_vertex(int32_t p);
+	int locate_vertices(const vector<int32_t> &p, vector<int> &v);
 	int locate_lbound(int32_t p);
 	int locate_rbound(int32_t p);
 	int determine_position_left_type(int32_t p);
@@ -5,11 +5,56 @@ See LICENSE for licensing.
 */
 
 #include <cassert>
+#include <algorithm>
 #include "transcript_set.h"
 #include "constants.h"
 //#include <boost/asio/post.hpp>
 //#include <boost/asio/thread_pool.hpp>
 
+static string get_tid_prefix(const string &seqname, const string &gene_id)
+{
+	return "chr" + seqname + "." + gene_id;
+}
+
+static bool same_intron_chain(const vector<PI32> &x, const vector<PI32> &y)
+{
+	if(x.size() != y.size()) return false;
+	for(int k = 0; k + 1 < x.size(); k++)
+	{
+		if(x[k].second != y[k].second) return false;
+		if(x[k + 1].first != y[k + 1].first) return false;
+	}
+	return true;
+}
+
+trans_record::trans_record()
+{}
+
+trans_record::trans_record(const transcript &t, int s)
+{
+	sid = s;
+	PI32 p = t.get_bounds();
+	lpos = p.first;
+	rpos = p.second;
+	gene_id = t.gene_id;
+
+	string prefix = get_tid_prefix(t.seqname, t.gene_id);
+	tid_prefixed = (t.transcript_id.compare(0, prefix.size(), prefix) == 0);
+	if(tid_prefixed) tid_suffix = t.transcript_id.substr(prefix.size());
+	else tid_suffix = t.transcript_id;
+
+	cov2 = t.cov2;
+	conf = t.conf;
+	abd = t.abd;
+	count1 = t.count1;
+	features = t.features;
+}
+
+bool trans_record::operator<(const trans_record &r) const
+{
+	return sid < r.sid;
+}
+
 trans_item::trans_item()
 {}
 
@@ -17,22 +62,43 @@ trans_item::trans_item(const transcript &t, int c, int s)
 {
 	trst = t;
 	count = c;
-    trst.meta_tid = trst.transcript_id;
-	if(samples.find(s) == samples.end()) 
-    {
-        samples.insert(make_pair(s,t));
-        for(auto &x : samples) x.second.count2 = samples.size();
-    }
-    else 
-    {
-        samples[s].coverage = max(samples[s].coverage, t.coverage);
-		//samples[s].alt_cov2 = t.cov2;
-        //samples[s].cov2 = max(samples[s].cov2, t.cov2);
-        samples[s].conf = max(samples[s].conf, t.conf);
-        samples[s].abd = max(samples[s].abd, t.abd);
-        samples[s].count1 = max(samples[s].count1, t.count1);
-        printf("Check whether running!!!\n");
-    }
+	trst.meta_tid = trst.transcript_id;
+	samples.emplace_back(t, s);
+}
+
+int trans_item::build_sample_transcript(const trans_record &r, transcript &t) const
+{
+	// every sample shares the coverage, meta transcript id
+	// and number of supporting samples with trst
+	t.seqname = trst.seqname;
+	t.source = trst.source;
+	t.feature = trst.feature;
+	t.gene_type = trst.gene_type;
+	t.transcript_type = trst.transcript_type;
+	t.strand = trst.strand;
+	t.gene_id = r.gene_id;
+	if(r.tid_prefixed) t.transcript_id = get_tid_prefix(trst.seqname, r.gene_id) + r.tid_suffix;
+	else t.transcript_id = r.tid_suffix;
+	t.meta_tid = trst.transcript_id;
+	t.coverage = trst.coverage;
+	t.cov2 = r.cov2;
+	t.conf = r.conf;
+	t.abd = r.abd;
+	t.count1 = r.count1;
+	t.count2 = samples.size();
+	t.features = r.features;
+
+	if(r.exons.size() >= 1)
+	{
+		t.exons = r.exons;
+		return 0;
+	}
+
+	t.exons = trst.exons;
+	if(t.exons.size() == 0) return 0;
+	t.exons.front().first = r.lpos;
+	t.exons.back().second = r.rpos;
+	return 0;
 }
 
 int trans_item::merge(trans_item &ti, int mode)
@@ -42,35 +108,54 @@ int trans_item::merge(trans_item &ti, int mode)
 		if(trst.exons.size() >= 2) trst.coverage += ti.trst.coverage;
 		else if(trst.coverage < ti.trst.coverage) trst.coverage = ti.trst.coverage;
 
+		// records of ti refer to the exons of ti.trst; keep their own
+		// exons in the (unexpected) case that the chains differ
+		if(same_intron_chain(trst.exons, ti.trst.exons) == false)
+		{
+			for(auto &x : ti.samples)
+			{
+				if(x.exons.size() >= 1) continue;
+				transcript t;
+				ti.build_sample_transcript(x, t);
+				x.exons = std::move(t.exons);
+			}
+		}
+
         trst.extend_bounds(ti.trst);
 		count += ti.count;
 
         trst.cov2 = max(trst.cov2, ti.trst.cov2);
-        //trst.alt_cov2 = ti.trst.cov2;
         trst.conf = max(trst.conf, ti.trst.conf);
         trst.abd = max(trst.abd, ti.trst.abd);
         trst.count1 = max(trst.count1, ti.trst.count1);
 
-		for(auto &x : ti.samples)
+		vector<trans_record> vz;
+		vz.reserve(samples.size() + ti.samples.size());
+		int kx = 0, ky = 0;
+		while(kx < samples.size() || ky < ti.samples.size())
 		{
-			if(samples.find(x.first) == samples.end()) samples.emplace(std::move(x));
-			else 
-            {
-                samples[x.first].cov2 = max(samples[x.first].cov2, x.second.cov2);
-                //samples[x.first].alt_cov2 = x.second.cov2;
-                samples[x.first].conf = max(samples[x.first].conf, x.second.conf);
-                samples[x.first].abd = max(samples[x.first].abd, x.second.abd);
-                samples[x.first].count1 = max(samples[x.first].count1, x.second.count1);
-            }
+			if(ky >= ti.samples.size() || (kx < samples.size() && samples[kx].sid < ti.samples[ky].sid))
+			{
+				vz.emplace_back(std::move(samples[kx++]));
+			}
+			else if(kx >= samples.size() || ti.samples[ky].sid < samples[kx].sid)
+			{
+				vz.emplace_back(std::move(ti.samples[ky++]));
+			}
+			else
+			{
+				trans_record &x = samples[kx++];
+				const trans_record &y = ti.samples[ky++];
+				x.cov2 = max(x.cov2, y.cov2);
+				x.conf = max(x.conf, y.conf);
+				x.abd = max(x.abd, y.abd);
+				x.count1 = max(x.count1, y.count1);
+				vz.emplace_back(std::move(x));
+			}
 		}
+		samples.swap(vz);
 
         trst.count2 = samples.size();
-        for(auto &x : samples) 
-        {
-            x.second.coverage = trst.coverage;
-            x.second.count2 = samples.size();
-            x.second.meta_tid = trst.transcript_id;
-        }
 	}
 	else if(mode == TRANSCRIPT_COUNT_ADD_COVERAGE_NUL) 
 	{
@@ -82,9 +167,10 @@ int trans_item::merge(trans_item &ti, int mode)
 
 int merge_sorted_trans_items(vector<trans_item> &vx, vector<trans_item> &vy, int mode, double single_exon_ratio)
 {
-	vector<trans_item> vz;
-	vz.reserve(vx.size() + vy.size());
+	// pos[k]: index of vx before which vy[k] is inserted, -1 if merged
+	vector<int> pos(vy.size(), -1);
 
+	int m = 0;
 	int kx = 0, ky = 0;
 	while(kx < vx.size() && ky < vy.size())
 	{
@@ -92,30 +178,92 @@ int merge_sorted_trans_items(vector<trans_item> &vx, vector<trans_item> &vy, int
 		if(b == 0)
 		{
 			vx[kx].merge(vy[ky], mode);
-			vz.emplace_back(std::move(vx[kx]));
 			kx++;
 			ky++;
 		}
 		else if(b == 1)
 		{
-			vz.emplace_back(std::move(vx[kx]));
 			kx++;
 		}
 		else if(b == -1)
 		{
-			//vz.emplace_back(std::move(vy[ky]));
-			vz.emplace_back(std::move(vy[ky]));
-			ky++;
+			pos[ky++] = kx;
+			m++;
 		}
 		else assert(false);
 	}
 
 	assert(kx == vx.size() || ky == vy.size());
 
-	for(int i = kx; i < vx.size(); i++) vz.emplace_back(std::move(vx[i]));
-	for(int i = ky; i < vy.size(); i++) vz.emplace_back(std::move(vy[i]));
+	for(; ky < vy.size(); ky++)
+	{
+		pos[ky] = vx.size();
+		m++;
+	}
 
-	vx.swap(vz);
+	insert_trans_items(vx, vy, pos, m);
+	return 0;
+}
+
+int merge_unsorted_trans_items(vector<trans_item> &vx, vector<trans_item> &vy, int mode, double single_exon_ratio)
+{
+	// vy is a batch of multi-exon items in the order of insertion;
+	// equivalent to merging them into vx one by one, but vx is walked once
+	for(int k = 0; k < vy.size(); k++) assert(vy[k].trst.exons.size() >= 2);
+
+	stable_sort(vy.begin(), vy.end(), [single_exon_ratio](const trans_item &x, const trans_item &y) { 
+			return x.trst.compare1(y.trst, single_exon_ratio) == 1; });
+
+	vector<int> pos(vy.size(), -1);
+
+	int m = 0;
+	int kx = 0;
+	int last = -1;		// the previous item of vy that is inserted
+	for(int ky = 0; ky < vy.size(); ky++)
+	{
+		if(last >= 0 && vy[last].trst.compare1(vy[ky].trst, single_exon_ratio) == 0)
+		{
+			vy[last].merge(vy[ky], mode);
+			continue;
+		}
+
+		while(kx < vx.size() && vx[kx].trst.compare1(vy[ky].trst, single_exon_ratio) == 1) kx++;
+
+		// kx is kept, so that following equal items are merged into vx[kx] as well
+		if(kx < vx.size() && vx[kx].trst.compare1(vy[ky].trst, single_exon_ratio) == 0)
+		{
+			vx[kx].merge(vy[ky], mode);
+			last = -1;
+			continue;
+		}
+
+		pos[ky] = kx;
+		last = ky;
+		m++;
+	}
+
+	insert_trans_items(vx, vy, pos, m);
+	return 0;
+}
+
+int insert_trans_items(vector<trans_item> &vx, vector<trans_item> &vy, const vector<int> &pos, int m)
+{
+	// insert the m items of vy with pos[k] >= 0 into vx in place,
+	// filling from the back so that each element is moved at most once
+	if(m <= 0) return 0;
+
+	int n = vx.size();
+	vx.resize(n + m);
+
+	int i = n - 1;
+	int k = n + m - 1;
+	for(int j = vy.size() - 1; j >= 0; j--)
+	{
+		if(pos[j] < 0) continue;
+		while(i >= pos[j]) vx[k--] = std::move(vx[i--]);
+		vx[k--] = std::move(vy[j]);
+	}
+	assert(k == i);
 	return 0;
 }
 
@@ -153,6 +301,35 @@ int transcript_set::add(const transcript &t, int count, int sid, int mode)
 	return 0;
 }
 
+int transcript_set::add(const vector<transcript> &v, int count, int sid, int mode)
+{
+	// multi-exon transcripts are merged in batch for each bucket;
+	// single-exon ones are clustered by overlap, which depends 
+	// on the order, and are therefore added one by one
+	map<size_t, vector<trans_item>> mb;
+	for(int i = 0; i < v.size(); i++)
+	{
+		const transcript &t = v[i];
+		if(t.seqname != this->chrm) continue;
+
+		if(t.exons.size() <= 1)
+		{
+			add(t, count, sid, mode);
+			continue;
+		}
+
+		size_t h = t.get_intron_chain_hashing();
+		mb[h].emplace_back(t, count, sid);
+	}
+
+	for(auto &x : mb)
+	{
+		vector<trans_item> &vx = mt[x.first];
+		merge_unsorted_trans_items(vx, x.second, mode, single_exon_overlap);
+	}
+	return 0;
+}
+
 int transcript_set::add(transcript_set &ts, int mode)
 {
 	if(ts.chrm != this->chrm) return 0;
@@ -249,6 +426,21 @@ pair<bool, trans_item> transcript_set::query(const transcript &t) const
 	return p;
 }
 
+int reduce_transcript_sets(vector<transcript_set> &v, int mode)
+{
+	// merge pairs of sets in rounds, so that each transcript
+	// takes part in O(log n) merges instead of O(n)
+	for(int step = 1; step < v.size(); step *= 2)
+	{
+		for(int i = 0; i + step < v.size(); i += 2 * step)
+		{
+			v[i].add(v[i + step], mode);
+			v[i + step].clear();
+		}
+	}
+	return 0;
+}
+
 int transcript_set_pool::clear()
 {
 	count = 0;
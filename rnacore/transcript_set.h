@@ -16,6 +16,33 @@ See LICENSE for licensing.
 
 using namespace std;
 
+// compact record of a transcript assembled in one sample;
+// seqname, source, strand and the intron chain are shared with
+// the representative trans_item::trst, only boundaries are kept
+class trans_record
+{
+public:
+	trans_record();
+	trans_record(const transcript &t, int sid);
+
+public:
+	int sid;								// sample id
+	int32_t lpos;							// start of the first exon
+	int32_t rpos;							// end of the last exon
+	string gene_id;							// gene id in this sample
+	string tid_suffix;						// transcript_id with "chr<seqname>.<gene_id>" removed
+	bool tid_prefixed;						// whether tid_suffix has the above prefix removed
+	double cov2;
+	double conf;
+	double abd;
+	int count1;
+	transcript::TrstFeatures features;
+	vector<PI32> exons;						// only if the intron chain differs from trst
+
+public:
+	bool operator<(const trans_record &r) const;
+};
+
 class trans_item
 {
 public:
@@ -25,13 +52,16 @@ public:
 public:
 	transcript trst;
 	int count;
-	map<int, transcript> samples;
+	vector<trans_record> samples;			// sorted by sid
 
 public:
 	int merge(trans_item &ti, int mode);
+	int build_sample_transcript(const trans_record &r, transcript &t) const;
 };
 
 int merge_sorted_trans_items(vector<trans_item> &vx, vector<trans_item> &vy, int mode, double single_exon_overlap);
+int merge_unsorted_trans_items(vector<trans_item> &vx, vector<trans_item> &vy, int mode, double single_exon_overlap);
+int insert_trans_items(vector<trans_item> &vx, vector<trans_item> &vy, const vector<int> &pos, int m);
 
 class transcript_set
 {
@@ -47,6 +77,7 @@ public:
 
 public:
 	int add(const transcript &t, int count, int sid, int mode);
+	int add(const vector<transcript> &v, int count, int sid, int mode);
 	int add(transcript_set &ts, int mode);
 	int increase_count(int count);
 	int filter(int min_count);
@@ -56,6 +87,9 @@ public:
 	vector<transcript> get_transcripts(int min_count) const;
 };
 
+// tree reduction of v into v[0]
+int reduce_transcript_sets(vector<transcript_set> &v, int mode);
+
 class transcript_set_pool
 {
 public:
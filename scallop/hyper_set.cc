@@ -16,10 +16,11 @@ hyper_set::hyper_set()
 
 hyper_set::hyper_set(splice_graph &gr, const phase_set &ps)
 {
-	for(MVII::const_iterator it = ps.pmap.begin(); it != ps.pmap.end(); it++)
+	vector<int32_t> v;
+	for(int i = 0; i < ps.pids.size(); i++)
 	{
-		const vector<int32_t> &v = it->first;
-		int c = it->second;
+		ps.get_path(ps.pids[i], v);
+		int c = ps.get_count(ps.pids[i]);
 		vector<int> vv;
 		bool b = build_path_from_exon_coordinates(gr, v, vv);
 		if(b == false) continue;
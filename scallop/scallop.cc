@@ -7,6 +7,7 @@ See LICENSE for licensing.
 #include "scallop.h"
 #include "constants.h"
 #include "essential.h"
+#include "telemetry.h"
 
 #include <cstdio>
 #include <cmath>
@@ -37,6 +38,7 @@ scallop::~scallop()
 
 int scallop::assemble()
 {
+	stage_timer st(STAGE_SCALLOP, gr.chrm);
 	int c = classify();
 	if(cfg.verbose >= 2) printf("\n-----process splice graph %s type = %d, vertices = %lu, edges = %lu, phasing paths = %lu\n", gr.gid.c_str(), c, gr.num_vertices(), gr.num_edges(), hs.edges.size());
     splice_graph gr_ori = splice_graph(gr);
@@ -47,6 +49,7 @@ int scallop::assemble()
 	while(true)
 	{	
 		if(gr.num_vertices() > cfg.max_num_exons) break;
+		round++;
 
 		/*
 		printf("---------\n");
@@ -177,6 +180,7 @@ int scallop::assemble()
 	greedy_decompose();
 
 	build_transcripts(gr_ori);
+	st.add_items(trsts.size());
 
 	if(cfg.verbose >= 2) 
 	{
@@ -0,0 +1,29 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#include <cstdio>
+#include <iostream>
+
+#include "read_simulator.h"
+
+using namespace std;
+
+int main(int argc, const char **argv)
+{
+	setbuf(stdout, NULL);
+	read_simulator rs;
+
+	if(argc == 1)
+	{
+		rs.print_help();
+		printf("\n");
+		return 0;
+	}
+
+	rs.parse_arguments(argc, argv);
+	rs.resolve();
+	return 0;
+}
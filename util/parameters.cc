@@ -25,13 +25,24 @@ parameters::parameters()
 	chrm_list_string = "";
 	chrm_list_file = "";
 	profile_dir = "";
+	bundle_cache_dir = "";
+	cost_log_file = "";
+	report_file = "";
+	trace_file = "";
+	trace_dump_dir = "";
+	trace_dump_seconds = 1.0;
+	slowest_loci = 0;
 	verbose = 1;
 	algo = "aletsch";
 	version = "1.1.1";
 	max_threads = 10;
+	bam_threads = -1;
 	profile_only = false;
 	boost_precision = false;
 	skip_single_exon_transcripts = true;
+	bam_readahead = false;
+	output_bgzf = false;
+	summary_only = false;
 
 	// for meta-assembly
 	max_group_size = 200;
@@ -41,6 +52,8 @@ parameters::parameters()
 	assembly_repeats = 1;
 	region_partition_length = 1000000;
 	batch_partition_size = 3;
+	max_active_batches = 2;
+	max_memory = 0;
 
 	// for bridging paired-end reads
 	bridge_end_relaxing = 10;
@@ -60,6 +73,7 @@ parameters::parameters()
 	batch_bundle_size = 100;
 	max_reads_partition_gap = 10;
 	max_read_span = 500000;
+	max_duplicates = 0;
 	
 	// for preview
 	max_preview_reads = 2000000;
@@ -165,6 +179,41 @@ int parameters::parse_arguments(int argc, const char ** argv, int data_type)
 			profile_dir = string(argv[i + 1]);
 			i++;
 		}
+		else if(string(argv[i]) == "--bundle_cache_dir")
+		{
+			bundle_cache_dir = string(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--cost_log")
+		{
+			cost_log_file = string(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--report")
+		{
+			report_file = string(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--trace")
+		{
+			trace_file = string(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--trace_dump_dir")
+		{
+			trace_dump_dir = string(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--trace_dump_seconds")
+		{
+			trace_dump_seconds = atof(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--slowest")
+		{
+			slowest_loci = atoi(argv[i + 1]);
+			i++;
+		}
 		else if(string(argv[i]) == "-t")
 		{
 			max_threads = atoi(argv[i + 1]);
@@ -175,6 +224,11 @@ int parameters::parse_arguments(int argc, const char ** argv, int data_type)
 			max_threads = atoi(argv[i + 1]);
 			i++;
 		}
+		else if(string(argv[i]) == "--bam_threads")
+		{
+			bam_threads = atoi(argv[i + 1]);
+			i++;
+		}
 		else if(string(argv[i]) == "-s")
 		{
 			min_grouping_similarity = atof(argv[i + 1]);
@@ -210,6 +264,16 @@ int parameters::parse_arguments(int argc, const char ** argv, int data_type)
 			batch_partition_size = atoi(argv[i + 1]);
 			i++;
 		}
+		else if(string(argv[i]) == "--max_active_batches")
+		{
+			max_active_batches = atoi(argv[i + 1]);
+			i++;
+		}
+		else if(string(argv[i]) == "--max_memory")
+		{
+			max_memory = atoi(argv[i + 1]);
+			i++;
+		}
 		else if(string(argv[i]) == "-g")
 		{
 			region_partition_length = atoi(argv[i + 1]);
@@ -232,6 +296,18 @@ int parameters::parse_arguments(int argc, const char ** argv, int data_type)
 		{
 			profile_only = true;
 		}
+		else if(string(argv[i]) == "--bam_readahead")
+		{
+			bam_readahead = true;
+		}
+		else if(string(argv[i]) == "--output_bgzf")
+		{
+			output_bgzf = true;
+		}
+		else if(string(argv[i]) == "--summary_only")
+		{
+			summary_only = true;
+		}
 		else if(string(argv[i]) == "--version")
 		{
 			printf("%s\n", version.c_str());
@@ -361,6 +437,13 @@ int parameters::parse_arguments(int argc, const char ** argv, int data_type)
 			i++;
 			i++;
 		}
+		else if(string(argv[i]) == "--max_duplicates")
+		{
+			int dt = atoi(argv[i + 1]);
+			if(dt == 0 || dt == data_type) max_duplicates = atoi(argv[i + 2]);
+			i++;
+			i++;
+		}
 		else if(string(argv[i]) == "--min_bundle_gap")
 		{
 			int dt = atoi(argv[i + 1]);
@@ -495,6 +578,13 @@ int parameters::parse_arguments(int argc, const char ** argv, int data_type)
 		}
 	}
 
+	// htslib threads are taken from -t, so that
+	// the workers and them together do not exceed it
+	if(bam_threads < 0) bam_threads = max_threads / 4;
+	if(bam_threads > max_threads - 1) bam_threads = max_threads - 1;
+	if(bam_threads < 0) bam_threads = 0;
+	max_threads -= bam_threads;
+
 	/*
 	if(min_surviving_edge_weight < 0.1 + min_transcript_coverage) 
 	{
@@ -544,13 +634,26 @@ int parameters::print_help()
 	printf(" %-46s  %s\n", "--profile",  "profiling individual samples and exit (will write to files if -p provided)");
 	printf(" %-46s  %s\n", "--boost_precision",  "reduce false positives, default: not to do so");
 	printf(" %-46s  %s\n", "--output_single_exon_transcripts",  "assemble single-exon transcripts, default: not to do so");
-	printf(" %-46s  %s\n", "-l/--chrm_list_string <string>",  "list of chromosomes that will be assembled, default: N/A (i.e., assemble all)");
-	printf(" %-46s  %s\n", "-L/--chrm_list_file <string>",  "file with chromosomes that will be assembled, default: N/A (i.e., assemble all)");
+	printf(" %-46s  %s\n", "-l/--chrm_list_string <string>",  "list of chromosomes or regions (chrm:start-end) that will be assembled, default: N/A (i.e., assemble all)");
+	printf(" %-46s  %s\n", "-L/--chrm_list_file <string>",  "file with chromosomes or regions (chrm:start-end) that will be assembled, default: N/A (i.e., assemble all)");
 	printf(" %-46s  %s\n", "-d/--output_gtf_dir <string>",  "existing directory for individual transcripts, default: N/A");
 	printf(" %-46s  %s\n", "-p/--profile_dir <string>",  "existing directory for saving/loading profiles of each samples, default: N/A");
+	printf(" %-46s  %s\n", "--bundle_cache_dir <string>",  "existing directory for saving/loading bundles generated from bam files, default: N/A");
+	printf(" %-46s  %s\n", "--cost_log <string>",  "file for writing the predicted and actual time of each assembly task, default: N/A");
+	printf(" %-46s  %s\n", "--report <string>",  "file for writing a json report of time, counts and memory of each stage, default: N/A");
+	printf(" %-46s  %s\n", "--trace <string>",  "file for writing the size and time of assembling each splice graph, default: N/A");
+	printf(" %-46s  %s\n", "--slowest <integer>",  "print the given number of slowest loci at the end, default: 0");
+	printf(" %-46s  %s\n", "--trace_dump_dir <string>",  "existing directory for dumping slow splice graphs with their phasing paths, default: N/A");
+	printf(" %-46s  %s\n", "--trace_dump_seconds <float>",  "dump splice graphs that take at least this many seconds, default: 1.0");
 	printf(" %-46s  %s\n", "-t/--max_threads <integer>",  "maximized number of threads, default: 10");
+	printf(" %-46s  %s\n", "--bam_threads <integer>",  "threads of -t used for (de)compressing bam and bgzf files, default: a quarter of -t");
+	printf(" %-46s  %s\n", "--bam_readahead",  "prefetch the next region of each bam file while loading, default: not to do so");
+	printf(" %-46s  %s\n", "--output_bgzf",  "write bgzip-compressed gtf files sorted by position with tabix indices, default: plain text");
+	printf(" %-46s  %s\n", "--summary_only",  "reduce each bundle to a summary graph right after loading to save memory, default: keep all reads");
 	printf(" %-46s  %s\n", "-c/--max_group_size <integer>",  "the maximized number of splice graphs that will be combined, default: 200");
 	printf(" %-46s  %s\n", "-b/--batch_partition_size <integer>",  "the number of partitions loaded each time, default: 3");
+	printf(" %-46s  %s\n", "--max_active_batches <integer>",  "the number of batches, possibly of different chromosomes, loaded at the same time, default: 2");
+	printf(" %-46s  %s\n", "--max_memory <integer>",  "delay loading new batches while bundles in memory exceed this size (MB), default: 0 (i.e., no limit)");
 	printf(" %-46s  %s\n", "-g/--region_partition_length <integer>",  "the length of a partition , default: 1000000");
 	printf(" %-46s  %s\n", "-s/--min_grouping_similarity <float>",  "the minimized similarity for two graphs to be combined, default: 0.2");
     //printf(" %-46s  %s\n", "-r/--assembly_repeats <integer>",  "the number of repeats for consensus assembly, default: 5");
@@ -564,6 +667,7 @@ int parameters::print_help()
 	printf(" %-46s  %s\n", "--min_single_exon_clustering_overlap <float>",  "minimum overlaping ratio to merge two single-exon transcripts, default: 0.8");
 	printf(" %-46s  %s\n", "--min_mapping_quality <integer>",  "ignore reads with mapping quality less than this value, default: 1");
 	printf(" %-46s  %s\n", "--max_num_cigar <integer>",  "ignore reads with CIGAR size larger than this value, default: 1000");
+	printf(" %-46s  %s\n", "--max_duplicates <integer>",  "count identical alignments at most this many times (0: no limit), default: 0");
 	printf(" %-46s  %s\n", "--min_bundle_gap <integer>",  "minimum distances required to start a new bundle, default: 50");
 	printf(" %-46s  %s\n", "--min_num_hits_in_bundle <integer>",  "minimum number of reads required in a bundle, default: 20");
 	printf(" %-46s  %s\n", "--min_flank_length <integer>",  "minimum match length in each side for a spliced read, default: 3");
@@ -29,13 +29,24 @@ public:
 	string output_gtf_file;
 	string output_gtf_dir;
 	string profile_dir;
+	string bundle_cache_dir;
+	string cost_log_file;
+	string report_file;
+	string trace_file;
+	string trace_dump_dir;
+	double trace_dump_seconds;
+	int slowest_loci;
 	int verbose;
 	string algo;
 	string version;
 	int max_threads;
+	int bam_threads;
 	bool profile_only;
 	bool boost_precision;
 	bool skip_single_exon_transcripts;
+	bool bam_readahead;
+	bool output_bgzf;
+	bool summary_only;
 
 	// for meta-assembly
 	int max_group_size;
@@ -45,6 +56,8 @@ public:
 	int assembly_repeats;
 	int32_t region_partition_length;
 	int batch_partition_size;
+	int max_active_batches;
+	int max_memory;
 
 	// for bridging paired-end reads
 	int bridge_end_relaxing;
@@ -86,6 +99,7 @@ public:
 	int batch_bundle_size;
 	int32_t max_reads_partition_gap;
 	int32_t max_read_span;
+	int max_duplicates;
 
 	// for preview
 	int max_preview_reads;
@@ -0,0 +1,227 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#include "telemetry.h"
+#include <cstdio>
+#include <ctime>
+#include <cassert>
+#include <sys/resource.h>
+
+static const char *stage_names[NUM_STAGES] = {"generate", "build", "group", "bridge", "transform", "scallop", "postprocess"};
+
+// stages whose work runs on a thread pool, for which the time of the
+// calling thread is meaningless; nothing else runs while they do
+static const bool stage_process_cpu[NUM_STAGES] = {false, false, false, false, false, false, true};
+
+bool telemetry::active = false;
+chrono::steady_clock::time_point telemetry::start;
+mutex telemetry::slock;
+vector<telemetry_slab*> telemetry::slabs;
+
+stage_record::stage_record()
+{
+	calls = 0;
+	items = 0;
+	wall = 0;
+	cpu = 0;
+}
+
+int stage_record::add(const stage_record &r)
+{
+	calls += r.calls;
+	items += r.items;
+	wall += r.wall;
+	cpu += r.cpu;
+	return 0;
+}
+
+int telemetry::enable()
+{
+	active = true;
+	start = chrono::steady_clock::now();
+	return 0;
+}
+
+bool telemetry::enabled()
+{
+	return active;
+}
+
+double telemetry::thread_cpu_time()
+{
+	struct timespec ts;
+	if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+double telemetry::process_cpu_time()
+{
+	struct timespec ts;
+	if(clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) != 0) return 0;
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+bool telemetry::process_cpu(int stage)
+{
+	assert(stage >= 0 && stage < NUM_STAGES);
+	return stage_process_cpu[stage];
+}
+
+telemetry_slab* telemetry::get_slab()
+{
+	// slabs are owned here and outlive their threads
+	static thread_local telemetry_slab *slab = NULL;
+	if(slab != NULL) return slab;
+
+	slab = new telemetry_slab();
+	lock_guard<mutex> lg(slock);
+	slabs.push_back(slab);
+	return slab;
+}
+
+int telemetry::record(int stage, const string &chrm, int64_t items, double wall, double cpu)
+{
+	assert(stage >= 0 && stage < NUM_STAGES);
+	telemetry_slab *slab = get_slab();
+	lock_guard<mutex> lg(slab->lock);
+	vector<stage_record> &v = slab->records[chrm];
+	if(v.size() != NUM_STAGES) v.resize(NUM_STAGES);
+	v[stage].calls++;
+	v[stage].items += items;
+	v[stage].wall += wall;
+	v[stage].cpu += cpu;
+	return 0;
+}
+
+static int write_json_string(FILE *f, const string &s)
+{
+	fprintf(f, "\"");
+	for(int i = 0; i < s.size(); i++)
+	{
+		if(s[i] == '"' || s[i] == '\\') fprintf(f, "\\%c", s[i]);
+		else if(s[i] >= 0 && s[i] < 32) fprintf(f, "\\u%04x", s[i]);
+		else fprintf(f, "%c", s[i]);
+	}
+	fprintf(f, "\"");
+	return 0;
+}
+
+static int write_json_stages(FILE *f, const vector<stage_record> &v, const char *indent)
+{
+	fprintf(f, "{\n");
+	for(int k = 0; k < NUM_STAGES; k++)
+	{
+		const stage_record &r = v[k];
+		const char *cpu = stage_process_cpu[k] ? "process_cpu_seconds" : "cpu_seconds";
+		fprintf(f, "%s\t\"%s\": {\"calls\": %ld, \"items\": %ld, \"wall_seconds\": %.3lf, \"%s\": %.3lf}%s\n",
+				indent, stage_names[k], r.calls, r.items, r.wall, cpu, r.cpu, (k == NUM_STAGES - 1) ? "" : ",");
+	}
+	fprintf(f, "%s}", indent);
+	return 0;
+}
+
+int telemetry::write(const string &file)
+{
+	if(active == false) return 0;
+	if(file == "") return 0;
+
+	// merge the slabs of all threads
+	vector<stage_record> total(NUM_STAGES);
+	map<string, vector<stage_record>> chrms;
+	lock_guard<mutex> lg(slock);
+	for(int i = 0; i < slabs.size(); i++)
+	{
+		lock_guard<mutex> ls(slabs[i]->lock);
+		for(auto &z: slabs[i]->records)
+		{
+			vector<stage_record> &v = chrms[z.first];
+			if(v.size() != NUM_STAGES) v.resize(NUM_STAGES);
+			for(int k = 0; k < NUM_STAGES; k++) v[k].add(z.second[k]);
+			for(int k = 0; k < NUM_STAGES; k++) total[k].add(z.second[k]);
+		}
+	}
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	double wall = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	double utime = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6;
+	double stime = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+
+	FILE *f = fopen(file.c_str(), "w");
+	if(f == NULL)
+	{
+		printf("cannot open run-report file %s\n", file.c_str());
+		return 0;
+	}
+
+	fprintf(f, "{\n");
+	fprintf(f, "\t\"wall_seconds\": %.3lf,\n", wall);
+	fprintf(f, "\t\"cpu_user_seconds\": %.3lf,\n", utime);
+	fprintf(f, "\t\"cpu_system_seconds\": %.3lf,\n", stime);
+	fprintf(f, "\t\"peak_rss_kb\": %ld,\n", (long)(usage.ru_maxrss));
+	fprintf(f, "\t\"threads\": %lu,\n", slabs.size());
+	fprintf(f, "\t\"stages\": ");
+	write_json_stages(f, total, "\t");
+	fprintf(f, ",\n");
+
+	// stages without a known chrm are only in the totals
+	fprintf(f, "\t\"chromosomes\": {");
+	bool first = true;
+	for(auto &z: chrms)
+	{
+		if(z.first == "") continue;
+		fprintf(f, "%s\n\t\t", first ? "" : ",");
+		write_json_string(f, z.first);
+		fprintf(f, ": ");
+		write_json_stages(f, z.second, "\t\t");
+		first = false;
+	}
+	fprintf(f, "\n\t}\n");
+	fprintf(f, "}\n");
+	fclose(f);
+	return 0;
+}
+
+stage_timer::stage_timer(int s)
+	: stage(s)
+{
+	active = telemetry::enabled();
+	items = 0;
+	if(active == false) return;
+	wall0 = chrono::steady_clock::now();
+	cpu0 = telemetry::process_cpu(stage) ? telemetry::process_cpu_time() : telemetry::thread_cpu_time();
+}
+
+stage_timer::stage_timer(int s, const string &c)
+	: stage(s)
+{
+	active = telemetry::enabled();
+	items = 0;
+	if(active == false) return;
+	chrm = c;
+	wall0 = chrono::steady_clock::now();
+	cpu0 = telemetry::process_cpu(stage) ? telemetry::process_cpu_time() : telemetry::thread_cpu_time();
+}
+
+stage_timer::~stage_timer()
+{
+	if(active == false) return;
+	double wall = chrono::duration<double>(chrono::steady_clock::now() - wall0).count();
+	double cpu = (telemetry::process_cpu(stage) ? telemetry::process_cpu_time() : telemetry::thread_cpu_time()) - cpu0;
+	telemetry::record(stage, chrm, items, wall, cpu);
+}
+
+int stage_timer::set_chrm(const string &c)
+{
+	if(active == true) chrm = c;
+	return 0;
+}
+
+int stage_timer::add_items(int64_t n)
+{
+	items += n;
+	return 0;
+}
@@ -0,0 +1,97 @@
+/*
+Part of aletsch
+(c) 2020 by Mingfu Shao, The Pennsylvania State University
+See LICENSE for licensing.
+*/
+
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdint.h>
+
+using namespace std;
+
+// instrumented stages; a stage nested in another one is also
+// counted in the enclosing stage; the cpu time of a stage is that
+// of the calling thread, except for stages that run their work on
+// a thread pool, which take the cpu time of the whole process
+#define STAGE_GENERATE 0			// generator::resolve, items = reads
+#define STAGE_BUILD 1				// generator::build, items = bundles
+#define STAGE_GROUP 2				// bundle_group::resolve, items = bundles
+#define STAGE_BRIDGE 3				// bundle::bridge, items = bridged fragments
+#define STAGE_TRANSFORM 4			// assembler::transform, items = vertices
+#define STAGE_SCALLOP 5				// scallop::assemble, items = transcripts
+#define STAGE_POSTPROCESS 6			// incubator::postprocess, items = bundle groups, process cpu
+#define NUM_STAGES 7
+
+class stage_record
+{
+public:
+	stage_record();
+
+public:
+	int64_t calls;
+	int64_t items;
+	double wall;				// seconds
+	double cpu;					// seconds of the calling thread, or the process
+
+public:
+	int add(const stage_record &r);
+};
+
+// records of one thread, by chrm; only the owning thread writes,
+// and the report reads them under the same lock
+class telemetry_slab
+{
+public:
+	mutex lock;
+	map<string, vector<stage_record>> records;
+};
+
+class telemetry
+{
+public:
+	static int enable();
+	static bool enabled();
+	static int record(int stage, const string &chrm, int64_t items, double wall, double cpu);
+	static int write(const string &file);
+	static double thread_cpu_time();
+	static double process_cpu_time();
+	static bool process_cpu(int stage);	// whether the stage runs on a thread pool
+
+private:
+	static bool active;
+	static chrono::steady_clock::time_point start;
+	static mutex slock;
+	static vector<telemetry_slab*> slabs;
+	static telemetry_slab* get_slab();
+};
+
+// times the enclosing scope as one call of a stage;
+// it costs nothing unless telemetry is enabled
+class stage_timer
+{
+public:
+	stage_timer(int stage);
+	stage_timer(int stage, const string &chrm);
+	~stage_timer();
+
+private:
+	int stage;
+	bool active;
+	string chrm;
+	int64_t items;
+	chrono::steady_clock::time_point wall0;
+	double cpu0;
+
+public:
+	int set_chrm(const string &c);
+	int add_items(int64_t n);
+};
+
+#endif